@@ -0,0 +1,286 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <exception>
+
+#include "../simulator/simulator.hpp"
+#include "../simulator/sceneFile.hpp"
+#include "../common/profiler.hpp"
+#include "../common/program_cache.hpp"
+#include "report.hpp"
+#include "verify.hpp"
+
+// Headless benchmark of the simulation: runs the two dam break scenario, or a scene file, for warm-up plus measured frames
+// and reports per-stage percentiles of the profile scopes as JSON, or compares two such reports.
+// --verify=N instead checks that the backends and lambda kernels agree after N frames from the same initial state, keep N small,
+// float rounding makes runs drift apart chaotically once particles collide.
+const char* USAGE = " [--backend=gpu|cpu] [--threads=N] [--particles=N] [--scene=FILE] [--warmup=N] [--frames=N] [--output=FILE] [--shader-cache=DIR]\n"
+                    "       [--compare=BASELINE,CURRENT] [--threshold=F] [--metric=mean|p50|p90|p99|min|max] [--verify=N] [--tolerance=F]";
+
+unsigned int warmupFrameCount = 30;
+unsigned int measuredFrameCount = 200;
+std::string outputFileName;
+std::string baselineFileName;
+std::string currentFileName;
+double threshold = 0.1;
+std::string metric = "p50";
+unsigned int verifyFrameCount = 0;
+// in domain units for positions, relative to the rest density for densities
+double tolerance = 1e-3;
+
+// per-frame time of every stage path, summed over the calls of a stage in that frame
+std::vector<std::string> stagePaths;
+std::map<std::string, std::vector<double>> stageSamples;
+
+int parseArgument(const std::string& argument) {
+    auto value = [&argument]() {
+        return argument.substr(argument.find('=') + 1);
+    };
+
+    try {
+        if (argument == "--backend=gpu") {
+            simulator::backend = simulator::Backend::GPU;
+        }
+        else if (argument == "--backend=cpu") {
+            simulator::backend = simulator::Backend::CPU;
+        }
+        else if (argument.rfind("--threads=", 0) == 0) {
+            simulator::cpuThreadCount = static_cast<unsigned int>(std::stoul(value()));
+        }
+        else if (argument.rfind("--particles=", 0) == 0) {
+            simulator::SimulationScale scale = simulator::scaleFromParticleCount(static_cast<unsigned int>(std::stoul(value())));
+            simulator::simulationScale.particleCountPerEdgeXZ = scale.particleCountPerEdgeXZ;
+            simulator::simulationScale.particleCountPerEdgeY = scale.particleCountPerEdgeY;
+        }
+        else if (argument.rfind("--scene=", 0) == 0) {
+            return simulator::loadSceneFile(value());
+        }
+        else if (argument.rfind("--shader-cache=", 0) == 0) {
+            common::programCacheDirectory = value();
+        }
+        else if (argument.rfind("--warmup=", 0) == 0) {
+            warmupFrameCount = static_cast<unsigned int>(std::stoul(value()));
+        }
+        else if (argument.rfind("--frames=", 0) == 0) {
+            measuredFrameCount = static_cast<unsigned int>(std::stoul(value()));
+        }
+        else if (argument.rfind("--output=", 0) == 0) {
+            outputFileName = value();
+        }
+        else if (argument.rfind("--compare=", 0) == 0) {
+            std::string files = value();
+            size_t comma = files.find(',');
+            if (comma == std::string::npos) {
+                std::cerr << "--compare needs two reports separated by a comma" << std::endl;
+                return -1;
+            }
+            baselineFileName = files.substr(0, comma);
+            currentFileName = files.substr(comma + 1);
+        }
+        else if (argument.rfind("--threshold=", 0) == 0) {
+            threshold = std::stod(value());
+        }
+        else if (argument.rfind("--metric=", 0) == 0) {
+            metric = value();
+            if (!bench::isMetric(metric)) {
+                std::cerr << "unknown metric " << metric << ", expected mean, p50, p90, p99, min or max" << std::endl;
+                return -1;
+            }
+        }
+        else if (argument.rfind("--verify=", 0) == 0) {
+            verifyFrameCount = static_cast<unsigned int>(std::stoul(value()));
+        }
+        else if (argument.rfind("--tolerance=", 0) == 0) {
+            tolerance = std::stod(value());
+        }
+        else {
+            std::cerr << "unknown argument: " << argument << std::endl;
+            return -1;
+        }
+    }
+    catch (const std::exception&) {
+        std::cerr << "invalid value in argument: " << argument << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+int collectSamples(const std::vector<common::ProfileEvent>& events) {
+    std::vector<std::string> pathOfDepth;
+    std::map<std::string, double> frameTime;
+    unsigned int frameCount = events.empty() ? 0 : events[0].frameCount;
+
+    auto flushFrame = [&]() {
+        if (frameCount >= warmupFrameCount && frameCount < warmupFrameCount + measuredFrameCount) {
+            for (const auto& stage : frameTime) {
+                stageSamples[stage.first].push_back(stage.second);
+            }
+        }
+        frameTime.clear();
+    };
+
+    // events of a frame are in call order, so the open scopes above an event are the last ones seen at each lower depth
+    for (const common::ProfileEvent& event : events) {
+        if (event.frameCount != frameCount) {
+            flushFrame();
+            frameCount = event.frameCount;
+        }
+
+        pathOfDepth.resize(event.depth + 1);
+        pathOfDepth[event.depth] = event.depth == 0 ? event.name : pathOfDepth[event.depth - 1] + "/" + event.name;
+        const std::string& path = pathOfDepth[event.depth];
+        if (stageSamples.find(path) == stageSamples.end()) {
+            stageSamples[path];
+            stagePaths.push_back(path);
+        }
+        frameTime[path] += event.hasGPUTime ? event.gpuEnd - event.gpuBegin : event.cpuEnd - event.cpuBegin;
+    }
+    flushFrame();
+
+    return 0;
+}
+
+GLFWwindow* createHiddenContext() {
+    // a hidden window is enough for a context, Mesa llvmpipe provides one on machines without a GPU
+    if (!glfwInit()) {
+        std::cerr << "failed to initialize GLFW" << std::endl;
+        return nullptr;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "pbf_bench", NULL, NULL);
+    if (window == NULL) {
+        std::cerr << "failed to create a hidden GLFW window" << std::endl;
+        glfwTerminate();
+        return nullptr;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cerr << "failed to initialize GLAD" << std::endl;
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return nullptr;
+    }
+
+    return window;
+}
+
+// a headless run never created one
+void destroyHiddenContext(GLFWwindow* window) {
+    if (window != nullptr) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
+}
+
+int runBenchmark(bench::BenchReport& report) {
+    if (simulator::simulateInit() != 0) {
+        return -1;
+    }
+    common::profilerInit(!simulator::headless);
+
+    std::cerr << "benchmarking " << simulator::particleCount << " particles, "
+              << warmupFrameCount << " warm-up and " << measuredFrameCount << " measured frames" << std::endl;
+    for (unsigned int i = 0; i < warmupFrameCount + measuredFrameCount; i++) {
+        common::profilerBeginFrame();
+        simulator::simulate();
+        common::profilerEndFrame();
+        collectSamples(common::getProfileEvents());
+        // keeps the GPU at most one frame behind so the profiler never drops a frame
+        if (!simulator::headless) {
+            glFinish();
+        }
+    }
+    // one empty frame picks up the last measured one
+    common::profilerBeginFrame();
+    common::profilerEndFrame();
+    collectSamples(common::getProfileEvents());
+
+    report.scenario = simulator::sceneShapes.empty() ? "two_dam_break" : simulator::sceneName;
+    report.backend = simulator::backend == simulator::Backend::CPU ? "cpu" : "gpu";
+    report.glRenderer = simulator::headless ? "none" : reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    report.particleCount = simulator::particleCount;
+    report.warmupFrameCount = warmupFrameCount;
+    report.measuredFrameCount = measuredFrameCount;
+    // stages that only ran during warm-up (e.g. the periodic reorder) are left out
+    for (const std::string& path : stagePaths) {
+        if (!stageSamples[path].empty()) {
+            report.stages.emplace_back(path, bench::computeStatistics(stageSamples[path]));
+        }
+    }
+
+    common::profilerTerminate();
+    simulator::simulateTerminate();
+
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (parseArgument(argv[i]) != 0) {
+            std::cerr << "usage: " << argv[0] << USAGE << std::endl;
+            return -1;
+        }
+    }
+
+    // exit code 1 if any stage regressed so CI can fail on it
+    if (!baselineFileName.empty()) {
+        bench::BenchReport baseline;
+        bench::BenchReport current;
+        if (bench::readReport(baselineFileName, baseline) != 0 || bench::readReport(currentFileName, current) != 0) {
+            return -1;
+        }
+        return bench::compareReports(baseline, current, metric, threshold, std::cout) > 0 ? 1 : 0;
+    }
+
+    // the CPU backend runs without a display or GPU, only --verify needs a context for the GPU runs
+    GLFWwindow* window = nullptr;
+    if (simulator::backend == simulator::Backend::CPU && verifyFrameCount == 0) {
+        simulator::headless = true;
+    }
+    else {
+        window = createHiddenContext();
+        if (window == nullptr) {
+            return -1;
+        }
+    }
+    if (simulator::configureScale() != 0) {
+        destroyHiddenContext(window);
+        return -1;
+    }
+    // exit code 1 if any run drifted further than the tolerance
+    if (verifyFrameCount > 0) {
+        int failureCount = bench::verifyBackends(verifyFrameCount, tolerance, std::cout);
+        destroyHiddenContext(window);
+        return failureCount < 0 ? -1 : (failureCount > 0 ? 1 : 0);
+    }
+
+    bench::BenchReport report;
+    int result = runBenchmark(report);
+    destroyHiddenContext(window);
+    if (result != 0) {
+        return -1;
+    }
+
+    if (outputFileName.empty()) {
+        bench::writeReport(std::cout, report);
+    }
+    else {
+        std::ofstream file(outputFileName);
+        if (!file) {
+            std::cerr << "cannot open output file: " << outputFileName << std::endl;
+            return -1;
+        }
+        bench::writeReport(file, report);
+    }
+
+    return 0;
+}
@@ -0,0 +1,225 @@
+#include "report.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+
+namespace bench {
+    const int STAGE_COLUMN_WIDTH = 80;
+
+    double percentile(const std::vector<double>& sortedSamples, double p) {
+        // nearest rank
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sortedSamples.size()));
+        return sortedSamples[std::max<size_t>(rank, 1) - 1];
+    }
+
+    StageStatistics computeStatistics(std::vector<double> samples) {
+        StageStatistics statistics = {};
+        statistics.sampleCount = static_cast<unsigned int>(samples.size());
+        if (samples.empty()) {
+            return statistics;
+        }
+
+        std::sort(samples.begin(), samples.end());
+        statistics.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+        statistics.p50 = percentile(samples, 50.0);
+        statistics.p90 = percentile(samples, 90.0);
+        statistics.p99 = percentile(samples, 99.0);
+        statistics.min = samples.front();
+        statistics.max = samples.back();
+
+        return statistics;
+    }
+
+    std::string escapeString(const std::string& value) {
+        std::string result;
+        for (char c : value) {
+            if (c == '"' || c == '\\') {
+                result += '\\';
+            }
+            result += c;
+        }
+        return result;
+    }
+
+    int writeReport(std::ostream& os, const BenchReport& report) {
+        // one stage per line so readReport does not need a full json parser
+        os << std::fixed << std::setprecision(4);
+        os << "{\n"
+           << "    \"scenario\": \"" << escapeString(report.scenario) << "\",\n"
+           << "    \"backend\": \"" << escapeString(report.backend) << "\",\n"
+           << "    \"glRenderer\": \"" << escapeString(report.glRenderer) << "\",\n"
+           << "    \"particleCount\": " << report.particleCount << ",\n"
+           << "    \"warmupFrames\": " << report.warmupFrameCount << ",\n"
+           << "    \"measuredFrames\": " << report.measuredFrameCount << ",\n"
+           << "    \"stages\": {\n";
+        for (size_t i = 0; i < report.stages.size(); i++) {
+            const StageStatistics& statistics = report.stages[i].second;
+            os << "        \"" << escapeString(report.stages[i].first) << "\": { "
+               << "\"mean\": " << statistics.mean << ", "
+               << "\"p50\": " << statistics.p50 << ", "
+               << "\"p90\": " << statistics.p90 << ", "
+               << "\"p99\": " << statistics.p99 << ", "
+               << "\"min\": " << statistics.min << ", "
+               << "\"max\": " << statistics.max << ", "
+               << "\"samples\": " << statistics.sampleCount << " }"
+               << (i + 1 < report.stages.size() ? "," : "") << "\n";
+        }
+        os << "    }\n"
+           << "}\n" << std::flush;
+
+        return 0;
+    }
+
+    // value of "key": "..." in line, empty if the key is not there
+    std::string extractString(const std::string& line, const std::string& key) {
+        size_t position = line.find("\"" + key + "\": \"");
+        if (position == std::string::npos) {
+            return "";
+        }
+        position += key.size() + 5;
+        std::string result;
+        for (; position < line.size() && line[position] != '"'; position++) {
+            if (line[position] == '\\' && position + 1 < line.size()) {
+                position++;
+            }
+            result += line[position];
+        }
+        return result;
+    }
+
+    bool extractNumber(const std::string& line, const std::string& key, double& value) {
+        size_t position = line.find("\"" + key + "\": ");
+        if (position == std::string::npos) {
+            return false;
+        }
+        value = std::strtod(line.c_str() + position + key.size() + 4, nullptr);
+        return true;
+    }
+
+    int readReport(const std::string& path, BenchReport& report) {
+        std::ifstream file(path);
+        if (!file) {
+            std::cerr << "cannot open report: " << path << std::endl;
+            return -1;
+        }
+
+        report = BenchReport();
+        std::string line;
+        double number = 0.0;
+        while (std::getline(file, line)) {
+            if (line.find("\"p50\": ") != std::string::npos) {
+                size_t nameBegin = line.find('"') + 1;
+                std::string name = line.substr(nameBegin, line.find("\": {") - nameBegin);
+
+                StageStatistics statistics = {};
+                extractNumber(line, "mean", statistics.mean);
+                extractNumber(line, "p50", statistics.p50);
+                extractNumber(line, "p90", statistics.p90);
+                extractNumber(line, "p99", statistics.p99);
+                extractNumber(line, "min", statistics.min);
+                extractNumber(line, "max", statistics.max);
+                if (extractNumber(line, "samples", number)) {
+                    statistics.sampleCount = static_cast<unsigned int>(number);
+                }
+                report.stages.emplace_back(name, statistics);
+            }
+            else if (line.find("\"scenario\"") != std::string::npos) {
+                report.scenario = extractString(line, "scenario");
+            }
+            else if (line.find("\"backend\"") != std::string::npos) {
+                report.backend = extractString(line, "backend");
+            }
+            else if (line.find("\"glRenderer\"") != std::string::npos) {
+                report.glRenderer = extractString(line, "glRenderer");
+            }
+            else if (extractNumber(line, "particleCount", number)) {
+                report.particleCount = static_cast<unsigned int>(number);
+            }
+            else if (extractNumber(line, "warmupFrames", number)) {
+                report.warmupFrameCount = static_cast<unsigned int>(number);
+            }
+            else if (extractNumber(line, "measuredFrames", number)) {
+                report.measuredFrameCount = static_cast<unsigned int>(number);
+            }
+        }
+
+        if (report.stages.empty()) {
+            std::cerr << "no stages in report: " << path << std::endl;
+            return -1;
+        }
+
+        return 0;
+    }
+
+    bool isMetric(const std::string& metric) {
+        return metric == "mean" || metric == "p50" || metric == "p90" || metric == "p99" || metric == "min" || metric == "max";
+    }
+
+    // metric has to pass isMetric()
+    double getMetric(const StageStatistics& statistics, const std::string& metric) {
+        if (metric == "mean") {
+            return statistics.mean;
+        }
+        if (metric == "p90") {
+            return statistics.p90;
+        }
+        if (metric == "p99") {
+            return statistics.p99;
+        }
+        if (metric == "min") {
+            return statistics.min;
+        }
+        if (metric == "max") {
+            return statistics.max;
+        }
+        return statistics.p50;
+    }
+
+    int compareReports(const BenchReport& baseline, const BenchReport& current, const std::string& metric, double threshold, std::ostream& os) {
+        if (baseline.particleCount != current.particleCount || baseline.backend != current.backend) {
+            os << "warning: comparing " << baseline.backend << " with " << baseline.particleCount << " particles against "
+               << current.backend << " with " << current.particleCount << " particles\n";
+        }
+
+        os << std::fixed << std::setprecision(3);
+        os << std::left << std::setw(STAGE_COLUMN_WIDTH) << "stage (" + metric + ", ms)" << std::right
+           << std::setw(10) << "baseline" << std::setw(10) << "current" << std::setw(10) << "change" << "\n";
+
+        int regressionCount = 0;
+        for (const auto& stage : current.stages) {
+            auto baselineStage = std::find_if(baseline.stages.begin(), baseline.stages.end(),
+                [&stage](const std::pair<std::string, StageStatistics>& other) { return other.first == stage.first; });
+            double currentTime = getMetric(stage.second, metric);
+
+            os << std::left << std::setw(STAGE_COLUMN_WIDTH) << stage.first << std::right;
+            if (baselineStage == baseline.stages.end()) {
+                os << std::setw(10) << "-" << std::setw(10) << currentTime << std::setw(10) << "new" << "\n";
+                continue;
+            }
+
+            double baselineTime = getMetric(baselineStage->second, metric);
+            double change = baselineTime > 0.0 ? (currentTime - baselineTime) / baselineTime : 0.0;
+            bool regressed = currentTime > baselineTime * (1.0 + threshold) && currentTime - baselineTime > MIN_REGRESSION_TIME;
+            os << std::setw(10) << baselineTime << std::setw(10) << currentTime
+               << std::setw(9) << change * 100.0 << "%" << (regressed ? "  REGRESSION" : "") << "\n";
+            regressionCount += regressed ? 1 : 0;
+        }
+
+        for (const auto& stage : baseline.stages) {
+            auto currentStage = std::find_if(current.stages.begin(), current.stages.end(),
+                [&stage](const std::pair<std::string, StageStatistics>& other) { return other.first == stage.first; });
+            if (currentStage == current.stages.end()) {
+                os << std::left << std::setw(STAGE_COLUMN_WIDTH) << stage.first << std::right
+                   << std::setw(10) << getMetric(stage.second, metric) << std::setw(10) << "-" << std::setw(10) << "removed" << "\n";
+            }
+        }
+
+        os << regressionCount << " stage(s) slower than the baseline by more than " << threshold * 100.0 << " %\n" << std::flush;
+
+        return regressionCount;
+    }
+}
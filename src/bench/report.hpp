@@ -0,0 +1,45 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+    // milliseconds per frame, a stage that runs several times in a frame is summed first
+    struct StageStatistics {
+        double mean;
+        double p50;
+        double p90;
+        double p99;
+        double min;
+        double max;
+        unsigned int sampleCount;
+    };
+
+    struct BenchReport {
+        std::string scenario;
+        std::string backend;
+        std::string glRenderer;
+        unsigned int particleCount;
+        unsigned int warmupFrameCount;
+        unsigned int measuredFrameCount;
+        // stage paths like "frame/simulate/searchNeighbor", in call order
+        std::vector<std::pair<std::string, StageStatistics>> stages;
+    };
+
+    // slowdowns below this are noise even if they exceed the relative threshold
+    const double MIN_REGRESSION_TIME = 0.01;
+
+    StageStatistics computeStatistics(std::vector<double> samples);
+
+    int writeReport(std::ostream& os, const BenchReport& report);
+    // reads a report written by writeReport, returns -1 if the file cannot be opened or holds no stages
+    int readReport(const std::string& path, BenchReport& report);
+
+    // metric names of StageStatistics accepted by compareReports
+    bool isMetric(const std::string& metric);
+
+    // prints every stage of both reports, returns the number of stages whose metric grew by more than threshold (a fraction)
+    int compareReports(const BenchReport& baseline, const BenchReport& current, const std::string& metric, double threshold, std::ostream& os);
+}
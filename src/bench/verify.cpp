@@ -0,0 +1,109 @@
+#include "verify.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+#include "../simulator/simulator.hpp"
+
+namespace bench {
+    int runSnapshot(unsigned int frameCount, ParticleSnapshot& snapshot) {
+        if (simulator::simulateInit() != 0) {
+            return -1;
+        }
+        for (unsigned int i = 0; i < frameCount; i++) {
+            simulator::simulate();
+        }
+
+        unsigned int particleCount = simulator::particleCount;
+        std::vector<glm::vec4> position(particleCount);
+        std::vector<float> density(particleCount);
+        std::vector<GLuint> particleId(particleCount);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, simulator::particlePositionSSBO);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, particleCount * sizeof(glm::vec4), position.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, simulator::densitySSBO);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, particleCount * sizeof(float), density.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, simulator::particleIdSSBO);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, particleCount * sizeof(GLuint), particleId.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        simulator::simulateTerminate();
+
+        // the CPU backend never reorders, its ids stay the identity
+        snapshot.position.assign(particleCount, glm::vec4(0.0f));
+        snapshot.density.assign(particleCount, 0.0f);
+        for (unsigned int i = 0; i < particleCount; i++) {
+            if (particleId[i] >= particleCount) {
+                std::cerr << "invalid particle id " << particleId[i] << " at " << i << std::endl;
+                return -1;
+            }
+            snapshot.position[particleId[i]] = position[i];
+            snapshot.density[particleId[i]] = density[i];
+        }
+
+        return 0;
+    }
+
+    SnapshotDeviation compareSnapshots(const ParticleSnapshot& a, const ParticleSnapshot& b) {
+        SnapshotDeviation deviation = {};
+        size_t particleCount = std::min(a.position.size(), b.position.size());
+        for (size_t i = 0; i < particleCount; i++) {
+            double distance = glm::length(glm::vec3(a.position[i]) - glm::vec3(b.position[i]));
+            double density = std::abs(a.density[i] - b.density[i]) * simulator::REST_DENSITY_REVERSE;
+            // NaN compares false, count it as an infinite deviation instead of hiding it
+            deviation.maxPosition = std::isnan(distance) ? INFINITY : std::max(deviation.maxPosition, distance);
+            deviation.maxDensity = std::isnan(density) ? INFINITY : std::max(deviation.maxDensity, density);
+        }
+
+        return deviation;
+    }
+
+    int verifyBackends(unsigned int frameCount, double tolerance, std::ostream& os) {
+        simulator::Backend backend = simulator::backend;
+        bool fuseLambdaKernel = simulator::fuseLambdaKernel;
+
+        struct Run {
+            const char* name;
+            simulator::Backend backend;
+            bool fuseLambdaKernel;
+            ParticleSnapshot snapshot;
+        };
+        // the fused GPU run is the reference, the split kernels have to give the same result
+        std::vector<Run> runs = {
+            {"gpu fused", simulator::Backend::GPU, true, {}},
+            {"gpu split", simulator::Backend::GPU, false, {}},
+            {"cpu", simulator::Backend::CPU, true, {}},
+        };
+        int result = 0;
+        for (Run& run : runs) {
+            simulator::backend = run.backend;
+            simulator::fuseLambdaKernel = run.fuseLambdaKernel;
+            if (runSnapshot(frameCount, run.snapshot) != 0) {
+                result = -1;
+                break;
+            }
+        }
+        simulator::backend = backend;
+        simulator::fuseLambdaKernel = fuseLambdaKernel;
+        if (result != 0) {
+            return result;
+        }
+
+        os << "deviation after " << frameCount << " frames of " << simulator::particleCount << " particles, tolerance " << tolerance << "\n";
+        os << std::scientific << std::setprecision(3);
+        int failureCount = 0;
+        for (size_t i = 1; i < runs.size(); i++) {
+            SnapshotDeviation deviation = compareSnapshots(runs[0].snapshot, runs[i].snapshot);
+            bool failed = !(deviation.maxPosition <= tolerance && deviation.maxDensity <= tolerance);
+            os << std::left << std::setw(24) << std::string(runs[0].name) + " vs " + runs[i].name << std::right
+               << "max position " << deviation.maxPosition << "  max density " << deviation.maxDensity
+               << (failed ? "  EXCEEDED" : "") << "\n";
+            failureCount += failed ? 1 : 0;
+        }
+        os << std::flush;
+
+        return failureCount;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace bench {
+    // Runs the simulation from the same initial state with the GPU and CPU backends, and on the GPU with the fused
+    // and the split lambda kernels, and reports how far the results drift apart. Needs a current GL context.
+
+    // positions and densities of every particle in initial order, the GPU reorder is undone
+    struct ParticleSnapshot {
+        std::vector<glm::vec4> position;
+        std::vector<float> density;
+    };
+
+    struct SnapshotDeviation {
+        // largest distance of a particle between the two runs
+        double maxPosition;
+        // largest density difference relative to the rest density
+        double maxDensity;
+    };
+
+    // simulates frameCount frames from the initial state of the configured scene and reads the result back
+    int runSnapshot(unsigned int frameCount, ParticleSnapshot& snapshot);
+    SnapshotDeviation compareSnapshots(const ParticleSnapshot& a, const ParticleSnapshot& b);
+
+    // the backend and kernel selection are restored afterwards,
+    // returns the number of comparisons whose deviation exceeds tolerance, -1 if a run failed
+    int verifyBackends(unsigned int frameCount, double tolerance, std::ostream& os);
+}
@@ -4,6 +4,7 @@ namespace common {
     // utils
     bool enableSimulation = true;
     bool resetSimulation = false;
+    bool saveCheckpoint = false;
     bool hideGUI = false;
     bool cameraMode = false;
 }
@@ -12,6 +12,7 @@ namespace common {
     // utils
     extern bool enableSimulation;
     extern bool resetSimulation;
+    extern bool saveCheckpoint;
     extern bool hideGUI;
     extern bool cameraMode;
 
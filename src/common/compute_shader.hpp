@@ -9,11 +9,16 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <vector>
+#include <utility>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
 #include "common.hpp"
+#include "program_cache.hpp"
 
 class ComputeShader
 {
@@ -24,8 +29,9 @@ public:
     ComputeShader() : ID(0) {}
 
     // constructor generates the shader on the fly
+    // every (name, value) in defines becomes a `#define name value` right after the #version line
     // ------------------------------------------------------------------------
-    ComputeShader(const char* computePath) : filePath(computePath)
+    ComputeShader(const char* computePath, const std::vector<std::pair<std::string, std::string>>& defines = {}) : filePath(computePath)
     {
         // 1. retrieve the compute shader source code from filePath
         std::string computeCode;
@@ -45,20 +51,36 @@ public:
                       << "Path: " << computePath << "\n"
                       << "Error: " << e.what() << "\n";
         }
+        if (!defines.empty())
+        {
+            computeCode = injectDefines(computeCode, defines);
+        }
         const char* cShaderCode = computeCode.c_str();
 
-        // 2. compile compute shader
+        // 2. a program linked by an earlier run skips compiling
+        uint64_t cacheKey = common::getProgramCacheKey({computeCode});
+        ID = common::loadProgramBinary(cacheKey);
+        if (ID != 0)
+        {
+            return;
+        }
+
+        // 3. compile compute shader
         unsigned int compute;
         compute = glCreateShader(GL_COMPUTE_SHADER);
         glShaderSource(compute, 1, &cShaderCode, NULL);
         glCompileShader(compute);
         checkCompileErrors(compute, "COMPUTE");
 
-        // 3. create shader program
+        // 4. create shader program
         ID = glCreateProgram();
         glAttachShader(ID, compute);
+        common::prepareProgramBinary(ID);
         glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+        if (checkCompileErrors(ID, "PROGRAM"))
+        {
+            common::storeProgramBinary(cacheKey, ID);
+        }
         
         // delete the shader as it's linked into our program now and no longer necessary
         glDeleteShader(compute);
@@ -81,53 +103,68 @@ public:
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(getUniformLocation(name), (int)value); 
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(getUniformLocation(name), value); 
     }
     // ------------------------------------------------------------------------
     void setUint(const std::string &name, unsigned int value) const
     {
-        glUniform1ui(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1ui(getUniformLocation(name), value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(getUniformLocation(name), value); 
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, glm::vec2 value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+        glUniform2fv(getUniformLocation(name), 1, glm::value_ptr(value));
     }
     // ------------------------------------------------------------------------
     void setIvec2(const std::string &name, glm::ivec2 value) const
     {
-        glUniform2iv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+        glUniform2iv(getUniformLocation(name), 1, glm::value_ptr(value));
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, glm::vec3 value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+        glUniform3fv(getUniformLocation(name), 1, glm::value_ptr(value));
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, glm::mat3 value) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+        glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, glm::mat4 value) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+        glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
     }
 
 private:
-    // utility function for checking shader compilation/linking errors.
+    // glGetUniformLocation is a string lookup in the driver, so every location is only queried once per program
+    mutable std::unordered_map<std::string, int> uniformLocationCache;
+
+    int getUniformLocation(const std::string& name) const
+    {
+        auto it = uniformLocationCache.find(name);
+        if (it != uniformLocationCache.end())
+        {
+            return it->second;
+        }
+        int location = glGetUniformLocation(ID, name.c_str());
+        uniformLocationCache.emplace(name, location);
+        return location;
+    }
+
+    // utility function for checking shader compilation/linking errors, true on success.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(unsigned int shader, const std::string& type)
+    bool checkCompileErrors(unsigned int shader, const std::string& type)
     {
         int success;
         char infoLog[1024];
@@ -155,6 +192,27 @@ private:
                           << infoLog << "\n----------------------------------\n";
             }
         }
+        return success != 0;
+    }
+
+    std::string injectDefines(const std::string& code, const std::vector<std::pair<std::string, std::string>>& defines)
+    {
+        size_t versionLineEnd = code.find('\n', code.find("#version"));
+        if (versionLineEnd == std::string::npos)
+        {
+            versionLineEnd = code.size();
+        }
+        size_t versionLineCount = static_cast<size_t>(std::count(code.begin(), code.begin() + versionLineEnd, '\n')) + 1;
+
+        std::string defineCode;
+        for (const auto& define : defines)
+        {
+            defineCode += "#define " + define.first + " " + define.second + "\n";
+        }
+        // keep the line numbers of compile errors pointing into the file
+        defineCode += "#line " + std::to_string(versionLineCount + 1) + "\n";
+
+        return code.substr(0, versionLineEnd) + "\n" + defineCode + (versionLineEnd < code.size() ? code.substr(versionLineEnd + 1) : std::string());
     }
 
     unsigned int ceilWithInvocationPerWorkgroup(unsigned int x, unsigned int invocationPerWorkgroup)
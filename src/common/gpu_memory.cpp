@@ -0,0 +1,229 @@
+#include "gpu_memory.hpp"
+
+#include <map>
+#include <utility>
+#include <algorithm>
+
+namespace common {
+    struct GPUMemoryEntry {
+        GPUMemoryRecord record;
+        // level 0 of all faces
+        size_t levelSize;
+        bool hasMipmaps;
+    };
+
+    // keyed by (isTexture, id), buffer and texture names live in different namespaces
+    std::map<std::pair<bool, GLuint>, GPUMemoryEntry> gpuMemoryEntries;
+    std::vector<const char*> gpuMemoryOwners;
+
+    GPUMemoryOwner::GPUMemoryOwner(const char* name) {
+        gpuMemoryOwners.push_back(name);
+    }
+
+    GPUMemoryOwner::~GPUMemoryOwner() {
+        gpuMemoryOwners.pop_back();
+    }
+
+    std::string getCurrentOwner() {
+        if (gpuMemoryOwners.empty()) {
+            return "unowned";
+        }
+        std::string owner = gpuMemoryOwners[0];
+        for (size_t i = 1; i < gpuMemoryOwners.size(); i++) {
+            owner += "/";
+            owner += gpuMemoryOwners[i];
+        }
+        return owner;
+    }
+
+    GLuint getBoundBuffer(GLenum target) {
+        GLenum binding = 0;
+        switch (target) {
+            case GL_ARRAY_BUFFER: binding = GL_ARRAY_BUFFER_BINDING; break;
+            case GL_ELEMENT_ARRAY_BUFFER: binding = GL_ELEMENT_ARRAY_BUFFER_BINDING; break;
+            case GL_SHADER_STORAGE_BUFFER: binding = GL_SHADER_STORAGE_BUFFER_BINDING; break;
+            case GL_UNIFORM_BUFFER: binding = GL_UNIFORM_BUFFER_BINDING; break;
+            case GL_COPY_READ_BUFFER: binding = GL_COPY_READ_BUFFER_BINDING; break;
+            case GL_COPY_WRITE_BUFFER: binding = GL_COPY_WRITE_BUFFER_BINDING; break;
+            case GL_PIXEL_PACK_BUFFER: binding = GL_PIXEL_PACK_BUFFER_BINDING; break;
+            case GL_PIXEL_UNPACK_BUFFER: binding = GL_PIXEL_UNPACK_BUFFER_BINDING; break;
+            default: return 0;
+        }
+        GLint buffer = 0;
+        glGetIntegerv(binding, &buffer);
+        return static_cast<GLuint>(buffer);
+    }
+
+    bool isCubeMapFace(GLenum target) {
+        return target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z;
+    }
+
+    GLuint getBoundTexture(GLenum target) {
+        GLint texture = 0;
+        if (target == GL_TEXTURE_2D) {
+            glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+        }
+        else if (target == GL_TEXTURE_CUBE_MAP || isCubeMapFace(target)) {
+            glGetIntegerv(GL_TEXTURE_BINDING_CUBE_MAP, &texture);
+        }
+        return static_cast<GLuint>(texture);
+    }
+
+    size_t getBytesPerTexel(GLenum internalFormat) {
+        switch (internalFormat) {
+            case GL_RGBA32F: return 16;
+            case GL_RGBA16F:
+            case GL_RG32F: return 8;
+            case GL_R32F:
+            case GL_R32I:
+            case GL_R32UI:
+            case GL_DEPTH_COMPONENT32F:
+            case GL_DEPTH_COMPONENT:
+            case GL_DEPTH24_STENCIL8: return 4;
+            case GL_R8:
+            case GL_R8I:
+            case GL_R8UI:
+            case GL_RED: return 1;
+            // drivers pad three channel formats to four
+            default: return 4;
+        }
+    }
+
+    const char* getInternalFormatName(GLenum internalFormat) {
+        switch (internalFormat) {
+            case 0: return "buffer";
+            case GL_RGBA32F: return "RGBA32F";
+            case GL_RGBA16F: return "RGBA16F";
+            case GL_RG32F: return "RG32F";
+            case GL_R32F: return "R32F";
+            case GL_R32I: return "R32I";
+            case GL_R32UI: return "R32UI";
+            case GL_DEPTH_COMPONENT32F: return "DEPTH32F";
+            case GL_DEPTH_COMPONENT: return "DEPTH";
+            case GL_DEPTH24_STENCIL8: return "DEPTH24_STENCIL8";
+            case GL_R8: return "R8";
+            case GL_R8I: return "R8I";
+            case GL_R8UI: return "R8UI";
+            case GL_RED: return "RED";
+            case GL_RGB: return "RGB";
+            case GL_RGB8: return "RGB8";
+            case GL_RGBA: return "RGBA";
+            case GL_RGBA8: return "RGBA8";
+            default: return "other";
+        }
+    }
+
+    void recordBuffer(GLenum target, GLsizeiptr size) {
+        GLuint buffer = getBoundBuffer(target);
+        if (buffer == 0) {
+            return;
+        }
+        auto key = std::make_pair(false, buffer);
+        auto entry = gpuMemoryEntries.find(key);
+        if (entry == gpuMemoryEntries.end()) {
+            entry = gpuMemoryEntries.emplace(key, GPUMemoryEntry{ { getCurrentOwner(), false, buffer, 0, 0, 0, 0 }, 0, false }).first;
+        }
+        entry->second.levelSize = static_cast<size_t>(size);
+        entry->second.record.size = static_cast<size_t>(size);
+    }
+
+    void gpuBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+        glBufferData(target, size, data, usage);
+        recordBuffer(target, size);
+    }
+
+    void gpuBufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) {
+        glBufferStorage(target, size, data, flags);
+        recordBuffer(target, size);
+    }
+
+    void gpuTexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height,
+                       GLenum format, GLenum type, const void* data) {
+        glTexImage2D(target, level, internalFormat, width, height, 0, format, type, data);
+
+        // lower levels are covered by gpuGenerateMipmap
+        GLuint texture = getBoundTexture(target);
+        if (texture == 0 || level != 0) {
+            return;
+        }
+        auto key = std::make_pair(true, texture);
+        auto entry = gpuMemoryEntries.find(key);
+        if (entry == gpuMemoryEntries.end()) {
+            entry = gpuMemoryEntries.emplace(key, GPUMemoryEntry{ { getCurrentOwner(), true, texture, 0, 0, 0, 0 }, 0, false }).first;
+        }
+        GPUMemoryEntry& textureEntry = entry->second;
+        textureEntry.record.internalFormat = static_cast<GLenum>(internalFormat);
+        textureEntry.record.width = width;
+        textureEntry.record.height = height;
+        // every face of a cube map is uploaded on its own and has the same size
+        textureEntry.levelSize = static_cast<size_t>(width) * height * getBytesPerTexel(internalFormat) * (isCubeMapFace(target) ? 6 : 1);
+        textureEntry.record.size = textureEntry.hasMipmaps ? textureEntry.levelSize + textureEntry.levelSize / 3 : textureEntry.levelSize;
+    }
+
+    void gpuGenerateMipmap(GLenum target) {
+        glGenerateMipmap(target);
+
+        auto entry = gpuMemoryEntries.find(std::make_pair(true, getBoundTexture(target)));
+        if (entry != gpuMemoryEntries.end()) {
+            entry->second.hasMipmaps = true;
+            entry->second.record.size = entry->second.levelSize + entry->second.levelSize / 3;
+        }
+    }
+
+    void gpuDeleteBuffers(GLsizei count, const GLuint* buffers) {
+        for (GLsizei i = 0; i < count; i++) {
+            gpuMemoryEntries.erase(std::make_pair(false, buffers[i]));
+        }
+        glDeleteBuffers(count, buffers);
+    }
+
+    void gpuDeleteTextures(GLsizei count, const GLuint* textures) {
+        for (GLsizei i = 0; i < count; i++) {
+            gpuMemoryEntries.erase(std::make_pair(true, textures[i]));
+        }
+        glDeleteTextures(count, textures);
+    }
+
+    std::vector<GPUMemoryRecord> getGPUMemoryRecords() {
+        std::vector<GPUMemoryRecord> records;
+        records.reserve(gpuMemoryEntries.size());
+        for (const auto& entry : gpuMemoryEntries) {
+            records.push_back(entry.second.record);
+        }
+        std::sort(records.begin(), records.end(), [](const GPUMemoryRecord& a, const GPUMemoryRecord& b) {
+            return a.owner != b.owner ? a.owner < b.owner : a.size > b.size;
+        });
+        return records;
+    }
+
+    std::vector<GPUMemorySummary> getGPUMemorySummary() {
+        std::map<std::string, GPUMemorySummary> summaries;
+        for (const auto& entry : gpuMemoryEntries) {
+            const GPUMemoryRecord& record = entry.second.record;
+            GPUMemorySummary& summary = summaries[record.owner];
+            summary.owner = record.owner;
+            if (record.isTexture) {
+                summary.textureCount++;
+                summary.textureSize += record.size;
+            }
+            else {
+                summary.bufferCount++;
+                summary.bufferSize += record.size;
+            }
+        }
+
+        std::vector<GPUMemorySummary> result;
+        for (const auto& summary : summaries) {
+            result.push_back(summary.second);
+        }
+        return result;
+    }
+
+    size_t getGPUMemoryTotal() {
+        size_t total = 0;
+        for (const auto& entry : gpuMemoryEntries) {
+            total += entry.second.record.size;
+        }
+        return total;
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace common {
+    // one buffer or texture allocated through the functions below, sizes are estimates from the
+    // internal format since GL has no portable query for the memory a driver really reserves
+    struct GPUMemoryRecord {
+        // owner scopes open at allocation time joined by '/', e.g. "caustics/fluid"
+        std::string owner;
+        bool isTexture;
+        GLuint id;
+        // 0 for buffers
+        GLenum internalFormat;
+        GLsizei width;
+        GLsizei height;
+        size_t size;
+    };
+
+    // totals of one owner path, children are listed separately
+    struct GPUMemorySummary {
+        std::string owner;
+        unsigned int bufferCount;
+        unsigned int textureCount;
+        size_t bufferSize;
+        size_t textureSize;
+    };
+
+    // resources allocated while an owner is alive are accounted to it, owners nest
+    class GPUMemoryOwner {
+        public:
+            GPUMemoryOwner(const char* name);
+            ~GPUMemoryOwner();
+
+            GPUMemoryOwner(const GPUMemoryOwner&) = delete;
+            GPUMemoryOwner& operator=(const GPUMemoryOwner&) = delete;
+    };
+
+    // drop-in replacements of the GL calls that record the resource bound to target,
+    // reallocating a resource updates its record and keeps its original owner
+    void gpuBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+    // immutable storage, needs GL 4.4 or ARB_buffer_storage
+    void gpuBufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+    void gpuTexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height,
+                       GLenum format, GLenum type, const void* data);
+    // a full mip chain adds a third to the size of level 0
+    void gpuGenerateMipmap(GLenum target);
+    void gpuDeleteBuffers(GLsizei count, const GLuint* buffers);
+    void gpuDeleteTextures(GLsizei count, const GLuint* textures);
+
+    // live resources, ordered by owner and then by size, largest first
+    std::vector<GPUMemoryRecord> getGPUMemoryRecords();
+    // one entry per owner path, ordered by path so children follow their parent
+    std::vector<GPUMemorySummary> getGPUMemorySummary();
+    size_t getGPUMemoryTotal();
+
+    const char* getInternalFormatName(GLenum internalFormat);
+}
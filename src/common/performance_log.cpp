@@ -7,27 +7,28 @@
 #include <fstream>
 #include <chrono>
 #include <ctime>
+#include <vector>
+#include <memory>
 
 #include "common.hpp"
+#include "profiler.hpp"
+#include "gpu_memory.hpp"
+#include "trace_writer.hpp"
 
 namespace common {
     unsigned int frameCount = 0;
-    GLuint timeQueryID[TIME_QUERY_COUNT];
-    double timeMarker[TIME_QUERY_COUNT];
 
     double totalTime;
     double fps;
-
     double renderTime;
-    double renderTimeSlice[RENDER_TIME_QUERY_COUNT];
-    double renderTimePercentage[RENDER_TIME_QUERY_COUNT];
-
     double simulateTime;
-    double simulateTimeSlice[SIMULATE_TIME_QUERY_COUNT];
-    double simulateTimePercentage[SIMULATE_TIME_QUERY_COUNT];
+
+    std::string traceFileName;
+    std::unique_ptr<TraceWriter> traceWriter;
+    std::vector<std::function<void(std::ostream&)>> performanceLogSections;
 
     int performanceLogInit() {
-        glGenQueries(TIME_QUERY_COUNT, timeQueryID);
+        profilerInit();
 
         std::ofstream clearFile(PERFORMANCE_LOG_FILE_NAME, std::ios::trunc);
         auto now = std::chrono::system_clock::now();
@@ -41,105 +42,104 @@ namespace common {
         clearFile << "Performance Log\n" << std::put_time(&buf, "%Y-%m-%d %H:%M:%S") << "\n\n";
         clearFile.close();
 
+        if (!traceFileName.empty()) {
+            traceWriter = std::make_unique<TraceWriter>(traceFileName);
+            if (!traceWriter->isOpen()) {
+                std::cerr << "cannot open trace file: " << traceFileName << std::endl;
+                traceWriter.reset();
+            }
+        }
+
         glFinish();
 
         return 0;
     }
 
     int performanceLogTerminate() {
-        glDeleteQueries(TIME_QUERY_COUNT, timeQueryID);
+        // the writer finishes the file on its way out
+        traceWriter.reset();
+        profilerTerminate();
 
         glFinish();
 
         return 0;
     }
 
-    void queryTime(unsigned int index) {
-        glQueryCounter(timeQueryID[index], GL_TIMESTAMP);
-    }
-
     void calculateTime() {
-        for (unsigned int i = 0; i < TIME_QUERY_COUNT; i++) {
-            GLuint64 time;
-            glGetQueryObjectui64v(timeQueryID[i], GL_QUERY_RESULT, &time);
-            timeMarker[i] = static_cast<double>(time) * MILLISECONDS_SCALER;
-        }
+        const ProfileRecord* frame = findProfileRecord("frame");
+        const ProfileRecord* render = findProfileRecord("render");
+        // no simulate record when the simulation was paused in that frame
+        const ProfileRecord* simulate = findProfileRecord("simulate");
+
+        totalTime = frame ? getProfileRecordTime(*frame) : 0.0;
+        fps = totalTime > 0.0 ? 1000.0 / totalTime : 0.0;
+        renderTime = render ? getProfileRecordTime(*render) : 0.0;
+        simulateTime = simulate ? getProfileRecordTime(*simulate) : 0.0;
+    }
 
-        if (enableSimulation) {
-            totalTime = timeMarker[TIME_QUERY_COUNT - 1] - timeMarker[0];
-        }
-        else {
-            totalTime = timeMarker[TIME_QUERY_COUNT - 1] - timeMarker[SIMULATE_TIME_QUERY_COUNT];
+    void outputProfileRecords(std::ostream& os, const std::string& rootName) {
+        const std::vector<ProfileRecord>& records = getProfileRecords();
+        std::vector<unsigned int> subtree = getProfileSubtree(rootName);
+        if (subtree.empty()) {
+            return;
         }
-        fps = 1000.0 / totalTime;
 
-        // simulate time
-        if (enableSimulation) {
-            simulateTime = timeMarker[SIMULATE_TIME_QUERY_COUNT] - timeMarker[0];
-            for (unsigned int i = 0; i < SIMULATE_TIME_QUERY_COUNT; i++) {
-                simulateTimeSlice[i] = timeMarker[i + 1] - timeMarker[i];
-            }
-            for (unsigned int i = 0; i < SIMULATE_TIME_QUERY_COUNT; i++) {
-                simulateTimePercentage[i] = simulateTimeSlice[i] / simulateTime * 100;
+        unsigned int rootDepth = records[subtree[0]].depth;
+        for (unsigned int index : subtree) {
+            const ProfileRecord& record = records[index];
+            std::string label = std::string(2 * (record.depth - rootDepth), ' ') + record.name;
+            if (record.callCount > 1) {
+                label += " (x" + std::to_string(record.callCount) + ")";
             }
-        }
-        else {
-            simulateTime = 0.0;
-            for (unsigned int i = 0; i < SIMULATE_TIME_QUERY_COUNT; i++) {
-                simulateTimeSlice[i] = 0.0;
+            double time = getProfileRecordTime(record);
+
+            os << std::left << std::setw(40) << label << std::right << std::setw(8) << time << " ms";
+            if (index != subtree[0]) {
+                double parentTime = getProfileRecordTime(records[record.parent]);
+                os << " \t( " << std::setw(6) << (parentTime > 0.0 ? time / parentTime * 100 : 0.0) << " %)";
             }
-            for (unsigned int i = 0; i < SIMULATE_TIME_QUERY_COUNT; i++) {
-                simulateTimePercentage[i] = 0.0;
+            if (!record.hasGPUTime) {
+                os << " \tcpu";
             }
-        }
-
-        // render time
-        renderTime = timeMarker[TIME_QUERY_COUNT - 1] - timeMarker[SIMULATE_TIME_QUERY_COUNT];
-        for (unsigned int i = 0; i < RENDER_TIME_QUERY_COUNT; i++) {
-            renderTimeSlice[i] = timeMarker[i + 1 + SIMULATE_TIME_QUERY_COUNT] - timeMarker[i + SIMULATE_TIME_QUERY_COUNT];
-        }
-        for (unsigned int i = 0; i < RENDER_TIME_QUERY_COUNT; i++) {
-            renderTimePercentage[i] = renderTimeSlice[i] / renderTime * 100;
+            os << "\n";
         }
     }
 
     void outputRenderPerformance(std::ostream& os) {
         os << std::fixed << std::setprecision(2);
-        os << "--------------------Render Performance------------------" << getSupplementarySymbol('-') << "\n"
-             << "Render: \t\t\t\t\t\t" << std::setw(5) << renderTime << " ms \n"
-             << "Process Input: \t\t\t\t\t" << std::setw(5) << renderTimeSlice[0] << " ms \t( " << std::setw(5) << renderTimePercentage[0] << " %)\n"
-             << "Background: \t\t\t\t\t" << std::setw(5) << renderTimeSlice[1] << " ms \t( " << std::setw(5) << renderTimePercentage[1] << " %)\n"
-             << "Copy Particle Attribute: \t\t" << std::setw(5) << renderTimeSlice[2] << " ms \t( " << std::setw(5) << renderTimePercentage[2] << " %)\n"
-             << "Fluid Depth: \t\t\t\t\t" << std::setw(5) << renderTimeSlice[3] << " ms \t( " << std::setw(5) << renderTimePercentage[3] << " %)\n"
-             << "Smooth Fluid Depth: \t\t\t" << std::setw(5) << renderTimeSlice[4] << " ms \t( " << std::setw(5) << renderTimePercentage[4] << " %)\n"
-             << "Compute Fluid Normal: \t\t\t" << std::setw(5) << renderTimeSlice[5] << " ms \t( " << std::setw(5) << renderTimePercentage[5] << " %)\n"
-             << "Fluid Thickness: \t\t\t\t" << std::setw(5) << renderTimeSlice[6] << " ms \t( " << std::setw(5) << renderTimePercentage[6] << " %)\n"
-             << "Render Final Scene: \t\t\t" << std::setw(5) << renderTimeSlice[7] << " ms \t( " << std::setw(5) << renderTimePercentage[7] << " %)\n"
-             << "Swap Buffers: \t\t\t\t\t" << std::setw(5) << renderTimeSlice[8] << " ms \t( " << std::setw(5) << renderTimePercentage[8] << " %)\n"
-             << "--------------------------------------------------------" << getSupplementarySymbol('-') << "\n"
+        os << "--------------------Render Performance------------------" << getSupplementarySymbol('-') << "\n";
+        outputProfileRecords(os, "render");
+        os << "--------------------------------------------------------" << getSupplementarySymbol('-') << "\n"
              << std::flush;
     }
 
     void outputSimulatePerformance(std::ostream& os) {
         os << std::fixed << std::setprecision(2);
-        os << "---------------------Simulate Performance---------------" << getSupplementarySymbol('-') << "\n"
-             << "Simulate: \t\t\t\t\t\t" << std::setw(5) << simulateTime << " ms \n"
-             << "Apply External Force: \t\t\t" << std::setw(5) << simulateTimeSlice[0] << " ms \t( " << std::setw(5) << simulateTimePercentage[0] << " %)\n"
-             << "Search Neighbor: \t\t\t\t" << std::setw(5) << simulateTimeSlice[1] << " ms \t( " << std::setw(5) << simulateTimePercentage[1] << " %)\n"
-             << "Constraint Projection: \t\t\t" << std::setw(5) << simulateTimeSlice[2] << " ms \t( " << std::setw(5) << simulateTimePercentage[2] << " %)\n"
-             << "Update Velocity by Position: \t" << std::setw(5) << simulateTimeSlice[3] << " ms \t( " << std::setw(5) << simulateTimePercentage[3] << " %)\n"
-             << "Vorticity Confinement: \t\t\t" << std::setw(5) << simulateTimeSlice[4] << " ms \t( " << std::setw(5) << simulateTimePercentage[4] << " %)\n"
-             << "Viscosity: \t\t\t\t\t\t" << std::setw(5) << simulateTimeSlice[5] << " ms \t( " << std::setw(5) << simulateTimePercentage[5] << " %)\n"
-             << "Handle Boundary Collision: \t\t" << std::setw(5) << simulateTimeSlice[6] << " ms \t( " << std::setw(5) << simulateTimePercentage[6] << " %)\n"
-             << "Update Particle Position: \t\t" << std::setw(5) << simulateTimeSlice[7] << " ms \t( " << std::setw(5) << simulateTimePercentage[7] << " %)\n"
-             << "--------------------------------------------------------" << getSupplementarySymbol('-') << "\n"
+        os << "---------------------Simulate Performance---------------" << getSupplementarySymbol('-') << "\n";
+        outputProfileRecords(os, "simulate");
+        os << "--------------------------------------------------------" << getSupplementarySymbol('-') << "\n"
              << std::flush;
     }
 
+    void outputGPUMemory(std::ostream& os) {
+        const double MEBIBYTE = 1024.0 * 1024.0;
+        os << std::fixed << std::setprecision(2);
+        os << "-----------------------GPU Memory-----------------------" << getSupplementarySymbol('-') << "\n"
+           << "Total: \t\t\t\t\t\t\t" << std::setw(8) << getGPUMemoryTotal() / MEBIBYTE << " MiB\n";
+        for (const GPUMemorySummary& summary : getGPUMemorySummary()) {
+            os << std::left << std::setw(40) << summary.owner + ":" << std::right
+               << std::setw(8) << (summary.bufferSize + summary.textureSize) / MEBIBYTE << " MiB \t"
+               << summary.bufferCount << " buffers " << std::setw(8) << summary.bufferSize / MEBIBYTE << " MiB \t"
+               << summary.textureCount << " textures " << std::setw(8) << summary.textureSize / MEBIBYTE << " MiB\n";
+        }
+        os << "--------------------------------------------------------" << getSupplementarySymbol('-') << "\n"
+           << std::flush;
+    }
+
     void outputPerformance(std::ostream& os) {
         os << std::fixed << std::setprecision(2);
         os << "========================================================" << getSupplementarySymbol('=') << "\n";
-        os << "-------------------Performance(" << frameCount << "th frame)----------------\n"
+        os << "-------------------Performance(" << getTimedFrameCount() << "th frame)----------------\n"
              << "Total: \t\t\t\t\t\t\t" << std::setw(5) << totalTime << " ms \t" << std::setw(6) << fps << " fps\n"
              << "Render: \t\t\t\t\t\t" << std::setw(5) << renderTime << " ms \t( " << std::setw(5) << renderTime / totalTime * 100 << " %)\n"
              << "Simulate: \t\t\t\t\t\t" << std::setw(5) << simulateTime << " ms \t( " << std::setw(5) << simulateTime / totalTime * 100 << " %)\n"
@@ -158,10 +158,24 @@ namespace common {
         #endif
         }
 
+        {
+        #ifdef ENABLE_PRINT_GPU_MEMORY
+        outputGPUMemory(os);
+        #endif
+        }
+
+        for (const auto& outputSection : performanceLogSections) {
+            outputSection(os);
+        }
+
         os << "========================================================" << getSupplementarySymbol('=') << "\n\n"
              << std::flush;
     }
 
+    void addPerformanceLogSection(const std::function<void(std::ostream&)>& outputSection) {
+        performanceLogSections.push_back(outputSection);
+    }
+
     void printPerformanceToConsole() {
         outputPerformance(std::cout);
     }
@@ -175,9 +189,17 @@ namespace common {
         return frameCount;
     }
 
+    unsigned int getTimedFrameCount() {
+        return getProfiledFrameCount();
+    }
+
     void updateFrameCount() {
-        frameCount++;
+        profilerEndFrame();
         calculateTime();
+        if (traceWriter) {
+            traceWriter->write(getProfileEvents());
+        }
+        frameCount++;
     }
 
     std::string getSupplementarySymbol(char symbol) {
@@ -2,42 +2,45 @@
 
 #define ENABLE_PRINT_RENDER_PERFORMANCE
 #define ENABLE_PRINT_SIMULATE_PERFORMANCE
+#define ENABLE_PRINT_GPU_MEMORY
 
 #include <string>
 #include <iostream>
+#include <functional>
 
 namespace common {
     const unsigned int FRAME_COUNT_PER_LOG = 32;
-    const double MILLISECONDS_SCALER = 1e-6;
-
-    const unsigned int SIMULATE_TIME_QUERY_COUNT = 8;
-    const unsigned int RENDER_TIME_QUERY_COUNT = 9;
-    const unsigned int TIME_QUERY_COUNT = RENDER_TIME_QUERY_COUNT + SIMULATE_TIME_QUERY_COUNT + 1;
 
     const std::string PERFORMANCE_LOG_FILE_NAME = "performance_log.txt";
 
+    // Chrome trace of every profiled frame is written here if not empty
+    extern std::string traceFileName;
+
     extern double fps;
     extern double totalTime;
     extern double renderTime;
     extern double simulateTime;
 
-    extern double renderTimeSlice[RENDER_TIME_QUERY_COUNT];
-    extern double renderTimePercentage[RENDER_TIME_QUERY_COUNT];
-
-    extern double simulateTimeSlice[SIMULATE_TIME_QUERY_COUNT];
-    extern double simulateTimePercentage[SIMULATE_TIME_QUERY_COUNT];
-
     int performanceLogInit();
     int performanceLogTerminate();
-    void queryTime(unsigned int index);
+    // picks up the totals of the latest profiled frame
     void calculateTime();
+    // the records below the first record named rootName, indented by depth
+    void outputProfileRecords(std::ostream& os, const std::string& rootName);
     void outputRenderPerformance(std::ostream& os);
     void outputSimulatePerformance(std::ostream& os);
+    // estimated size of every tracked buffer and texture, totals per owner
+    void outputGPUMemory(std::ostream& os);
     void outputPerformance(std::ostream& os);
+    // extra sections printed after the profile records, for statistics that common does not know about
+    void addPerformanceLogSection(const std::function<void(std::ostream&)>& outputSection);
     void printPerformanceToConsole();
     void printPerformanceToFile();
 
     unsigned int getFrameCount();
+    // the frame the current timings were measured in, a few frames behind getFrameCount()
+    unsigned int getTimedFrameCount();
+    // closes the profiled frame, call once at the end of each frame
     void updateFrameCount();
 
     std::string getSupplementarySymbol(char symbol);
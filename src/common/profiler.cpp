@@ -0,0 +1,314 @@
+#include "profiler.hpp"
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <map>
+#include <utility>
+
+namespace common {
+    const unsigned int NO_QUERY = ~0u;
+    const double MILLISECONDS_SCALER = 1e-6;
+
+    struct ScopeEntry {
+        const char* name;
+        unsigned int parent;
+        double cpuBegin;
+        double cpuEnd;
+        // indices into the query pool of the frame, NO_QUERY for CPU only scopes
+        unsigned int beginQuery;
+        unsigned int endQuery;
+    };
+
+    struct ProfileFrame {
+        unsigned int frameCount;
+        // milliseconds since profilerInit()
+        double cpuStart;
+        bool pending;
+        std::vector<ScopeEntry> scopes;
+        // grows to the largest number of queries a frame ever needed and is reused afterwards
+        std::vector<GLuint> queries;
+        unsigned int queryCount;
+    };
+
+    ProfileFrame profileFrames[PROFILE_FRAME_COUNT];
+    unsigned int writeFrame = 0;
+    unsigned int readFrame = 0;
+    unsigned int profilerFrameCount = 0;
+    bool frameOpen = false;
+    bool gpuTimerEnabled = true;
+    std::vector<unsigned int> openScopes;
+    std::chrono::steady_clock::time_point frameStartTime;
+    // both clocks read at the same moment in profilerInit(), used to put GPU timestamps on the CPU timeline
+    std::chrono::steady_clock::time_point profilerStartTime;
+    GLint64 profilerStartTimestamp = 0;
+
+    std::vector<ProfileRecord> profileRecords;
+    std::vector<ProfileEvent> profileEvents;
+    unsigned int profiledFrameCount = 0;
+
+    double getCPUTime() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStartTime).count();
+    }
+
+    unsigned int allocateQuery(ProfileFrame& frame) {
+        if (frame.queryCount == frame.queries.size()) {
+            GLuint query;
+            glGenQueries(1, &query);
+            frame.queries.push_back(query);
+        }
+        return frame.queryCount++;
+    }
+
+    unsigned int beginScope(const char* name, bool gpu) {
+        ProfileFrame& frame = profileFrames[writeFrame];
+
+        ScopeEntry scope;
+        scope.name = name;
+        scope.parent = openScopes.empty() ? PROFILE_NO_PARENT : openScopes.back();
+        scope.cpuBegin = getCPUTime();
+        scope.cpuEnd = scope.cpuBegin;
+        scope.beginQuery = NO_QUERY;
+        scope.endQuery = NO_QUERY;
+        if (gpu && gpuTimerEnabled) {
+            scope.beginQuery = allocateQuery(frame);
+            scope.endQuery = allocateQuery(frame);
+            glQueryCounter(frame.queries[scope.beginQuery], GL_TIMESTAMP);
+        }
+
+        frame.scopes.push_back(scope);
+        unsigned int scopeIndex = static_cast<unsigned int>(frame.scopes.size() - 1);
+        openScopes.push_back(scopeIndex);
+
+        return scopeIndex;
+    }
+
+    void endScope(unsigned int scopeIndex) {
+        ProfileFrame& frame = profileFrames[writeFrame];
+        ScopeEntry& scope = frame.scopes[scopeIndex];
+        if (scope.endQuery != NO_QUERY) {
+            glQueryCounter(frame.queries[scope.endQuery], GL_TIMESTAMP);
+        }
+        scope.cpuEnd = getCPUTime();
+        openScopes.pop_back();
+    }
+
+    bool isFrameAvailable(const ProfileFrame& frame) {
+        for (unsigned int i = 0; i < frame.queryCount; i++) {
+            GLint available = GL_FALSE;
+            glGetQueryObjectiv(frame.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available == GL_FALSE) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void resolveFrame(const ProfileFrame& frame) {
+        std::vector<GLuint64> timestamps(frame.queryCount);
+        for (unsigned int i = 0; i < frame.queryCount; i++) {
+            glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+        }
+        // the root scope has GPU queries whenever any scope has, every GPU time is relative to its begin
+        GLuint64 frameBegin = timestamps.empty() ? 0 : timestamps[frame.scopes[0].beginQuery];
+
+        profileRecords.clear();
+        std::vector<unsigned int> recordOfScope(frame.scopes.size());
+        std::map<std::pair<unsigned int, std::string>, unsigned int> recordOfName;
+        for (unsigned int i = 0; i < frame.scopes.size(); i++) {
+            const ScopeEntry& scope = frame.scopes[i];
+            unsigned int parent = scope.parent == PROFILE_NO_PARENT ? PROFILE_NO_PARENT : recordOfScope[scope.parent];
+            bool hasGPUTime = scope.beginQuery != NO_QUERY;
+            double gpuStart = hasGPUTime ? static_cast<double>(timestamps[scope.beginQuery] - frameBegin) * MILLISECONDS_SCALER : 0.0;
+            double gpuTime = hasGPUTime ? static_cast<double>(timestamps[scope.endQuery] - timestamps[scope.beginQuery]) * MILLISECONDS_SCALER : 0.0;
+
+            auto key = std::make_pair(parent, std::string(scope.name));
+            auto it = recordOfName.find(key);
+            if (it != recordOfName.end()) {
+                ProfileRecord& record = profileRecords[it->second];
+                record.callCount++;
+                record.cpuTime += scope.cpuEnd - scope.cpuBegin;
+                record.gpuTime += gpuTime;
+                recordOfScope[i] = it->second;
+                continue;
+            }
+
+            ProfileRecord record;
+            record.name = scope.name;
+            record.parent = parent;
+            record.depth = parent == PROFILE_NO_PARENT ? 0 : profileRecords[parent].depth + 1;
+            record.callCount = 1;
+            record.cpuStart = scope.cpuBegin;
+            record.cpuTime = scope.cpuEnd - scope.cpuBegin;
+            record.gpuStart = gpuStart;
+            record.gpuTime = gpuTime;
+            record.hasGPUTime = hasGPUTime;
+            profileRecords.push_back(record);
+
+            recordOfScope[i] = static_cast<unsigned int>(profileRecords.size() - 1);
+            recordOfName.emplace(key, recordOfScope[i]);
+        }
+
+        profiledFrameCount = frame.frameCount;
+
+        std::vector<unsigned int> depthOfScope(frame.scopes.size());
+        for (unsigned int i = 0; i < frame.scopes.size(); i++) {
+            const ScopeEntry& scope = frame.scopes[i];
+            depthOfScope[i] = scope.parent == PROFILE_NO_PARENT ? 0 : depthOfScope[scope.parent] + 1;
+
+            ProfileEvent event;
+            event.name = scope.name;
+            event.frameCount = frame.frameCount;
+            event.depth = depthOfScope[i];
+            event.cpuBegin = frame.cpuStart + scope.cpuBegin;
+            event.cpuEnd = frame.cpuStart + scope.cpuEnd;
+            event.hasGPUTime = scope.beginQuery != NO_QUERY;
+            event.gpuBegin = event.hasGPUTime ? static_cast<double>(static_cast<GLint64>(timestamps[scope.beginQuery]) - profilerStartTimestamp) * MILLISECONDS_SCALER : 0.0;
+            event.gpuEnd = event.hasGPUTime ? static_cast<double>(static_cast<GLint64>(timestamps[scope.endQuery]) - profilerStartTimestamp) * MILLISECONDS_SCALER : 0.0;
+            profileEvents.push_back(event);
+        }
+    }
+
+    int profilerInit(bool gpuTimer) {
+        for (unsigned int i = 0; i < PROFILE_FRAME_COUNT; i++) {
+            profileFrames[i].pending = false;
+            profileFrames[i].scopes.clear();
+            profileFrames[i].queryCount = 0;
+        }
+        writeFrame = 0;
+        readFrame = 0;
+        frameOpen = false;
+        openScopes.clear();
+        profileRecords.clear();
+        profileEvents.clear();
+
+        gpuTimerEnabled = gpuTimer;
+        profilerStartTime = std::chrono::steady_clock::now();
+        profilerStartTimestamp = 0;
+        if (gpuTimerEnabled) {
+            glGetInteger64v(GL_TIMESTAMP, &profilerStartTimestamp);
+        }
+
+        return 0;
+    }
+
+    int profilerTerminate() {
+        for (unsigned int i = 0; i < PROFILE_FRAME_COUNT; i++) {
+            if (!profileFrames[i].queries.empty()) {
+                glDeleteQueries(static_cast<GLsizei>(profileFrames[i].queries.size()), profileFrames[i].queries.data());
+            }
+            profileFrames[i].queries.clear();
+            profileFrames[i].scopes.clear();
+            profileFrames[i].queryCount = 0;
+            profileFrames[i].pending = false;
+        }
+        frameOpen = false;
+        openScopes.clear();
+
+        return 0;
+    }
+
+    void profilerBeginFrame() {
+        #ifdef ENABLE_PROFILER
+        ProfileFrame& frame = profileFrames[writeFrame];
+        if (frame.pending) {
+            // the GPU is PROFILE_FRAME_COUNT frames behind, drop the oldest frame instead of waiting for it
+            frame.pending = false;
+            readFrame = (writeFrame + 1) % PROFILE_FRAME_COUNT;
+        }
+        frame.scopes.clear();
+        frame.queryCount = 0;
+        frame.frameCount = profilerFrameCount;
+
+        frameStartTime = std::chrono::steady_clock::now();
+        frame.cpuStart = std::chrono::duration<double, std::milli>(frameStartTime - profilerStartTime).count();
+        openScopes.clear();
+        frameOpen = true;
+        beginScope("frame", true);
+        #endif
+    }
+
+    void profilerEndFrame() {
+        #ifdef ENABLE_PROFILER
+        if (!frameOpen) {
+            return;
+        }
+        while (!openScopes.empty()) {
+            endScope(openScopes.back());
+        }
+        frameOpen = false;
+        profileEvents.clear();
+        profileFrames[writeFrame].pending = true;
+        writeFrame = (writeFrame + 1) % PROFILE_FRAME_COUNT;
+        profilerFrameCount++;
+
+        // drain every finished frame, the newest one wins
+        while (profileFrames[readFrame].pending && isFrameAvailable(profileFrames[readFrame])) {
+            resolveFrame(profileFrames[readFrame]);
+            profileFrames[readFrame].pending = false;
+            readFrame = (readFrame + 1) % PROFILE_FRAME_COUNT;
+        }
+        #endif
+    }
+
+    const std::vector<ProfileRecord>& getProfileRecords() {
+        return profileRecords;
+    }
+
+    unsigned int getProfiledFrameCount() {
+        return profiledFrameCount;
+    }
+
+    const std::vector<ProfileEvent>& getProfileEvents() {
+        return profileEvents;
+    }
+
+    const ProfileRecord* findProfileRecord(const std::string& name) {
+        for (const ProfileRecord& record : profileRecords) {
+            if (record.name == name) {
+                return &record;
+            }
+        }
+
+        return nullptr;
+    }
+
+    double getProfileRecordTime(const ProfileRecord& record) {
+        return record.hasGPUTime ? record.gpuTime : record.cpuTime;
+    }
+
+    void appendProfileSubtree(unsigned int recordIndex, std::vector<unsigned int>& subtree) {
+        subtree.push_back(recordIndex);
+        for (unsigned int i = recordIndex + 1; i < profileRecords.size(); i++) {
+            if (profileRecords[i].parent == recordIndex) {
+                appendProfileSubtree(i, subtree);
+            }
+        }
+    }
+
+    std::vector<unsigned int> getProfileSubtree(const std::string& rootName) {
+        std::vector<unsigned int> subtree;
+        for (unsigned int i = 0; i < profileRecords.size(); i++) {
+            if (profileRecords[i].name == rootName) {
+                appendProfileSubtree(i, subtree);
+                break;
+            }
+        }
+
+        return subtree;
+    }
+
+    ProfileScope::ProfileScope(const char* name, bool gpu) : m_scopeIndex(NO_QUERY) {
+        if (frameOpen) {
+            m_scopeIndex = beginScope(name, gpu);
+        }
+    }
+
+    ProfileScope::~ProfileScope() {
+        // a scope opened outside of a frame, or one that outlived profilerEndFrame(), is ignored
+        if (m_scopeIndex != NO_QUERY && frameOpen && !openScopes.empty() && openScopes.back() == m_scopeIndex) {
+            endScope(m_scopeIndex);
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+// comment out to compile every PROFILE_GPU / PROFILE_CPU scope away
+#define ENABLE_PROFILER
+
+#include <string>
+#include <vector>
+
+namespace common {
+    // GPU results of a frame arrive this many frames late at most, older frames in flight are dropped
+    const unsigned int PROFILE_FRAME_COUNT = 4;
+    const unsigned int PROFILE_NO_PARENT = ~0u;
+
+    // one node of the profile tree of a finished frame,
+    // scopes with the same name under the same parent (e.g. solver iterations) are merged into one record
+    struct ProfileRecord {
+        std::string name;
+        unsigned int parent;
+        unsigned int depth;
+        unsigned int callCount;
+        // milliseconds, start times are relative to the start of the frame and belong to the first call
+        double cpuStart;
+        double cpuTime;
+        double gpuStart;
+        double gpuTime;
+        bool hasGPUTime;
+    };
+
+    // one call of a scope, times are milliseconds since profilerInit(),
+    // GPU timestamps are shifted onto the CPU clock so both can be laid out on one timeline
+    struct ProfileEvent {
+        const char* name;
+        unsigned int frameCount;
+        unsigned int depth;
+        double cpuBegin;
+        double cpuEnd;
+        double gpuBegin;
+        double gpuEnd;
+        bool hasGPUTime;
+    };
+
+    // without gpuTimer PROFILE_GPU scopes are timed on the CPU only and the profiler makes no OpenGL calls
+    int profilerInit(bool gpuTimer = true);
+    int profilerTerminate();
+
+    // the whole frame is the root scope "frame"
+    void profilerBeginFrame();
+    // closes the frame and picks up every older frame whose GPU results are available, never waits for the GPU
+    void profilerEndFrame();
+
+    // the latest frame with complete results, records are in call order so a parent precedes its children
+    const std::vector<ProfileRecord>& getProfileRecords();
+    unsigned int getProfiledFrameCount();
+    // every call of every scope in the frames resolved by the last profilerEndFrame(), oldest frame first
+    const std::vector<ProfileEvent>& getProfileEvents();
+    // first record with this name in the latest frame, nullptr if there is none
+    const ProfileRecord* findProfileRecord(const std::string& name);
+    // GPU time of a record, CPU time for scopes that were timed on the CPU only
+    double getProfileRecordTime(const ProfileRecord& record);
+    // indices of the first record with this name and all records below it, depth first, empty if there is none
+    std::vector<unsigned int> getProfileSubtree(const std::string& rootName);
+
+    // times a scope on the CPU, and on the GPU with a pair of timestamp queries if gpu is set,
+    // name is kept as a pointer so it has to be a string literal
+    class ProfileScope {
+        public:
+            ProfileScope(const char* name, bool gpu);
+            ~ProfileScope();
+
+            ProfileScope(const ProfileScope&) = delete;
+            ProfileScope& operator=(const ProfileScope&) = delete;
+
+        private:
+            unsigned int m_scopeIndex;
+    };
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_GPU(name) common::ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, true)
+#define PROFILE_CPU(name) common::ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, false)
+#else
+#define PROFILE_GPU(name)
+#define PROFILE_CPU(name)
+#endif
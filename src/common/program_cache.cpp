@@ -0,0 +1,191 @@
+#include "program_cache.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace common {
+    std::string programCacheDirectory = "shader_cache";
+    unsigned int programCacheHitCount = 0;
+    unsigned int programCacheMissCount = 0;
+
+    // 64 bit FNV-1a, folded over the data after the previous hash
+    uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    uint64_t hashString(uint64_t hash, const std::string& text) {
+        // the terminator keeps ("ab", "c") and ("a", "bc") apart
+        return hashBytes(hash, text.c_str(), text.size() + 1);
+    }
+
+    std::string getDriverString() {
+        std::string driver;
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION}) {
+            const GLubyte* value = glGetString(name);
+            driver += value ? reinterpret_cast<const char*>(value) : "";
+            driver += "\n";
+        }
+        return driver;
+    }
+
+    // drivers without any binary format, e.g. some Mesa builds without a shader cache, never hit
+    bool isProgramCacheEnabled() {
+        if (programCacheDirectory.empty()) {
+            return false;
+        }
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        return formatCount > 0;
+    }
+
+    // instances sharing a cache directory each write their own temporary file
+    std::string getProgramCacheTemporaryFileName(const std::string& fileName) {
+        #ifdef _WIN32
+        int processId = _getpid();
+        #else
+        int processId = static_cast<int>(getpid());
+        #endif
+        return fileName + "." + std::to_string(processId) + ".tmp";
+    }
+
+    std::string getProgramCacheFileName(uint64_t key) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+        return (std::filesystem::path(programCacheDirectory) / name).string();
+    }
+
+    uint64_t getProgramCacheKey(const std::vector<std::string>& sources) {
+        uint64_t key = hashString(14695981039346656037ull, getDriverString());
+        for (const std::string& source : sources) {
+            key = hashString(key, source);
+        }
+        return key;
+    }
+
+    GLuint loadProgramBinary(uint64_t key) {
+        if (!isProgramCacheEnabled()) {
+            return 0;
+        }
+
+        std::string fileName = getProgramCacheFileName(key);
+        FILE* file = std::fopen(fileName.c_str(), "rb");
+        if (!file) {
+            programCacheMissCount++;
+            return 0;
+        }
+        ProgramCacheHeader header;
+        std::vector<char> binary;
+        std::error_code error;
+        uintmax_t fileSize = std::filesystem::file_size(fileName, error);
+        bool read = !error
+            && std::fread(&header, sizeof(header), 1, file) == 1
+            && std::memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic)) == 0
+            && header.version == PROGRAM_CACHE_VERSION
+            && header.key == key
+            // the size comes from the file, a damaged one must not decide how much is allocated
+            && header.binarySize > 0
+            && header.binarySize <= static_cast<uint64_t>(INT32_MAX)
+            && header.binarySize == fileSize - sizeof(header);
+        if (read) {
+            binary.resize(static_cast<size_t>(header.binarySize));
+            read = std::fread(binary.data(), 1, binary.size(), file) == binary.size();
+        }
+        std::fclose(file);
+
+        GLuint program = 0;
+        if (read) {
+            program = glCreateProgram();
+            glProgramBinary(program, header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+            GLint success = 0;
+            glGetProgramiv(program, GL_LINK_STATUS, &success);
+            if (!success) {
+                glDeleteProgram(program);
+                program = 0;
+            }
+        }
+        if (program == 0) {
+            // stale or damaged, the compiled program replaces it
+            std::remove(fileName.c_str());
+            programCacheMissCount++;
+            return 0;
+        }
+
+        programCacheHitCount++;
+        return program;
+    }
+
+    void prepareProgramBinary(GLuint program) {
+        if (isProgramCacheEnabled()) {
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+    }
+
+    int storeProgramBinary(uint64_t key, GLuint program) {
+        if (!isProgramCacheEnabled()) {
+            return 0;
+        }
+
+        GLint binarySize = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+        if (binarySize <= 0) {
+            return -1;
+        }
+        ProgramCacheHeader header = {};
+        std::memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic));
+        header.version = PROGRAM_CACHE_VERSION;
+        header.key = key;
+        std::vector<char> binary(static_cast<size_t>(binarySize));
+        GLenum binaryFormat = 0;
+        GLsizei length = 0;
+        glGetProgramBinary(program, binarySize, &length, &binaryFormat, binary.data());
+        header.binaryFormat = binaryFormat;
+        header.binarySize = static_cast<uint64_t>(length);
+
+        std::error_code error;
+        std::filesystem::create_directories(programCacheDirectory, error);
+        if (error) {
+            std::cerr << "cannot create shader cache directory " << programCacheDirectory << ": " << error.message() << std::endl;
+            return -1;
+        }
+
+        // renamed into place, a program loading the same key never reads a half written file
+        std::string fileName = getProgramCacheFileName(key);
+        std::string temporaryFileName = getProgramCacheTemporaryFileName(fileName);
+        FILE* file = std::fopen(temporaryFileName.c_str(), "wb");
+        if (!file) {
+            std::cerr << "cannot open shader cache file: " << temporaryFileName << std::endl;
+            return -1;
+        }
+        bool written = std::fwrite(&header, sizeof(header), 1, file) == 1
+            && std::fwrite(binary.data(), 1, static_cast<size_t>(length), file) == static_cast<size_t>(length);
+        written = std::fclose(file) == 0 && written;
+        if (!written) {
+            std::cerr << "failed to write shader cache file: " << temporaryFileName << std::endl;
+            std::remove(temporaryFileName.c_str());
+            return -1;
+        }
+
+        // rename does not replace an existing file on Windows
+        std::remove(fileName.c_str());
+        if (std::rename(temporaryFileName.c_str(), fileName.c_str()) != 0) {
+            std::remove(temporaryFileName.c_str());
+            return -1;
+        }
+
+        return 0;
+    }
+}
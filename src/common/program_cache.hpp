@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace common {
+    // Linked programs are stored with glGetProgramBinary and loaded back with glProgramBinary,
+    // which skips compiling and linking GLSL on the next start. The key hashes every stage's source
+    // after the defines were injected together with the driver strings, so editing a shader,
+    // changing a define or updating the driver each miss the cache and compile again.
+    struct ProgramCacheHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t binaryFormat;
+        uint64_t key;
+        uint64_t binarySize;
+    };
+
+    const char PROGRAM_CACHE_MAGIC[8] = "PBFPROG";
+    const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+    // empty disables the cache, relative paths are relative to the working directory like the shaders
+    extern std::string programCacheDirectory;
+    extern unsigned int programCacheHitCount;
+    extern unsigned int programCacheMissCount;
+
+    uint64_t getProgramCacheKey(const std::vector<std::string>& sources);
+    // a linked program, 0 if the key is not cached or the driver rejects the binary
+    GLuint loadProgramBinary(uint64_t key);
+    // call before glLinkProgram so the driver keeps the binary around
+    void prepareProgramBinary(GLuint program);
+    // program has to be linked successfully
+    int storeProgramBinary(uint64_t key, GLuint program);
+}
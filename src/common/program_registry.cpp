@@ -0,0 +1,57 @@
+#include "program_registry.hpp"
+
+#include <map>
+
+namespace common {
+    // the registry only observes the programs, the owners' shared pointers keep them alive
+    std::map<std::string, std::weak_ptr<Shader>> sharedShaders;
+    std::map<std::string, std::weak_ptr<ComputeShader>> sharedComputeShaders;
+    unsigned int sharedProgramReuseCount = 0;
+
+    template <typename Program, typename Create>
+    std::shared_ptr<Program> acquireProgram(std::map<std::string, std::weak_ptr<Program>>& programs, const std::string& key, Create create) {
+        auto it = programs.find(key);
+        if (it != programs.end()) {
+            if (std::shared_ptr<Program> program = it->second.lock()) {
+                sharedProgramReuseCount++;
+                return program;
+            }
+        }
+
+        std::shared_ptr<Program> program(create(), [&programs, key](Program* released) {
+            glDeleteProgram(released->ID);
+            delete released;
+            auto entry = programs.find(key);
+            if (entry != programs.end() && entry->second.expired()) {
+                programs.erase(entry);
+            }
+        });
+        programs[key] = program;
+        return program;
+    }
+
+    std::shared_ptr<Shader> acquireShader(const std::string& vertexPath, const std::string& fragmentPath) {
+        return acquireProgram(sharedShaders, vertexPath + "\n" + fragmentPath, [&]() {
+            return new Shader(vertexPath.c_str(), fragmentPath.c_str());
+        });
+    }
+
+    std::shared_ptr<ComputeShader> acquireComputeShader(const std::string& computePath,
+                                                        const std::vector<std::pair<std::string, std::string>>& defines) {
+        std::string key = computePath;
+        for (const auto& define : defines) {
+            key += "\n" + define.first + " " + define.second;
+        }
+        return acquireProgram(sharedComputeShaders, key, [&]() {
+            return new ComputeShader(computePath.c_str(), defines);
+        });
+    }
+
+    size_t getSharedProgramCount() {
+        return sharedShaders.size() + sharedComputeShaders.size();
+    }
+
+    unsigned int getSharedProgramReuseCount() {
+        return sharedProgramReuseCount;
+    }
+}
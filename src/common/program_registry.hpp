@@ -0,0 +1,23 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "shader.hpp"
+#include "compute_shader.hpp"
+
+namespace common {
+    // Programs shared by every pass built from the same files and defines. The first acquire compiles
+    // the program, or loads it from the program cache, later ones get the same object,
+    // and the program is deleted when its last owner releases it.
+    // Owners set the uniforms they need before every use, a shared program keeps no state of its own.
+    std::shared_ptr<Shader> acquireShader(const std::string& vertexPath, const std::string& fragmentPath);
+    std::shared_ptr<ComputeShader> acquireComputeShader(const std::string& computePath,
+                                                        const std::vector<std::pair<std::string, std::string>>& defines = {});
+
+    // programs alive right now, and how many acquires were served without compiling
+    size_t getSharedProgramCount();
+    unsigned int getSharedProgramReuseCount();
+}
@@ -0,0 +1,132 @@
+#include "scan.hpp"
+#include "gpu_memory.hpp"
+
+#include <cstring>
+
+#ifndef GL_SUBGROUP_SIZE_KHR
+#define GL_SUBGROUP_SIZE_KHR 0x9532
+#define GL_SUBGROUP_SUPPORTED_STAGES_KHR 0x9533
+#define GL_SUBGROUP_SUPPORTED_FEATURES_KHR 0x9534
+#define GL_SUBGROUP_FEATURE_ARITHMETIC_BIT_KHR 0x00000004
+#endif
+
+namespace common {
+    // binding points reserved for the scan, above the ones used by the simulator and renderer
+    const GLuint SCAN_INPUT_BINDING = 21;
+    const GLuint SCAN_OUTPUT_BINDING = 22;
+    const GLuint SCAN_BLOCK_SUM_BINDING = 23;
+
+    const GLuint SCAN_BLOCK_SIZE = 512;
+
+    bool hasExtension(const char* name) {
+        GLint extensionCount = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+        for (GLint i = 0; i < extensionCount; i++) {
+            const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (extension && std::strcmp(extension, name) == 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool isSubgroupScanSupported() {
+        if (!hasExtension("GL_KHR_shader_subgroup")) {
+            return false;
+        }
+        GLint subgroupSize = 0;
+        GLint supportedStages = 0;
+        GLint supportedFeatures = 0;
+        glGetIntegerv(GL_SUBGROUP_SIZE_KHR, &subgroupSize);
+        glGetIntegerv(GL_SUBGROUP_SUPPORTED_STAGES_KHR, &supportedStages);
+        glGetIntegerv(GL_SUBGROUP_SUPPORTED_FEATURES_KHR, &supportedFeatures);
+
+        // scanBlockSubgroup.comp keeps one shared slot per subgroup, 64 slots cover subgroups of 4 and up
+        return subgroupSize >= 4 &&
+               (supportedStages & GL_COMPUTE_SHADER_BIT) &&
+               (supportedFeatures & GL_SUBGROUP_FEATURE_ARITHMETIC_BIT_KHR);
+    }
+
+    ExclusiveScan::ExclusiveScan() {
+        m_useSubgroup = isSubgroupScanSupported();
+        if (m_useSubgroup) {
+            m_scanBlockCS = ComputeShader("src/common/shader/scan/scanBlockSubgroup.comp");
+        }
+        else {
+            m_scanBlockCS = ComputeShader("src/common/shader/scan/scanBlock.comp");
+        }
+        m_addBlockOffsetCS = ComputeShader("src/common/shader/scan/addBlockOffset.comp");
+    }
+
+    ExclusiveScan::~ExclusiveScan() {
+        gpuDeleteBuffers(static_cast<GLsizei>(m_blockSumBuffers.size()), m_blockSumBuffers.data());
+        glDeleteProgram(m_scanBlockCS.ID);
+        glDeleteProgram(m_addBlockOffsetCS.ID);
+    }
+
+    int ExclusiveScan::scan(GLuint inputBuffer, GLuint outputBuffer, GLuint count) {
+        // one more output than input, the missing last input counts as 0 and its offset is the total
+        scanLevel(inputBuffer, outputBuffer, count, count + 1, 0);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCAN_INPUT_BINDING, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCAN_OUTPUT_BINDING, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCAN_BLOCK_SUM_BINDING, 0);
+
+        return 0;
+    }
+
+    bool ExclusiveScan::isUsingSubgroup() const {
+        return m_useSubgroup;
+    }
+
+    int ExclusiveScan::scanLevel(GLuint inputBuffer, GLuint outputBuffer, GLuint inputCount, GLuint outputCount, unsigned int level) {
+        GLuint blockCount = (outputCount + SCAN_BLOCK_SIZE - 1) / SCAN_BLOCK_SIZE;
+        GLuint blockSumBuffer = getBlockSumBuffer(level, blockCount);
+
+        m_scanBlockCS.use();
+        m_scanBlockCS.setUint("uInputCount", inputCount);
+        m_scanBlockCS.setUint("uOutputCount", outputCount);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCAN_INPUT_BINDING, inputBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCAN_OUTPUT_BINDING, outputBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCAN_BLOCK_SUM_BINDING, blockSumBuffer);
+
+        glDispatchCompute(blockCount, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        if (blockCount == 1) {
+            return 0;
+        }
+
+        // block sums become block offsets in place
+        scanLevel(blockSumBuffer, blockSumBuffer, blockCount, blockCount, level + 1);
+
+        m_addBlockOffsetCS.use();
+        m_addBlockOffsetCS.setUint("uOutputCount", outputCount);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCAN_OUTPUT_BINDING, outputBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCAN_BLOCK_SUM_BINDING, blockSumBuffer);
+
+        m_addBlockOffsetCS.dispatchCompute(outputCount);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        return 0;
+    }
+
+    GLuint ExclusiveScan::getBlockSumBuffer(unsigned int level, GLuint blockCount) {
+        if (level >= m_blockSumBuffers.size()) {
+            GLuint buffer;
+            glGenBuffers(1, &buffer);
+            m_blockSumBuffers.push_back(buffer);
+            m_blockSumCapacities.push_back(0);
+        }
+        if (m_blockSumCapacities[level] < blockCount) {
+            GPUMemoryOwner gpuMemoryOwner("scan");
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_blockSumBuffers[level]);
+            gpuBufferData(GL_SHADER_STORAGE_BUFFER, blockCount * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            m_blockSumCapacities[level] = blockCount;
+        }
+
+        return m_blockSumBuffers[level];
+    }
+}
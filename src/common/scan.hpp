@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include "compute_shader.hpp"
+
+namespace common {
+    // Exclusive prefix sum over a buffer of uint on the GPU.
+    // Every workgroup scans a block of 512 elements with a work-efficient (Blelloch) scan in shared memory,
+    // or with subgroup operations when the driver has GL_KHR_shader_subgroup,
+    // then the block sums are scanned the same way and added back, one level per 512x more elements.
+    class ExclusiveScan {
+        public:
+            ExclusiveScan();
+            ~ExclusiveScan();
+
+            ExclusiveScan(const ExclusiveScan&) = delete;
+            ExclusiveScan& operator=(const ExclusiveScan&) = delete;
+
+            // output[i] = input[0] + ... + input[i - 1] for i in [0, count],
+            // so output holds count + 1 uints and its last element is the total
+            // input and output may be the same buffer
+            int scan(GLuint inputBuffer, GLuint outputBuffer, GLuint count);
+
+            bool isUsingSubgroup() const;
+
+        private:
+            ComputeShader m_scanBlockCS;
+            ComputeShader m_addBlockOffsetCS;
+            bool m_useSubgroup;
+
+            // block sums of every level, grown on demand
+            std::vector<GLuint> m_blockSumBuffers;
+            std::vector<GLuint> m_blockSumCapacities;
+
+            int scanLevel(GLuint inputBuffer, GLuint outputBuffer, GLuint inputCount, GLuint outputCount, unsigned int level);
+            GLuint getBlockSumBuffer(unsigned int level, GLuint blockCount);
+    };
+}
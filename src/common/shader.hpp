@@ -9,10 +9,13 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <string>
+#include <unordered_map>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+#include "program_cache.hpp"
+
 class Shader
 {
 public:
@@ -62,7 +65,14 @@ public:
         }
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
+        // 2. a program linked by an earlier run skips compiling
+        uint64_t cacheKey = common::getProgramCacheKey({vertexCode, fragmentCode});
+        ID = common::loadProgramBinary(cacheKey);
+        if (ID != 0)
+        {
+            return;
+        }
+        // 3. compile shaders
         unsigned int vertex, fragment;
         // vertex shader
         vertex = glCreateShader(GL_VERTEX_SHADER);
@@ -78,8 +88,12 @@ public:
         ID = glCreateProgram();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
+        common::prepareProgramBinary(ID);
         glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+        if (checkCompileErrors(ID, "PROGRAM"))
+        {
+            common::storeProgramBinary(cacheKey, ID);
+        }
         // delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
@@ -94,53 +108,68 @@ public:
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(getUniformLocation(name), (int)value); 
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(getUniformLocation(name), value); 
     }
     // ------------------------------------------------------------------------
     void setUint(const std::string &name, unsigned int value) const
     {
-        glUniform1ui(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1ui(getUniformLocation(name), value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(getUniformLocation(name), value); 
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, glm::vec2 value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+        glUniform2fv(getUniformLocation(name), 1, glm::value_ptr(value));
     }
     // ------------------------------------------------------------------------
     void setIvec2(const std::string &name, glm::ivec2 value) const
     {
-        glUniform2iv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+        glUniform2iv(getUniformLocation(name), 1, glm::value_ptr(value));
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, glm::vec3 value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+        glUniform3fv(getUniformLocation(name), 1, glm::value_ptr(value));
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, glm::mat3 value) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+        glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, glm::mat4 value) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+        glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
     }
 
 private:
-    // utility function for checking shader compilation/linking errors.
+    // glGetUniformLocation is a string lookup in the driver, so every location is only queried once per program
+    mutable std::unordered_map<std::string, int> uniformLocationCache;
+
+    int getUniformLocation(const std::string& name) const
+    {
+        auto it = uniformLocationCache.find(name);
+        if (it != uniformLocationCache.end())
+        {
+            return it->second;
+        }
+        int location = glGetUniformLocation(ID, name.c_str());
+        uniformLocationCache.emplace(name, location);
+        return location;
+    }
+
+    // utility function for checking shader compilation/linking errors, true on success.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(unsigned int shader, std::string type, const std::string& filePath = "")
+    bool checkCompileErrors(unsigned int shader, std::string type, const std::string& filePath = "")
     {
         int success;
         char infoLog[1024];
@@ -167,5 +196,6 @@ private:
                           << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success != 0;
     }
 };
\ No newline at end of file
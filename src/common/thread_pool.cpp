@@ -0,0 +1,149 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+namespace common {
+    // chunks handed to every worker per parallelFor when no grain size is given
+    const size_t CHUNK_COUNT_PER_WORKER = 8;
+    const size_t MIN_GRAIN_SIZE = 64;
+
+    ThreadPool::ThreadPool(unsigned int threadCount) : m_pendingTaskCount(0), m_stop(false) {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        // the thread calling parallelFor always helps, so it counts as one of the workers
+        unsigned int workerCount = threadCount - 1;
+        // one queue per worker plus one for the submitting thread
+        for (unsigned int i = 0; i < workerCount + 1; i++) {
+            m_queues.push_back(std::make_unique<WorkerQueue>());
+        }
+        for (unsigned int i = 0; i < workerCount; i++) {
+            m_workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_stop = true;
+        }
+        m_sleepCondition.notify_all();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    unsigned int ThreadPool::getThreadCount() const {
+        return static_cast<unsigned int>(m_workers.size()) + 1;
+    }
+
+    void ThreadPool::parallelFor(size_t begin, size_t end, const std::function<void(size_t, size_t)>& body) {
+        parallelFor(begin, end, 0, body);
+    }
+
+    void ThreadPool::parallelFor(size_t begin, size_t end, size_t grainSize, const std::function<void(size_t, size_t)>& body) {
+        if (end <= begin) {
+            return;
+        }
+
+        size_t count = end - begin;
+        if (grainSize == 0) {
+            grainSize = std::max(MIN_GRAIN_SIZE, count / (getThreadCount() * CHUNK_COUNT_PER_WORKER) + 1);
+        }
+        size_t chunkCount = (count + grainSize - 1) / grainSize;
+
+        if (m_workers.empty() || chunkCount == 1) {
+            body(begin, end);
+            return;
+        }
+
+        std::atomic<size_t> remaining(chunkCount);
+        // counted before the chunks become visible so a fast thief can never drive the counter below zero
+        m_pendingTaskCount += chunkCount;
+
+        // every queue gets a contiguous, distinct run of chunks
+        unsigned int queueCount = static_cast<unsigned int>(m_queues.size());
+        for (unsigned int q = 0; q < queueCount; q++) {
+            std::lock_guard<std::mutex> lock(m_queues[q]->mutex);
+            size_t firstChunk = chunkCount * q / queueCount;
+            size_t lastChunk = chunkCount * (q + 1) / queueCount;
+            for (size_t chunk = firstChunk; chunk < lastChunk; chunk++) {
+                size_t chunkBegin = begin + chunk * grainSize;
+                size_t chunkEnd = std::min(end, chunkBegin + grainSize);
+                m_queues[q]->tasks.push_back(Task{ &body, chunkBegin, chunkEnd, &remaining });
+            }
+        }
+        {
+            // taking the lock orders the notification after any worker that is about to sleep
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+        }
+        m_sleepCondition.notify_all();
+
+        // the submitting thread owns the last queue and steals like everybody else once it is empty
+        unsigned int ownQueue = queueCount - 1;
+        Task task;
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            if (popTask(ownQueue, task) || stealTask(ownQueue, task)) {
+                runTask(task);
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void ThreadPool::workerLoop(unsigned int workerIndex) {
+        Task task;
+        while (true) {
+            if (popTask(workerIndex, task) || stealTask(workerIndex, task)) {
+                runTask(task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_sleepCondition.wait(lock, [this] {
+                return m_stop || m_pendingTaskCount.load() > 0;
+            });
+            if (m_stop) {
+                return;
+            }
+        }
+    }
+
+    bool ThreadPool::popTask(unsigned int queueIndex, Task& task) {
+        WorkerQueue& queue = *m_queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+        m_pendingTaskCount--;
+
+        return true;
+    }
+
+    bool ThreadPool::stealTask(unsigned int thiefIndex, Task& task) {
+        unsigned int queueCount = static_cast<unsigned int>(m_queues.size());
+        for (unsigned int i = 1; i < queueCount; i++) {
+            WorkerQueue& queue = *m_queues[(thiefIndex + i) % queueCount];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+            m_pendingTaskCount--;
+
+            return true;
+        }
+
+        return false;
+    }
+
+    void ThreadPool::runTask(const Task& task) {
+        (*task.body)(task.begin, task.end);
+        task.remaining->fetch_sub(1, std::memory_order_release);
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace common {
+    // Work-stealing thread pool used by the CPU simulation backend.
+    // Every worker owns a deque: it pops its own work from the back and steals from the front of the others,
+    // so chunks of a `parallelFor` stay cache-local until some worker runs dry.
+    class ThreadPool {
+        public:
+            // threadCount == 0 means one worker per hardware thread
+            explicit ThreadPool(unsigned int threadCount = 0);
+            ~ThreadPool();
+
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+
+            unsigned int getThreadCount() const;
+
+            // runs body(chunkBegin, chunkEnd) over [begin, end) and blocks until every chunk is done,
+            // the calling thread helps with the work while it waits
+            // grainSize == 0 picks a chunk size that gives every worker several chunks to steal from
+            void parallelFor(size_t begin, size_t end, size_t grainSize, const std::function<void(size_t, size_t)>& body);
+            void parallelFor(size_t begin, size_t end, const std::function<void(size_t, size_t)>& body);
+
+        private:
+            struct Task {
+                const std::function<void(size_t, size_t)>* body;
+                size_t begin;
+                size_t end;
+                std::atomic<size_t>* remaining;
+            };
+
+            struct WorkerQueue {
+                std::mutex mutex;
+                std::deque<Task> tasks;
+            };
+
+            std::vector<std::thread> m_workers;
+            std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+
+            std::mutex m_sleepMutex;
+            std::condition_variable m_sleepCondition;
+            std::atomic<size_t> m_pendingTaskCount;
+            std::atomic<bool> m_stop;
+
+            void workerLoop(unsigned int workerIndex);
+            bool popTask(unsigned int queueIndex, Task& task);
+            bool stealTask(unsigned int thiefIndex, Task& task);
+            void runTask(const Task& task);
+    };
+}
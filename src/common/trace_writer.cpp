@@ -0,0 +1,94 @@
+#include "trace_writer.hpp"
+
+#include <cstdio>
+
+namespace common {
+    const int TRACE_PROCESS_ID = 1;
+    const int TRACE_CPU_THREAD_ID = 1;
+    const int TRACE_GPU_THREAD_ID = 2;
+
+    TraceWriter::TraceWriter(const std::string& fileName) : m_file(fileName, std::ios::trunc), m_stop(false) {
+        if (!m_file) {
+            return;
+        }
+
+        m_file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+               << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << TRACE_PROCESS_ID << ",\"args\":{\"name\":\"PBF\"}},\n"
+               << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << TRACE_PROCESS_ID << ",\"tid\":" << TRACE_CPU_THREAD_ID << ",\"args\":{\"name\":\"CPU\"}},\n"
+               << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << TRACE_PROCESS_ID << ",\"tid\":" << TRACE_GPU_THREAD_ID << ",\"args\":{\"name\":\"GPU\"}}";
+        m_thread = std::thread(&TraceWriter::writerLoop, this);
+    }
+
+    TraceWriter::~TraceWriter() {
+        if (!m_thread.joinable()) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_one();
+        m_thread.join();
+
+        m_file << "\n]}\n";
+    }
+
+    bool TraceWriter::isOpen() const {
+        return m_thread.joinable();
+    }
+
+    void TraceWriter::write(const std::vector<ProfileEvent>& events) {
+        if (!isOpen() || events.empty()) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pendingEvents.push_back(events);
+        }
+        m_condition.notify_one();
+    }
+
+    void TraceWriter::writerLoop() {
+        std::deque<std::vector<ProfileEvent>> events;
+        std::string buffer;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_stop || !m_pendingEvents.empty(); });
+                if (m_pendingEvents.empty()) {
+                    return;
+                }
+                events.swap(m_pendingEvents);
+            }
+
+            // everything that piled up while the last batch was written goes out in one write
+            buffer.clear();
+            for (const std::vector<ProfileEvent>& frameEvents : events) {
+                for (const ProfileEvent& event : frameEvents) {
+                    appendEvent(buffer, event, false);
+                    if (event.hasGPUTime) {
+                        appendEvent(buffer, event, true);
+                    }
+                }
+            }
+            events.clear();
+
+            m_file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            m_file.flush();
+        }
+    }
+
+    void TraceWriter::appendEvent(std::string& buffer, const ProfileEvent& event, bool gpu) {
+        // complete events, timestamps and durations in microseconds, the metadata events come first so every event starts with a comma
+        double begin = gpu ? event.gpuBegin : event.cpuBegin;
+        double end = gpu ? event.gpuEnd : event.cpuEnd;
+
+        char line[256];
+        std::snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+            event.name, gpu ? "gpu" : "cpu", TRACE_PROCESS_ID, gpu ? TRACE_GPU_THREAD_ID : TRACE_CPU_THREAD_ID,
+            begin * 1000.0, (end - begin) * 1000.0, event.frameCount);
+        buffer += line;
+    }
+}
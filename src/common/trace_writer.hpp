@@ -0,0 +1,40 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "profiler.hpp"
+
+namespace common {
+    // Writes profile events as Chrome trace-event JSON, which chrome://tracing and ui.perfetto.dev open directly.
+    // CPU spans and GPU spans go to two tracks of one process so gaps between submission and execution show up.
+    // The caller only copies the events into a queue, formatting and file output happen on a writer thread.
+    class TraceWriter {
+        public:
+            explicit TraceWriter(const std::string& fileName);
+            // drains the queue and closes the JSON array, the file is not valid before that
+            ~TraceWriter();
+
+            TraceWriter(const TraceWriter&) = delete;
+            TraceWriter& operator=(const TraceWriter&) = delete;
+
+            bool isOpen() const;
+            void write(const std::vector<ProfileEvent>& events);
+
+        private:
+            std::ofstream m_file;
+            std::thread m_thread;
+            std::mutex m_mutex;
+            std::condition_variable m_condition;
+            std::deque<std::vector<ProfileEvent>> m_pendingEvents;
+            bool m_stop;
+
+            void writerLoop();
+            void appendEvent(std::string& buffer, const ProfileEvent& event, bool gpu);
+    };
+}
@@ -1,11 +1,16 @@
 #include "gui.hpp"
 
+#include <string>
+#include <vector>
+
 #include "../../include/imgui/imgui.h"
 #include "../../include/imgui/imgui_impl_glfw.h"
 #include "../../include/imgui/imgui_impl_opengl3.h"
 
 #include "../renderer/window.hpp"
 #include "../common/performance_log.hpp"
+#include "../common/profiler.hpp"
+#include "../common/gpu_memory.hpp"
 #include "../renderer/renderer.hpp"
 #include "../renderer/scene.hpp"
 #include "../simulator/simulator.hpp"
@@ -62,12 +67,14 @@ namespace gui {
         static bool showPerformanceMonitor = true;
         static bool showSimulatePerformance = true;
         static bool showRenderPerformance = true;
+        static bool showGPUMemory = false;
 
         ImGui::Begin("Panel Visibility");
         ImGui::Checkbox("Control Panel", &showControlPanel);
         ImGui::Checkbox("Performance Monitor", &showPerformanceMonitor);
         ImGui::Checkbox("Render Performance", &showRenderPerformance);
         ImGui::Checkbox("Simulate Performance", &showSimulatePerformance);
+        ImGui::Checkbox("GPU Memory", &showGPUMemory);
         ImGui::End();
 
         // Control Panel
@@ -187,10 +194,15 @@ namespace gui {
                     static float vorticity = simulator::vorticityParameter * 1e6f;
                     ImGui::SliderFloat("Vorticity", &vorticity, 0.0f, 1.0f);
                     simulator::vorticityParameter = vorticity * 1e-6f;
-                    static float horizonMaxCoordinate = static_cast<float>(simulator::horizonMaxCoordinate / simulator::HORIZON_MAX_COORDINATE);
+                    static float horizonMaxCoordinate = static_cast<float>(simulator::horizonMaxCoordinate / simulator::domainHorizonMaxCoordinate);
                     ImGui::SliderFloat("Horizon Max Coordinate", &horizonMaxCoordinate, 0.5f, 1.0f);
-                    simulator::horizonMaxCoordinate = horizonMaxCoordinate * simulator::HORIZON_MAX_COORDINATE;
-                    // ImGui::SliderInt("*Max Neighbor Count", &simulator::maxNeighborCount, 64, 256);
+                    simulator::horizonMaxCoordinate = horizonMaxCoordinate * simulator::domainHorizonMaxCoordinate;
+                    if (ImGui::RadioButton("Neighbor List", simulator::neighborSearchMode == simulator::NeighborSearchMode::NEIGHBOR_LIST))
+                        simulator::neighborSearchMode = simulator::NeighborSearchMode::NEIGHBOR_LIST;
+                    if (ImGui::RadioButton("Cube Iteration", simulator::neighborSearchMode == simulator::NeighborSearchMode::CUBE_ITERATION))
+                        simulator::neighborSearchMode = simulator::NeighborSearchMode::CUBE_ITERATION;
+                    ImGui::SliderInt("Reorder Interval", &simulator::reorderInterval, 0, 120);
+                    ImGui::Checkbox("Fused Lambda Kernel", &simulator::fuseLambdaKernel);
                 }
             }
 
@@ -203,6 +215,8 @@ namespace gui {
                 ImGui::Separator();
                 if (ImGui::Button("Reset")) 
                     common::resetSimulation = true;
+                if (ImGui::Button("Save Checkpoint"))
+                    common::saveCheckpoint = true;
                 if (ImGui::Button("Exit"))
                     glfwSetWindowShouldClose(renderer::window::window, true);
                 ImGui::End();
@@ -212,51 +226,122 @@ namespace gui {
         // Performance Monitor
         if (showPerformanceMonitor) {
             ImGui::Begin("Performance Monitor");
-            ImGui::Text("Particle Count: %d k", simulator::PARTICLE_COUNT / 1024);
+            ImGui::Text("Particle Count: %d k", simulator::particleCount / 1024);
             ImGui::Text("FPS: %.2f", common::fps);
             ImGui::Text("Frame Time: %.2f ms", common::totalTime);
 
             ImGui::Separator();
             ImGui::Text("Render Time: %.2f ms (%.2f %%)", common::renderTime, common::renderTime / common::totalTime * 100);
             ImGui::Text("Simulate Time: %.2f ms (%.2f %%)", common::simulateTime, common::simulateTime / common::totalTime * 100);
+
+            ImGui::Separator();
+            const simulator::NeighborStatistics& neighborStatistics = simulator::neighborStatistics;
+            if (neighborStatistics.valid) {
+                ImGui::Text("Neighbor Count: min %u / mean %.1f / max %u", neighborStatistics.minCount, neighborStatistics.meanCount, neighborStatistics.maxCount);
+                ImGui::Text("Neighbor Buffer: %u / %u (%.1f %%)", neighborStatistics.totalCount, neighborStatistics.capacity,
+                    static_cast<float>(neighborStatistics.totalCount) / neighborStatistics.capacity * 100);
+                if (neighborStatistics.totalCount > neighborStatistics.capacity) {
+                    ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Overflow: walked the cubes (%u frames so far)", neighborStatistics.overflowFrameCount);
+                }
+                else {
+                    ImGui::Text("Overflow: none (%u frames so far)", neighborStatistics.overflowFrameCount);
+                }
+
+                float histogram[simulator::NEIGHBOR_HISTOGRAM_BIN_COUNT];
+                for (unsigned int i = 0; i < simulator::NEIGHBOR_HISTOGRAM_BIN_COUNT; i++) {
+                    histogram[i] = static_cast<float>(neighborStatistics.histogram[i]);
+                }
+                std::string histogramLabel = "bin width " + std::to_string(simulator::NEIGHBOR_HISTOGRAM_BIN_WIDTH);
+                ImGui::PlotHistogram("Neighbor Histogram", histogram, simulator::NEIGHBOR_HISTOGRAM_BIN_COUNT, 0, histogramLabel.c_str(),
+                    0.0f, FLT_MAX, ImVec2(0, 60));
+            }
+            else {
+                ImGui::Text("Neighbor statistics need the GPU backend in neighbor list mode");
+            }
             ImGui::End();
         }
 
         // Render Performance
         if (showRenderPerformance) {
             ImGui::Begin("Render Performance");
-            ImGui::Text("Render Total: %.2f ms", common::renderTime);
-
-            ImGui::Separator();
-            ImGui::Text("Process Input:          %.2f ms (%.2f%%)", common::renderTimeSlice[0], common::renderTimePercentage[0]);
-            ImGui::Text("Background:             %.2f ms (%.2f%%)", common::renderTimeSlice[1], common::renderTimePercentage[1]);
-            ImGui::Text("Copy Particle Attr:     %.2f ms (%.2f%%)", common::renderTimeSlice[2], common::renderTimePercentage[2]);
-            ImGui::Text("Fluid Depth:           %.2f ms (%.2f%%)", common::renderTimeSlice[3], common::renderTimePercentage[3]);
-            ImGui::Text("Smooth Fluid Depth:    %.2f ms (%.2f%%)", common::renderTimeSlice[4], common::renderTimePercentage[4]);
-            ImGui::Text("Compute Fluid Normal:  %.2f ms (%.2f%%)", common::renderTimeSlice[5], common::renderTimePercentage[5]);
-            ImGui::Text("Fluid Thickness:       %.2f ms (%.2f%%)", common::renderTimeSlice[6], common::renderTimePercentage[6]);
-            ImGui::Text("Render Final Scene:    %.2f ms (%.2f%%)", common::renderTimeSlice[7], common::renderTimePercentage[7]);
-            ImGui::Text("Swap Buffers:          %.2f ms (%.2f%%)", common::renderTimeSlice[8], common::renderTimePercentage[8]);
+            guiDrawProfileRecords("render");
             ImGui::End();
         }
 
         // Simulate Performance
         if (showSimulatePerformance) {
             ImGui::Begin("Simulate Performance");
-            ImGui::Text("Simulate Total: %.2f ms", common::simulateTime);
+            guiDrawProfileRecords("simulate");
+            ImGui::End();
+        }
 
-            ImGui::Separator();
-            ImGui::Text("Apply External Force:      %.2f ms (%.2f%%)", common::simulateTimeSlice[0], common::simulateTimePercentage[0]);
-            ImGui::Text("Search Neighbor:           %.2f ms (%.2f%%)", common::simulateTimeSlice[1], common::simulateTimePercentage[1]);
-            ImGui::Text("Constraint Projection:     %.2f ms (%.2f%%)", common::simulateTimeSlice[2], common::simulateTimePercentage[2]);
-            ImGui::Text("Update Velocity:           %.2f ms (%.2f%%)", common::simulateTimeSlice[3], common::simulateTimePercentage[3]);
-            ImGui::Text("Vorticity Confinement:    %.2f ms (%.2f%%)", common::simulateTimeSlice[4], common::simulateTimePercentage[4]);
-            ImGui::Text("Viscosity:                %.2f ms (%.2f%%)", common::simulateTimeSlice[5], common::simulateTimePercentage[5]);
-            ImGui::Text("Handle Boundary Collision: %.2f ms (%.2f%%)", common::simulateTimeSlice[6], common::simulateTimePercentage[6]);
-            ImGui::Text("Update Particle Position:  %.2f ms (%.2f%%)", common::simulateTimeSlice[7], common::simulateTimePercentage[7]);
+        // GPU Memory
+        if (showGPUMemory) {
+            ImGui::Begin("GPU Memory");
+            guiDrawGPUMemory();
             ImGui::End();
         }
 
         return 0;
     }
+
+    int guiDrawProfileRecords(const char* rootName) {
+        const std::vector<common::ProfileRecord>& records = common::getProfileRecords();
+        std::vector<unsigned int> subtree = common::getProfileSubtree(rootName);
+        if (subtree.empty()) {
+            ImGui::Text("No data");
+            return 0;
+        }
+
+        const common::ProfileRecord& root = records[subtree[0]];
+        ImGui::Text("Total: %.2f ms", common::getProfileRecordTime(root));
+        ImGui::Separator();
+
+        for (unsigned int i = 1; i < subtree.size(); i++) {
+            const common::ProfileRecord& record = records[subtree[i]];
+            double time = common::getProfileRecordTime(record);
+            double parentTime = common::getProfileRecordTime(records[record.parent]);
+            std::string label = std::string(2 * (record.depth - root.depth - 1), ' ') + record.name;
+            if (record.callCount > 1) {
+                label += " (x" + std::to_string(record.callCount) + ")";
+            }
+            ImGui::Text("%-36s %6.2f ms (%6.2f%%)", label.c_str(), time, parentTime > 0.0 ? time / parentTime * 100 : 0.0);
+        }
+
+        return 0;
+    }
+
+    int guiDrawGPUMemory() {
+        const double MEBIBYTE = 1024.0 * 1024.0;
+        double total = common::getGPUMemoryTotal() / MEBIBYTE;
+        ImGui::Text("Total: %.2f MiB", total);
+        ImGui::Separator();
+
+        // owners are sorted by path, the records of one owner follow its summary
+        std::vector<common::GPUMemoryRecord> records = common::getGPUMemoryRecords();
+        for (const common::GPUMemorySummary& summary : common::getGPUMemorySummary()) {
+            double size = (summary.bufferSize + summary.textureSize) / MEBIBYTE;
+            std::string label = summary.owner + "##" + summary.owner;
+            bool open = ImGui::TreeNode(label.c_str(), "%-32s %8.2f MiB (%6.2f%%)  %u buffers, %u textures",
+                summary.owner.c_str(), size, total > 0.0 ? size / total * 100 : 0.0, summary.bufferCount, summary.textureCount);
+            if (!open) {
+                continue;
+            }
+            for (const common::GPUMemoryRecord& record : records) {
+                if (record.owner != summary.owner) {
+                    continue;
+                }
+                if (record.isTexture) {
+                    ImGui::Text("texture %-4u %-10s %5d x %-5d %8.2f MiB", record.id, common::getInternalFormatName(record.internalFormat),
+                        record.width, record.height, record.size / MEBIBYTE);
+                }
+                else {
+                    ImGui::Text("buffer  %-4u %-24s %8.2f MiB", record.id, "", record.size / MEBIBYTE);
+                }
+            }
+            ImGui::TreePop();
+        }
+
+        return 0;
+    }
 }
@@ -9,4 +9,6 @@ namespace gui {
     int guiTerminate();
 
     int guiDraw();
+    int guiDrawProfileRecords(const char* rootName);
+    int guiDrawGPUMemory();
 }
@@ -0,0 +1,210 @@
+#include "checkpoint.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "../simulator/simulator.hpp"
+#include "../simulator/cpuSimulator.hpp"
+
+namespace io {
+    // the vec4 arrays after the ids start on a 16 byte boundary
+    size_t getParticleIdPadding(uint32_t particleCount) {
+        return (16 - particleCount * sizeof(GLuint) % 16) % 16;
+    }
+
+    CheckpointHeader makeCheckpointHeader() {
+        CheckpointHeader header = {};
+        std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+        header.version = CHECKPOINT_VERSION;
+        header.particleCount = simulator::particleCount;
+        header.particleCountPerEdgeXZ = simulator::particleCountPerEdgeXZ;
+        header.particleCountPerEdgeY = simulator::particleCountPerEdgeY;
+        header.frameCount = simulator::simulateFrameCount;
+        header.neighborCapacity = simulator::neighborCapacity;
+        header.domainHorizonMaxCoordinate = simulator::domainHorizonMaxCoordinate;
+        header.domainMaxHeight = simulator::domainMaxHeight;
+        header.horizonMaxCoordinate = simulator::horizonMaxCoordinate;
+        header.constraintProjectionIteration = simulator::constraintProjectionIteration;
+        header.viscosityParameter = simulator::viscosityParameter;
+        header.vorticityParameter = simulator::vorticityParameter;
+        header.neighborSearchMode = static_cast<int32_t>(simulator::neighborSearchMode);
+        header.reorderInterval = simulator::reorderInterval;
+        header.fuseLambdaKernel = simulator::fuseLambdaKernel ? 1 : 0;
+        header.deltaVelocity = simulator::uDeltaVelocity;
+        return header;
+    }
+
+    int writeCheckpoint(const std::string& fileName, const CheckpointHeader& header,
+                        const GLuint* particleId, const glm::vec4* position, const glm::vec4* velocity) {
+        // written next to the target and renamed at the end, a crash while saving leaves the last checkpoint intact
+        std::string temporaryFileName = fileName + ".tmp";
+        FILE* file = std::fopen(temporaryFileName.c_str(), "wb");
+        if (!file) {
+            std::cerr << "cannot open checkpoint file: " << temporaryFileName << std::endl;
+            return -1;
+        }
+
+        const char padding[16] = {};
+        size_t count = header.particleCount;
+        bool written = std::fwrite(&header, sizeof(header), 1, file) == 1
+            && std::fwrite(particleId, sizeof(GLuint), count, file) == count
+            && std::fwrite(padding, 1, getParticleIdPadding(header.particleCount), file) == getParticleIdPadding(header.particleCount)
+            && std::fwrite(position, sizeof(glm::vec4), count, file) == count
+            && std::fwrite(velocity, sizeof(glm::vec4), count, file) == count;
+        written = std::fclose(file) == 0 && written;
+        if (!written) {
+            std::cerr << "failed to write checkpoint file: " << temporaryFileName << std::endl;
+            std::remove(temporaryFileName.c_str());
+            return -1;
+        }
+
+        // rename does not replace an existing file on Windows
+        std::remove(fileName.c_str());
+        if (std::rename(temporaryFileName.c_str(), fileName.c_str()) != 0) {
+            std::cerr << "cannot rename checkpoint file to " << fileName << std::endl;
+            return -1;
+        }
+
+        return 0;
+    }
+
+    int readCheckpoint(const std::string& fileName, Checkpoint& checkpoint) {
+        FILE* file = std::fopen(fileName.c_str(), "rb");
+        if (!file) {
+            std::cerr << "cannot open checkpoint file: " << fileName << std::endl;
+            return -1;
+        }
+
+        CheckpointHeader& header = checkpoint.header;
+        if (std::fread(&header, sizeof(header), 1, file) != 1 || std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0) {
+            std::cerr << "not a checkpoint file: " << fileName << std::endl;
+            std::fclose(file);
+            return -1;
+        }
+        if (header.version != CHECKPOINT_VERSION) {
+            std::cerr << "checkpoint version " << header.version << " is not supported, expected " << CHECKPOINT_VERSION << ": " << fileName << std::endl;
+            std::fclose(file);
+            return -1;
+        }
+        if (header.particleCount == 0) {
+            std::cerr << "checkpoint has no particles: " << fileName << std::endl;
+            std::fclose(file);
+            return -1;
+        }
+
+        size_t count = header.particleCount;
+        checkpoint.particleId.resize(count);
+        checkpoint.position.resize(count);
+        checkpoint.velocity.resize(count);
+        char padding[16];
+        bool read = std::fread(checkpoint.particleId.data(), sizeof(GLuint), count, file) == count
+            && std::fread(padding, 1, getParticleIdPadding(header.particleCount), file) == getParticleIdPadding(header.particleCount)
+            && std::fread(checkpoint.position.data(), sizeof(glm::vec4), count, file) == count
+            && std::fread(checkpoint.velocity.data(), sizeof(glm::vec4), count, file) == count;
+        std::fclose(file);
+        if (!read) {
+            std::cerr << "checkpoint file is truncated: " << fileName << std::endl;
+            return -1;
+        }
+
+        return 0;
+    }
+
+    int applyCheckpointScale(const Checkpoint& checkpoint) {
+        const CheckpointHeader& header = checkpoint.header;
+        simulator::simulationScale.particleCountPerEdgeXZ = header.particleCountPerEdgeXZ;
+        simulator::simulationScale.particleCountPerEdgeY = header.particleCountPerEdgeY;
+        simulator::simulationScale.horizonMaxCoordinate = header.domainHorizonMaxCoordinate;
+        simulator::simulationScale.maxHeight = header.domainMaxHeight;
+        // scene runs have any count, not just the per-edge product
+        simulator::simulationScale.particleCount = header.particleCount;
+
+        return 0;
+    }
+
+    int applyCheckpointParameter(const Checkpoint& checkpoint) {
+        const CheckpointHeader& header = checkpoint.header;
+        simulator::horizonMaxCoordinate = header.horizonMaxCoordinate;
+        simulator::constraintProjectionIteration = header.constraintProjectionIteration;
+        simulator::viscosityParameter = header.viscosityParameter;
+        simulator::vorticityParameter = header.vorticityParameter;
+        simulator::neighborSearchMode = static_cast<simulator::NeighborSearchMode>(header.neighborSearchMode);
+        simulator::reorderInterval = header.reorderInterval;
+        simulator::fuseLambdaKernel = header.fuseLambdaKernel != 0;
+        simulator::uDeltaVelocity = header.deltaVelocity;
+
+        return 0;
+    }
+
+    int applyCheckpointState(const Checkpoint& checkpoint) {
+        return simulator::restoreParticleState(checkpoint.position, checkpoint.velocity, checkpoint.particleId,
+                                               checkpoint.header.frameCount, checkpoint.header.neighborCapacity);
+    }
+
+    // CheckpointWriter
+    CheckpointWriter::CheckpointWriter() : m_header(), m_busy(false) {
+    }
+
+    CheckpointWriter::~CheckpointWriter() {
+        m_readback.reset();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    bool CheckpointWriter::save(const std::string& fileName) {
+        if (m_busy) {
+            return false;
+        }
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+
+        m_fileName = fileName;
+        m_header = makeCheckpointHeader();
+        m_busy = true;
+
+        if (simulator::backend == simulator::Backend::CPU) {
+            // the CPU backend never reorders, its ids are the identity
+            m_particleId.resize(simulator::particleCount);
+            for (GLuint i = 0; i < simulator::particleCount; i++) {
+                m_particleId[i] = i;
+            }
+            m_position = simulator::cpu::getParticlePosition();
+            m_velocity = simulator::cpu::getVelocity();
+            m_thread = std::thread([this]() {
+                if (writeCheckpoint(m_fileName, m_header, m_particleId.data(), m_position.data(), m_velocity.data()) == 0) {
+                    std::cout << "checkpoint of frame " << m_header.frameCount << " saved to " << m_fileName << std::endl;
+                }
+                m_busy = false;
+            });
+            return true;
+        }
+
+        if (!m_readback) {
+            m_readback = std::make_unique<ParticleReadback>(READBACK_POSITION | READBACK_VELOCITY, [this](const ParticleFrame& frame) {
+                if (writeCheckpoint(m_fileName, m_header, frame.particleId, frame.position, frame.velocity) == 0) {
+                    std::cout << "checkpoint of frame " << m_header.frameCount << " saved to " << m_fileName << std::endl;
+                }
+                m_busy = false;
+            }, 1);
+        }
+        if (!m_readback->capture(m_header.frameCount)) {
+            m_busy = false;
+            return false;
+        }
+
+        return true;
+    }
+
+    void CheckpointWriter::poll() {
+        if (m_readback) {
+            m_readback->poll();
+        }
+    }
+
+    bool CheckpointWriter::isBusy() const {
+        return m_busy;
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "particle_readback.hpp"
+
+namespace io {
+    // Checkpoint file, little endian:
+    //   CheckpointHeader
+    //   uint32 particleId[particleCount] (padded to 16 bytes), vec4 position[particleCount], vec4 velocity[particleCount]
+    // Particles are stored in GPU storage order together with their ids, so a restored run reorders,
+    // cuts neighbor lists and accumulates exactly like the one that was saved.
+    const char CHECKPOINT_MAGIC[8] = { 'P', 'B', 'F', 'C', 'K', 'P', 'T', '\0' };
+    // bump on any layout change, older files are rejected instead of misread
+    const uint32_t CHECKPOINT_VERSION = 1;
+
+    struct CheckpointHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t particleCount;
+        // scale the simulation has to be configured with before simulateInit()
+        uint32_t particleCountPerEdgeXZ;
+        uint32_t particleCountPerEdgeY;
+        uint32_t frameCount;
+        uint32_t neighborCapacity;
+        double domainHorizonMaxCoordinate;
+        double domainMaxHeight;
+        // gui parameters
+        double horizonMaxCoordinate;
+        int32_t constraintProjectionIteration;
+        float viscosityParameter;
+        float vorticityParameter;
+        int32_t neighborSearchMode;
+        int32_t reorderInterval;
+        uint32_t fuseLambdaKernel;
+        float deltaVelocity;
+        uint32_t reserved[11];
+    };
+    static_assert(sizeof(CheckpointHeader) == 128, "CheckpointHeader is part of the file format");
+
+    struct Checkpoint {
+        CheckpointHeader header;
+        std::vector<GLuint> particleId;
+        std::vector<glm::vec4> position;
+        std::vector<glm::vec4> velocity;
+    };
+
+    // header of the running simulation
+    CheckpointHeader makeCheckpointHeader();
+    int writeCheckpoint(const std::string& fileName, const CheckpointHeader& header,
+                        const GLuint* particleId, const glm::vec4* position, const glm::vec4* velocity);
+    int readCheckpoint(const std::string& fileName, Checkpoint& checkpoint);
+
+    // before configureScale()
+    int applyCheckpointScale(const Checkpoint& checkpoint);
+    // before the first gui frame, the sliders take their initial values from the simulator
+    int applyCheckpointParameter(const Checkpoint& checkpoint);
+    // after simulateInit()
+    int applyCheckpointState(const Checkpoint& checkpoint);
+
+    // Saves checkpoints without stalling the frame: the GPU state goes through a one slot readback,
+    // the CPU backend state is copied, and the file is written on another thread.
+    class CheckpointWriter {
+        public:
+            CheckpointWriter();
+            // waits for the checkpoint being written, needs the GL context and the simulator buffers
+            ~CheckpointWriter();
+
+            CheckpointWriter(const CheckpointWriter&) = delete;
+            CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+            // snapshots the state after simulate(), false if the previous checkpoint is still being written
+            bool save(const std::string& fileName);
+            // call once per frame, never waits
+            void poll();
+            bool isBusy() const;
+
+        private:
+            // created by the first GPU save, so runs that never save keep the memory
+            std::unique_ptr<ParticleReadback> m_readback;
+            // owned by the writing thread while m_busy is set
+            std::string m_fileName;
+            CheckpointHeader m_header;
+            std::vector<GLuint> m_particleId;
+            std::vector<glm::vec4> m_position;
+            std::vector<glm::vec4> m_velocity;
+            std::thread m_thread;
+            std::atomic<bool> m_busy;
+    };
+}
@@ -0,0 +1,201 @@
+#include "particle_readback.hpp"
+
+#include <iostream>
+
+#include "../simulator/simulator.hpp"
+#include "../common/gpu_memory.hpp"
+#include "../common/profiler.hpp"
+
+namespace io {
+    // fields start on a 16 byte boundary so the vec4 arrays stay aligned inside a slot
+    size_t alignField(size_t offset) {
+        return (offset + 15) & ~static_cast<size_t>(15);
+    }
+
+    ParticleReadback::ParticleReadback(unsigned int fields, Consumer consumer, unsigned int slotCount)
+        : m_fields(fields), m_particleCount(simulator::particleCount), m_consumer(std::move(consumer)),
+          m_droppedFrameCount(0), m_stop(false) {
+        m_persistent = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+
+        // particle ids always come along, without them the fields cannot be put back into initial order
+        size_t offset = 0;
+        m_particleIdOffset = offset;
+        offset = alignField(offset + m_particleCount * sizeof(GLuint));
+        m_positionOffset = offset;
+        offset = (m_fields & READBACK_POSITION) ? alignField(offset + m_particleCount * sizeof(glm::vec4)) : offset;
+        m_velocityOffset = offset;
+        offset = (m_fields & READBACK_VELOCITY) ? alignField(offset + m_particleCount * sizeof(glm::vec4)) : offset;
+        m_densityOffset = offset;
+        offset = (m_fields & READBACK_DENSITY) ? alignField(offset + m_particleCount * sizeof(float)) : offset;
+        m_slotSize = offset;
+
+        common::GPUMemoryOwner gpuMemoryOwner("readback");
+        m_slots.resize(slotCount);
+        for (Slot& slot : m_slots) {
+            glGenBuffers(1, &slot.buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, slot.buffer);
+            if (m_persistent) {
+                // coherent, so a signaled fence is all the CPU needs before reading
+                const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                common::gpuBufferStorage(GL_COPY_WRITE_BUFFER, m_slotSize, nullptr, flags);
+                slot.mapped = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, m_slotSize, flags));
+            }
+            else {
+                common::gpuBufferData(GL_COPY_WRITE_BUFFER, m_slotSize, nullptr, GL_STREAM_READ);
+                slot.data.resize(m_slotSize);
+                slot.mapped = slot.data.data();
+            }
+            slot.fence = nullptr;
+            slot.state = SlotState::FREE;
+            slot.frameCount = 0;
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        m_thread = std::thread(&ParticleReadback::consumerLoop, this);
+    }
+
+    ParticleReadback::~ParticleReadback() {
+        // a second per frame is far more than any copy takes, a lost context must not hang the exit
+        const GLuint64 DRAIN_TIMEOUT = 1000000000;
+        while (!m_inFlightSlots.empty()) {
+            if (!finishSlot(m_inFlightSlots.front(), DRAIN_TIMEOUT)) {
+                std::cerr << "ParticleReadback: frame " << m_slots[m_inFlightSlots.front()].frameCount << " never finished on the GPU" << std::endl;
+                glDeleteSync(m_slots[m_inFlightSlots.front()].fence);
+            }
+            m_inFlightSlots.pop_front();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_one();
+        m_thread.join();
+
+        for (Slot& slot : m_slots) {
+            if (m_persistent) {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, slot.buffer);
+                glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            }
+            common::gpuDeleteBuffers(1, &slot.buffer);
+        }
+    }
+
+    bool ParticleReadback::capture(unsigned int frameCount) {
+        PROFILE_GPU("captureParticle");
+
+        unsigned int slotIndex = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            while (slotIndex < m_slots.size() && m_slots[slotIndex].state != SlotState::FREE) {
+                slotIndex++;
+            }
+        }
+        if (slotIndex == m_slots.size()) {
+            m_droppedFrameCount++;
+            return false;
+        }
+
+        Slot& slot = m_slots[slotIndex];
+        // the kernels only wait for shader storage writes, the copies below read through the buffer update path
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        copyBuffer(simulator::particleIdSSBO, m_particleIdOffset, m_particleCount * sizeof(GLuint), slot);
+        if (m_fields & READBACK_POSITION) {
+            copyBuffer(simulator::particlePositionSSBO, m_positionOffset, m_particleCount * sizeof(glm::vec4), slot);
+        }
+        if (m_fields & READBACK_VELOCITY) {
+            copyBuffer(simulator::velocitySSBO, m_velocityOffset, m_particleCount * sizeof(glm::vec4), slot);
+        }
+        if (m_fields & READBACK_DENSITY) {
+            copyBuffer(simulator::densitySSBO, m_densityOffset, m_particleCount * sizeof(float), slot);
+        }
+
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.frameCount = frameCount;
+        slot.state = SlotState::IN_FLIGHT;
+        m_inFlightSlots.push_back(slotIndex);
+        // makes sure the fence reaches the GPU even if nothing else is submitted before the next poll
+        glFlush();
+
+        return true;
+    }
+
+    void ParticleReadback::poll() {
+        while (!m_inFlightSlots.empty() && finishSlot(m_inFlightSlots.front(), 0)) {
+            m_inFlightSlots.pop_front();
+        }
+    }
+
+    bool ParticleReadback::isPersistentlyMapped() const {
+        return m_persistent;
+    }
+
+    unsigned int ParticleReadback::getDroppedFrameCount() const {
+        return m_droppedFrameCount;
+    }
+
+    void ParticleReadback::copyBuffer(GLuint source, size_t offset, size_t size, const Slot& slot) {
+        glBindBuffer(GL_COPY_READ_BUFFER, source);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, slot.buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, offset, size);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    bool ParticleReadback::finishSlot(unsigned int slotIndex, GLuint64 timeout) {
+        Slot& slot = m_slots[slotIndex];
+        GLenum waitResult = glClientWaitSync(slot.fence, 0, timeout);
+        if (waitResult != GL_ALREADY_SIGNALED && waitResult != GL_CONDITION_SATISFIED) {
+            return false;
+        }
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+
+        if (!m_persistent) {
+            glBindBuffer(GL_COPY_READ_BUFFER, slot.buffer);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, 0, m_slotSize, slot.data.data());
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            slot.state = SlotState::CONSUMING;
+            m_pendingSlots.push_back(slotIndex);
+        }
+        m_condition.notify_one();
+
+        return true;
+    }
+
+    void ParticleReadback::consumerLoop() {
+        while (true) {
+            unsigned int slotIndex;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_stop || !m_pendingSlots.empty(); });
+                if (m_pendingSlots.empty()) {
+                    return;
+                }
+                slotIndex = m_pendingSlots.front();
+                m_pendingSlots.pop_front();
+            }
+
+            const Slot& slot = m_slots[slotIndex];
+            ParticleFrame frame;
+            frame.frameCount = slot.frameCount;
+            frame.particleCount = m_particleCount;
+            frame.fields = m_fields;
+            frame.particleId = reinterpret_cast<const GLuint*>(slot.mapped + m_particleIdOffset);
+            frame.position = (m_fields & READBACK_POSITION) ? reinterpret_cast<const glm::vec4*>(slot.mapped + m_positionOffset) : nullptr;
+            frame.velocity = (m_fields & READBACK_VELOCITY) ? reinterpret_cast<const glm::vec4*>(slot.mapped + m_velocityOffset) : nullptr;
+            frame.density = (m_fields & READBACK_DENSITY) ? reinterpret_cast<const float*>(slot.mapped + m_densityOffset) : nullptr;
+            m_consumer(frame);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_slots[slotIndex].state = SlotState::FREE;
+            }
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace io {
+    enum ReadbackField : unsigned int {
+        READBACK_POSITION = 1 << 0,
+        READBACK_VELOCITY = 1 << 1,
+        READBACK_DENSITY = 1 << 2,
+    };
+
+    // the consumer gets a frame two or three frames after it was captured
+    const unsigned int READBACK_SLOT_COUNT = 3;
+
+    // one captured frame, the arrays live in the readback slot and are only valid inside the consumer call
+    struct ParticleFrame {
+        unsigned int frameCount;
+        unsigned int particleCount;
+        unsigned int fields;
+        // particles are reordered on the GPU, particleId[i] is the initial index of the particle stored at i
+        const GLuint* particleId;
+        // nullptr for fields that were not requested
+        const glm::vec4* position;
+        const glm::vec4* velocity;
+        const float* density;
+    };
+
+    // Copies the simulator buffers into a ring of persistently mapped buffers guarded by fences.
+    // capture() only records the copy, poll() hands the slots the GPU has finished to a consumer thread,
+    // so the simulate/render loop never waits for the GPU or for the consumer.
+    // Without GL 4.4 / ARB_buffer_storage the slots are plain buffers read with glGetBufferSubData once their fence signaled.
+    class ParticleReadback {
+        public:
+            using Consumer = std::function<void(const ParticleFrame&)>;
+
+            ParticleReadback(unsigned int fields, Consumer consumer, unsigned int slotCount = READBACK_SLOT_COUNT);
+            // waits for the frames in flight and lets the consumer finish them
+            ~ParticleReadback();
+
+            ParticleReadback(const ParticleReadback&) = delete;
+            ParticleReadback& operator=(const ParticleReadback&) = delete;
+
+            // copies the current simulator buffers into a free slot after simulate(),
+            // returns false and drops the frame if every slot is still in flight or being consumed
+            bool capture(unsigned int frameCount);
+            // call once per frame, never waits
+            void poll();
+
+            bool isPersistentlyMapped() const;
+            unsigned int getDroppedFrameCount() const;
+
+        private:
+            enum class SlotState {
+                FREE,
+                IN_FLIGHT,
+                CONSUMING,
+            };
+
+            struct Slot {
+                GLuint buffer;
+                // mapped range of buffer, or the copy read back into data without buffer storage
+                unsigned char* mapped;
+                std::vector<unsigned char> data;
+                GLsync fence;
+                SlotState state;
+                unsigned int frameCount;
+            };
+
+            unsigned int m_fields;
+            unsigned int m_particleCount;
+            Consumer m_consumer;
+            bool m_persistent;
+            unsigned int m_droppedFrameCount;
+
+            // byte offsets of the fields inside a slot
+            size_t m_particleIdOffset;
+            size_t m_positionOffset;
+            size_t m_velocityOffset;
+            size_t m_densityOffset;
+            size_t m_slotSize;
+
+            std::vector<Slot> m_slots;
+            // slots are handed out in capture order so the consumer sees frames in order
+            std::deque<unsigned int> m_inFlightSlots;
+
+            std::thread m_thread;
+            std::mutex m_mutex;
+            std::condition_variable m_condition;
+            std::deque<unsigned int> m_pendingSlots;
+            bool m_stop;
+
+            void consumerLoop();
+            void copyBuffer(GLuint source, size_t offset, size_t size, const Slot& slot);
+            // true if the frame of the slot is on the CPU and was queued for the consumer
+            bool finishSlot(unsigned int slotIndex, GLuint64 timeout);
+    };
+}
@@ -0,0 +1,356 @@
+#include "trajectory.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../simulator/simulator.hpp"
+
+namespace io {
+    // chunks start on 8 byte boundaries so the arrays in a mapped file are aligned
+    uint64_t alignChunk(uint64_t size) {
+        return (size + 7) & ~static_cast<uint64_t>(7);
+    }
+
+    uint64_t getPositionSize(uint32_t particleCount) {
+        return alignChunk(static_cast<uint64_t>(particleCount) * 3 * sizeof(uint16_t));
+    }
+
+    uint64_t getPayloadSize(const TrajectoryHeader& header) {
+        uint64_t size = getPositionSize(header.particleCount);
+        if (header.fields & TRAJECTORY_DENSITY) {
+            size += alignChunk(static_cast<uint64_t>(header.particleCount) * sizeof(float));
+        }
+        return size;
+    }
+
+    TrajectoryHeader makeTrajectoryHeader(uint32_t fields) {
+        TrajectoryHeader header = {};
+        std::memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+        header.version = TRAJECTORY_VERSION;
+        header.particleCount = simulator::particleCount;
+        header.fields = fields | TRAJECTORY_POSITION;
+        header.timestep = static_cast<float>(simulator::DELTA_TIME);
+        // the moving wall never leaves the domain the cubes were laid out for
+        float halfWidth = static_cast<float>(0.5 * simulator::domainHorizonMaxCoordinate);
+        header.domainMin[0] = -halfWidth;
+        header.domainMin[1] = 0.0f;
+        header.domainMin[2] = -halfWidth;
+        header.domainMax[0] = halfWidth;
+        header.domainMax[1] = static_cast<float>(simulator::domainMaxHeight);
+        header.domainMax[2] = halfWidth;
+        header.particleCountPerEdgeXZ = simulator::particleCountPerEdgeXZ;
+        header.particleCountPerEdgeY = simulator::particleCountPerEdgeY;
+        return header;
+    }
+
+    uint16_t quantizeCoordinate(float value, float min, float max) {
+        float normalized = std::min(std::max((value - min) / (max - min), 0.0f), 1.0f);
+        return static_cast<uint16_t>(std::lround(normalized * TRAJECTORY_QUANTIZATION_MAX));
+    }
+
+    float dequantizeCoordinate(uint16_t value, float min, float max) {
+        return min + static_cast<float>(value) / TRAJECTORY_QUANTIZATION_MAX * (max - min);
+    }
+
+    // TrajectoryWriter
+    TrajectoryWriter::TrajectoryWriter(const std::string& fileName, const TrajectoryHeader& header)
+        : m_header(header), m_offset(0), m_failed(false) {
+        m_file = std::fopen(fileName.c_str(), "wb");
+        if (!m_file) {
+            std::cerr << "cannot open trajectory file: " << fileName << std::endl;
+            return;
+        }
+        if (std::fwrite(&m_header, sizeof(m_header), 1, m_file) != 1) {
+            std::cerr << "failed to write trajectory header: " << fileName << std::endl;
+            std::fclose(m_file);
+            m_file = nullptr;
+            return;
+        }
+        m_offset = sizeof(m_header);
+        m_chunk.resize(sizeof(TrajectoryChunkHeader) + getPayloadSize(m_header));
+    }
+
+    TrajectoryWriter::~TrajectoryWriter() {
+        if (!m_file) {
+            return;
+        }
+        if (m_failed) {
+            // without trailer the reader recovers the complete frames by walking the chunks
+            std::cerr << "trajectory has a partly written frame, it is closed without index" << std::endl;
+            std::fclose(m_file);
+            return;
+        }
+
+        TrajectoryIndexHeader indexHeader = { TRAJECTORY_INDEX_MAGIC, static_cast<uint32_t>(m_chunkOffsets.size()) };
+        TrajectoryTrailer trailer = {};
+        trailer.indexOffset = m_offset;
+        std::memcpy(trailer.magic, TRAJECTORY_END_MAGIC, sizeof(trailer.magic));
+        bool written = std::fwrite(&indexHeader, sizeof(indexHeader), 1, m_file) == 1
+            && std::fwrite(m_chunkOffsets.data(), sizeof(uint64_t), m_chunkOffsets.size(), m_file) == m_chunkOffsets.size()
+            && std::fwrite(&trailer, sizeof(trailer), 1, m_file) == 1;
+        written = std::fclose(m_file) == 0 && written;
+        if (!written) {
+            std::cerr << "failed to write trajectory index, the file is incomplete" << std::endl;
+        }
+    }
+
+    bool TrajectoryWriter::isOpen() const {
+        return m_file != nullptr;
+    }
+
+    int TrajectoryWriter::writeFrame(const ParticleFrame& frame, uint32_t step) {
+        if (!m_file || !frame.position || frame.particleCount != m_header.particleCount) {
+            return -1;
+        }
+        if ((m_header.fields & TRAJECTORY_DENSITY) && !frame.density) {
+            return -1;
+        }
+
+        TrajectoryChunkHeader chunkHeader = { TRAJECTORY_CHUNK_MAGIC, step, getPayloadSize(m_header) };
+        std::memcpy(m_chunk.data(), &chunkHeader, sizeof(chunkHeader));
+
+        // scatter back into initial order, the GPU buffers are permuted by the reordering
+        uint16_t* position = reinterpret_cast<uint16_t*>(m_chunk.data() + sizeof(chunkHeader));
+        for (uint32_t i = 0; i < frame.particleCount; i++) {
+            uint32_t id = frame.particleId[i];
+            for (int axis = 0; axis < 3; axis++) {
+                position[3 * id + axis] = quantizeCoordinate(frame.position[i][axis], m_header.domainMin[axis], m_header.domainMax[axis]);
+            }
+        }
+        if (m_header.fields & TRAJECTORY_DENSITY) {
+            float* density = reinterpret_cast<float*>(m_chunk.data() + sizeof(chunkHeader) + getPositionSize(m_header.particleCount));
+            for (uint32_t i = 0; i < frame.particleCount; i++) {
+                density[frame.particleId[i]] = frame.density[i];
+            }
+        }
+
+        if (m_failed) {
+            return -1;
+        }
+        if (std::fwrite(m_chunk.data(), m_chunk.size(), 1, m_file) != 1) {
+            std::cerr << "failed to write trajectory frame " << step << std::endl;
+            m_failed = true;
+            return -1;
+        }
+        m_chunkOffsets.push_back(m_offset);
+        m_offset += m_chunk.size();
+
+        return 0;
+    }
+
+    uint32_t TrajectoryWriter::getFrameCount() const {
+        return static_cast<uint32_t>(m_chunkOffsets.size());
+    }
+
+    // TrajectoryRecorder
+    TrajectoryRecorder::TrajectoryRecorder(const std::string& fileName, unsigned int interval)
+        : m_writer(fileName, makeTrajectoryHeader(TRAJECTORY_DENSITY)),
+          m_readback(READBACK_POSITION | READBACK_DENSITY, [this](const ParticleFrame& frame) { m_writer.writeFrame(frame, frame.frameCount); }),
+          m_interval(std::max(interval, 1u)), m_step(0) {
+    }
+
+    bool TrajectoryRecorder::isOpen() const {
+        return m_writer.isOpen();
+    }
+
+    void TrajectoryRecorder::recordFrame() {
+        if (m_writer.isOpen() && m_step % m_interval == 0) {
+            m_readback.capture(m_step);
+        }
+        m_step++;
+    }
+
+    void TrajectoryRecorder::poll() {
+        m_readback.poll();
+    }
+
+    unsigned int TrajectoryRecorder::getDroppedFrameCount() const {
+        return m_readback.getDroppedFrameCount();
+    }
+
+    // TrajectoryReader
+    TrajectoryReader::TrajectoryReader(const std::string& fileName) : m_data(nullptr), m_size(0), m_header() {
+        #ifdef _WIN32
+        m_fileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        m_mappingHandle = NULL;
+        if (m_fileHandle == INVALID_HANDLE_VALUE) {
+            std::cerr << "cannot open trajectory file: " << fileName << std::endl;
+            return;
+        }
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(m_fileHandle, &fileSize);
+        m_mappingHandle = CreateFileMappingA(m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (m_mappingHandle != NULL) {
+            m_data = static_cast<const unsigned char*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+            m_size = static_cast<size_t>(fileSize.QuadPart);
+        }
+        #else
+        int file = open(fileName.c_str(), O_RDONLY);
+        if (file < 0) {
+            std::cerr << "cannot open trajectory file: " << fileName << std::endl;
+            return;
+        }
+        struct stat fileStatus;
+        if (fstat(file, &fileStatus) == 0 && fileStatus.st_size > 0) {
+            void* data = mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            if (data != MAP_FAILED) {
+                m_data = static_cast<const unsigned char*>(data);
+                m_size = static_cast<size_t>(fileStatus.st_size);
+            }
+        }
+        // the mapping stays valid after the descriptor is closed
+        close(file);
+        #endif
+
+        if (!m_data || m_size < sizeof(TrajectoryHeader)) {
+            std::cerr << "cannot map trajectory file: " << fileName << std::endl;
+            return;
+        }
+        std::memcpy(&m_header, m_data, sizeof(m_header));
+        if (std::memcmp(m_header.magic, TRAJECTORY_MAGIC, sizeof(m_header.magic)) != 0 || m_header.version != TRAJECTORY_VERSION) {
+            std::cerr << "not a trajectory file of version " << TRAJECTORY_VERSION << ": " << fileName << std::endl;
+            m_header = TrajectoryHeader();
+            return;
+        }
+
+        if (readIndex() != 0) {
+            std::cerr << "trajectory file has no valid index, it was not closed properly: " << fileName << std::endl;
+            scanChunks();
+        }
+    }
+
+    TrajectoryReader::~TrajectoryReader() {
+        #ifdef _WIN32
+        if (m_data) {
+            UnmapViewOfFile(m_data);
+        }
+        if (m_mappingHandle != NULL) {
+            CloseHandle(m_mappingHandle);
+        }
+        if (m_fileHandle != INVALID_HANDLE_VALUE) {
+            CloseHandle(m_fileHandle);
+        }
+        #else
+        if (m_data) {
+            munmap(const_cast<unsigned char*>(m_data), m_size);
+        }
+        #endif
+    }
+
+    bool TrajectoryReader::isOpen() const {
+        return m_header.version == TRAJECTORY_VERSION;
+    }
+
+    const TrajectoryHeader& TrajectoryReader::getHeader() const {
+        return m_header;
+    }
+
+    uint32_t TrajectoryReader::getFrameCount() const {
+        return static_cast<uint32_t>(m_chunkOffsets.size());
+    }
+
+    uint32_t TrajectoryReader::getStep(uint32_t frame) const {
+        TrajectoryChunkHeader chunkHeader;
+        std::memcpy(&chunkHeader, m_data + m_chunkOffsets[frame], sizeof(chunkHeader));
+        return chunkHeader.step;
+    }
+
+    const unsigned char* TrajectoryReader::getPayload(uint32_t frame) const {
+        return m_data + m_chunkOffsets[frame] + sizeof(TrajectoryChunkHeader);
+    }
+
+    const uint16_t* TrajectoryReader::getQuantizedPosition(uint32_t frame) const {
+        return reinterpret_cast<const uint16_t*>(getPayload(frame));
+    }
+
+    const float* TrajectoryReader::getDensity(uint32_t frame) const {
+        if (!(m_header.fields & TRAJECTORY_DENSITY)) {
+            return nullptr;
+        }
+        return reinterpret_cast<const float*>(m_data + m_chunkOffsets[frame] + sizeof(TrajectoryChunkHeader) + getPositionSize(m_header.particleCount));
+    }
+
+    int TrajectoryReader::dequantizePosition(uint32_t frame, std::vector<glm::vec4>& position) const {
+        const uint16_t* quantized = getQuantizedPosition(frame);
+        position.resize(m_header.particleCount);
+        for (uint32_t i = 0; i < m_header.particleCount; i++) {
+            position[i] = glm::vec4(
+                dequantizeCoordinate(quantized[3 * i], m_header.domainMin[0], m_header.domainMax[0]),
+                dequantizeCoordinate(quantized[3 * i + 1], m_header.domainMin[1], m_header.domainMax[1]),
+                dequantizeCoordinate(quantized[3 * i + 2], m_header.domainMin[2], m_header.domainMax[2]),
+                0.0f);
+        }
+
+        return 0;
+    }
+
+    int TrajectoryReader::readIndex() {
+        TrajectoryTrailer trailer;
+        if (m_size < sizeof(TrajectoryHeader) + sizeof(TrajectoryIndexHeader) + sizeof(trailer)) {
+            return -1;
+        }
+        std::memcpy(&trailer, m_data + m_size - sizeof(trailer), sizeof(trailer));
+        if (std::memcmp(trailer.magic, TRAJECTORY_END_MAGIC, sizeof(trailer.magic)) != 0 ||
+            trailer.indexOffset < sizeof(TrajectoryHeader) ||
+            trailer.indexOffset > m_size - sizeof(trailer) - sizeof(TrajectoryIndexHeader)) {
+            return -1;
+        }
+
+        TrajectoryIndexHeader indexHeader;
+        std::memcpy(&indexHeader, m_data + trailer.indexOffset, sizeof(indexHeader));
+        uint64_t indexEnd = trailer.indexOffset + sizeof(indexHeader) + static_cast<uint64_t>(indexHeader.frameCount) * sizeof(uint64_t);
+        if (indexHeader.magic != TRAJECTORY_INDEX_MAGIC || indexEnd != m_size - sizeof(trailer)) {
+            return -1;
+        }
+
+        std::vector<uint64_t> chunkOffsets(indexHeader.frameCount);
+        std::memcpy(chunkOffsets.data(), m_data + trailer.indexOffset + sizeof(indexHeader), indexHeader.frameCount * sizeof(uint64_t));
+
+        // every chunk has to lie complete before the index, a damaged index must not point outside the mapping
+        uint64_t payloadSize = getPayloadSize(m_header);
+        for (uint64_t offset : chunkOffsets) {
+            if (offset < sizeof(TrajectoryHeader) || offset > trailer.indexOffset ||
+                trailer.indexOffset - offset < sizeof(TrajectoryChunkHeader) + payloadSize) {
+                return -1;
+            }
+            TrajectoryChunkHeader chunkHeader;
+            std::memcpy(&chunkHeader, m_data + offset, sizeof(chunkHeader));
+            if (chunkHeader.magic != TRAJECTORY_CHUNK_MAGIC || chunkHeader.payloadSize != payloadSize) {
+                return -1;
+            }
+        }
+        m_chunkOffsets = std::move(chunkOffsets);
+
+        return 0;
+    }
+
+    int TrajectoryReader::scanChunks() {
+        // keeps every complete chunk, a chunk cut off by the crash is ignored
+        uint64_t payloadSize = getPayloadSize(m_header);
+        uint64_t offset = sizeof(TrajectoryHeader);
+        m_chunkOffsets.clear();
+        while (offset + sizeof(TrajectoryChunkHeader) + payloadSize <= m_size) {
+            TrajectoryChunkHeader chunkHeader;
+            std::memcpy(&chunkHeader, m_data + offset, sizeof(chunkHeader));
+            if (chunkHeader.magic != TRAJECTORY_CHUNK_MAGIC || chunkHeader.payloadSize != payloadSize) {
+                break;
+            }
+            m_chunkOffsets.push_back(offset);
+            offset += sizeof(TrajectoryChunkHeader) + payloadSize;
+        }
+
+        return 0;
+    }
+}
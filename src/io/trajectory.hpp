@@ -0,0 +1,156 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "particle_readback.hpp"
+
+namespace io {
+    // Trajectory file, little endian:
+    //   TrajectoryHeader
+    //   per frame: TrajectoryChunkHeader, uint16 position[3 * particleCount] (padded to 8 bytes), float density[particleCount] if stored
+    //   TrajectoryIndexHeader, uint64 chunkOffset[frameCount], TrajectoryTrailer
+    // Frames are appended as they arrive, the index goes at the end when the writer closes.
+    // A file without trailer (e.g. the process crashed) is still readable, the reader walks the chunks instead.
+    const char TRAJECTORY_MAGIC[8] = { 'P', 'B', 'F', 'T', 'R', 'A', 'J', '\0' };
+    const char TRAJECTORY_END_MAGIC[8] = { 'P', 'B', 'F', 'T', 'E', 'N', 'D', '\0' };
+    const uint32_t TRAJECTORY_CHUNK_MAGIC = 0x4d415246; // "FRAM"
+    const uint32_t TRAJECTORY_INDEX_MAGIC = 0x58444e49; // "INDX"
+    const uint32_t TRAJECTORY_VERSION = 1;
+    const uint32_t TRAJECTORY_QUANTIZATION_MAX = 65535;
+
+    enum TrajectoryField : uint32_t {
+        TRAJECTORY_POSITION = 1 << 0,
+        TRAJECTORY_DENSITY = 1 << 1,
+    };
+
+    struct TrajectoryHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t particleCount;
+        uint32_t fields;
+        // seconds between two simulated frames, a chunk at step s is at s * timestep
+        float timestep;
+        // positions are quantized to 16 bits per axis inside this box
+        float domainMin[3];
+        float domainMax[3];
+        // scale of the recorded run, a replay configures the simulator with it
+        uint32_t particleCountPerEdgeXZ;
+        uint32_t particleCountPerEdgeY;
+        uint32_t reserved[2];
+    };
+    static_assert(sizeof(TrajectoryHeader) == 64, "TrajectoryHeader is part of the file format");
+
+    struct TrajectoryChunkHeader {
+        uint32_t magic;
+        // simulated frames since the recording started, recordings may skip frames
+        uint32_t step;
+        // bytes after this header up to the next chunk
+        uint64_t payloadSize;
+    };
+    static_assert(sizeof(TrajectoryChunkHeader) == 16, "TrajectoryChunkHeader is part of the file format");
+
+    struct TrajectoryIndexHeader {
+        uint32_t magic;
+        uint32_t frameCount;
+    };
+
+    struct TrajectoryTrailer {
+        uint64_t indexOffset;
+        char magic[8];
+    };
+
+    // header of the current simulation with the fields given
+    TrajectoryHeader makeTrajectoryHeader(uint32_t fields);
+    // bytes of the padded position array, and of everything after a chunk header
+    uint64_t getPositionSize(uint32_t particleCount);
+    uint64_t getPayloadSize(const TrajectoryHeader& header);
+    uint16_t quantizeCoordinate(float value, float min, float max);
+    float dequantizeCoordinate(uint16_t value, float min, float max);
+
+    // Appends frames to a trajectory file, meant to run on the consumer thread of a ParticleReadback.
+    // Particles are written in their initial order so frames of the same file line up.
+    class TrajectoryWriter {
+        public:
+            TrajectoryWriter(const std::string& fileName, const TrajectoryHeader& header);
+            // writes the frame index, the file is complete only after that
+            ~TrajectoryWriter();
+
+            TrajectoryWriter(const TrajectoryWriter&) = delete;
+            TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+            bool isOpen() const;
+            int writeFrame(const ParticleFrame& frame, uint32_t step);
+            uint32_t getFrameCount() const;
+
+        private:
+            FILE* m_file;
+            TrajectoryHeader m_header;
+            uint64_t m_offset;
+            // a frame was only partly written, m_offset no longer matches the file and no index is written
+            bool m_failed;
+            std::vector<uint64_t> m_chunkOffsets;
+            // one chunk is assembled here so every frame is a single fwrite
+            std::vector<unsigned char> m_chunk;
+    };
+
+    // Records the running simulation: a readback ring feeds a writer on its consumer thread.
+    class TrajectoryRecorder {
+        public:
+            // every interval-th simulated frame is stored
+            TrajectoryRecorder(const std::string& fileName, unsigned int interval);
+
+            bool isOpen() const;
+            // call after every simulate()
+            void recordFrame();
+            // call once per frame, hands finished frames to the writer
+            void poll();
+            unsigned int getDroppedFrameCount() const;
+
+        private:
+            // declared first so the readback drains into it before it closes
+            TrajectoryWriter m_writer;
+            ParticleReadback m_readback;
+            unsigned int m_interval;
+            uint32_t m_step;
+    };
+
+    // Maps a trajectory file read-only, the per-frame arrays point straight into the mapping.
+    class TrajectoryReader {
+        public:
+            explicit TrajectoryReader(const std::string& fileName);
+            ~TrajectoryReader();
+
+            TrajectoryReader(const TrajectoryReader&) = delete;
+            TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+
+            bool isOpen() const;
+            const TrajectoryHeader& getHeader() const;
+            uint32_t getFrameCount() const;
+            uint32_t getStep(uint32_t frame) const;
+            // getPayloadSize(header) bytes: the positions followed by the densities
+            const unsigned char* getPayload(uint32_t frame) const;
+            // 3 * particleCount values, x y z per particle in initial order
+            const uint16_t* getQuantizedPosition(uint32_t frame) const;
+            // nullptr if the file has no densities
+            const float* getDensity(uint32_t frame) const;
+            int dequantizePosition(uint32_t frame, std::vector<glm::vec4>& position) const;
+
+        private:
+            const unsigned char* m_data;
+            size_t m_size;
+            #ifdef _WIN32
+            void* m_fileHandle;
+            void* m_mappingHandle;
+            #endif
+            TrajectoryHeader m_header;
+            std::vector<uint64_t> m_chunkOffsets;
+
+            int readIndex();
+            int scanChunks();
+    };
+}
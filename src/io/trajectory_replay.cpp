@@ -0,0 +1,221 @@
+#include "trajectory_replay.hpp"
+
+#include <cstring>
+#include <iostream>
+
+#include "../simulator/simulator.hpp"
+#include "../common/gpu_memory.hpp"
+#include "../common/profiler.hpp"
+
+namespace io {
+    // binding point of the upload buffer, the positions are written through the simulator's binding 0
+    const GLuint REPLAY_QUANTIZED_POSITION_BINDING = 31;
+    // the GPU is two frames behind at most, a lost context must not hang the replay
+    const GLuint64 REPLAY_FENCE_TIMEOUT = 1000000000;
+
+    int applyTrajectoryScale(const TrajectoryHeader& header) {
+        if (header.particleCountPerEdgeXZ == 0 || header.particleCountPerEdgeY == 0) {
+            std::cerr << "trajectory does not record the scale of its run" << std::endl;
+            return -1;
+        }
+        simulator::simulationScale.particleCountPerEdgeXZ = header.particleCountPerEdgeXZ;
+        simulator::simulationScale.particleCountPerEdgeY = header.particleCountPerEdgeY;
+        simulator::simulationScale.horizonMaxCoordinate = header.domainMax[0] - header.domainMin[0];
+        simulator::simulationScale.maxHeight = header.domainMax[1];
+        simulator::simulationScale.particleCount = header.particleCount;
+
+        return 0;
+    }
+
+    TrajectoryReplay::TrajectoryReplay(const TrajectoryReader& reader)
+        : m_reader(reader), m_open(false), m_persistent(false), m_payloadSize(0), m_positionSize(0),
+          m_slots(), m_currentSlot(0), m_currentFrame(0), m_loadSlot(REPLAY_SLOT_COUNT), m_stop(false) {
+        const TrajectoryHeader& header = m_reader.getHeader();
+        if (!m_reader.isOpen() || m_reader.getFrameCount() == 0) {
+            std::cerr << "trajectory has no frames to replay" << std::endl;
+            return;
+        }
+        if (header.particleCount != simulator::particleCount) {
+            std::cerr << "trajectory has " << header.particleCount << " particles, the simulator " << simulator::particleCount << std::endl;
+            return;
+        }
+        m_open = true;
+        m_persistent = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+        m_payloadSize = static_cast<size_t>(getPayloadSize(header));
+        m_positionSize = static_cast<size_t>(getPositionSize(header.particleCount));
+
+        common::GPUMemoryOwner gpuMemoryOwner("replay");
+        for (Slot& slot : m_slots) {
+            glGenBuffers(1, &slot.buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, slot.buffer);
+            if (m_persistent) {
+                // coherent, so the loader's writes are visible to every command issued after it finished
+                const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                common::gpuBufferStorage(GL_COPY_WRITE_BUFFER, m_payloadSize, nullptr, flags);
+                slot.mapped = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, m_payloadSize, flags));
+            }
+            else {
+                common::gpuBufferData(GL_COPY_WRITE_BUFFER, m_payloadSize, nullptr, GL_STREAM_DRAW);
+                slot.data.resize(m_payloadSize);
+                slot.mapped = slot.data.data();
+            }
+            slot.fence = nullptr;
+            slot.frame = 0;
+            // nothing is being loaded into it
+            slot.loaded = true;
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        m_dequantizeCS = ComputeShader("src/io/shader/dequantizePosition.comp");
+
+        m_thread = std::thread(&TrajectoryReplay::loaderLoop, this);
+        rewind();
+    }
+
+    TrajectoryReplay::~TrajectoryReplay() {
+        if (!m_open) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+        m_thread.join();
+
+        for (Slot& slot : m_slots) {
+            if (slot.fence) {
+                glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, REPLAY_FENCE_TIMEOUT);
+                glDeleteSync(slot.fence);
+            }
+            if (m_persistent) {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, slot.buffer);
+                glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            }
+            common::gpuDeleteBuffers(1, &slot.buffer);
+        }
+        glDeleteProgram(m_dequantizeCS.ID);
+    }
+
+    bool TrajectoryReplay::isOpen() const {
+        return m_open;
+    }
+
+    int TrajectoryReplay::advance() {
+        if (!m_open) {
+            return -1;
+        }
+
+        PROFILE_GPU("replayTrajectory");
+
+        const TrajectoryHeader& header = m_reader.getHeader();
+        Slot& slot = m_slots[m_currentSlot];
+        waitLoaded(m_currentSlot);
+        if (!m_persistent) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, slot.buffer);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, 0, m_payloadSize, slot.data.data());
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+
+        m_dequantizeCS.use();
+        m_dequantizeCS.setUint("uParticleCount", header.particleCount);
+        m_dequantizeCS.setVec3("uDomainMin", glm::vec3(header.domainMin[0], header.domainMin[1], header.domainMin[2]));
+        m_dequantizeCS.setVec3("uDomainMax", glm::vec3(header.domainMax[0], header.domainMax[1], header.domainMax[2]));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REPLAY_QUANTIZED_POSITION_BINDING, slot.buffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, simulator::particlePositionSSBO);
+        m_dequantizeCS.dispatchCompute(header.particleCount);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REPLAY_QUANTIZED_POSITION_BINDING, 0);
+
+        if (header.fields & TRAJECTORY_DENSITY) {
+            glBindBuffer(GL_COPY_READ_BUFFER, slot.buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, simulator::densitySSBO);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, m_positionSize, 0, header.particleCount * sizeof(float));
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_currentFrame = slot.frame;
+
+        // the next frame is copied while this one renders
+        unsigned int nextSlot = (m_currentSlot + 1) % REPLAY_SLOT_COUNT;
+        requestLoad(nextSlot, (slot.frame + 1) % m_reader.getFrameCount());
+        m_currentSlot = nextSlot;
+
+        return 0;
+    }
+
+    void TrajectoryReplay::rewind() {
+        if (!m_open) {
+            return;
+        }
+
+        // the slot may still be filled with a later frame, the loader has to be done with it first
+        waitLoaded(m_currentSlot);
+        requestLoad(m_currentSlot, 0);
+        m_currentFrame = 0;
+
+        // without recorded densities every particle is drawn at rest density
+        if (!(m_reader.getHeader().fields & TRAJECTORY_DENSITY)) {
+            const float restDensity = static_cast<float>(simulator::REST_DENSITY);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, simulator::densitySSBO);
+            glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32F, GL_RED, GL_FLOAT, &restDensity);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+    }
+
+    uint32_t TrajectoryReplay::getCurrentFrame() const {
+        return m_currentFrame;
+    }
+
+    void TrajectoryReplay::loaderLoop() {
+        while (true) {
+            unsigned int slotIndex;
+            uint32_t frame;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_stop || m_loadSlot != REPLAY_SLOT_COUNT; });
+                if (m_stop) {
+                    return;
+                }
+                slotIndex = m_loadSlot;
+                frame = m_slots[slotIndex].frame;
+            }
+
+            // page faults of the mapped file land here, not on the render thread
+            std::memcpy(m_slots[slotIndex].mapped, m_reader.getPayload(frame), m_payloadSize);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_slots[slotIndex].loaded = true;
+                m_loadSlot = REPLAY_SLOT_COUNT;
+            }
+            m_condition.notify_all();
+        }
+    }
+
+    void TrajectoryReplay::requestLoad(unsigned int slotIndex, uint32_t frame) {
+        Slot& slot = m_slots[slotIndex];
+        if (slot.fence) {
+            glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, REPLAY_FENCE_TIMEOUT);
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            slot.frame = frame;
+            slot.loaded = false;
+            m_loadSlot = slotIndex;
+        }
+        m_condition.notify_all();
+    }
+
+    void TrajectoryReplay::waitLoaded(unsigned int slotIndex) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this, slotIndex]() { return m_slots[slotIndex].loaded; });
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "trajectory.hpp"
+#include "../common/compute_shader.hpp"
+
+namespace io {
+    const unsigned int REPLAY_SLOT_COUNT = 2;
+
+    // configures the simulator for the recorded run, before configureScale()
+    int applyTrajectoryScale(const TrajectoryHeader& header);
+
+    // Plays a recorded trajectory into the simulator buffers instead of simulating.
+    // Chunk payloads go to the GPU as they are stored, double buffered: a loader thread copies the next frame
+    // from the mapped file into one persistently mapped upload buffer while the GPU dequantizes the other.
+    // Without GL 4.4 / ARB_buffer_storage the loader fills a CPU copy that is uploaded with glBufferSubData.
+    class TrajectoryReplay {
+        public:
+            // reader has to outlive the replay, needs simulateInit() to have run with applyTrajectoryScale()
+            explicit TrajectoryReplay(const TrajectoryReader& reader);
+            ~TrajectoryReplay();
+
+            TrajectoryReplay(const TrajectoryReplay&) = delete;
+            TrajectoryReplay& operator=(const TrajectoryReplay&) = delete;
+
+            bool isOpen() const;
+            // writes the next frame to particlePositionSSBO and densitySSBO, starts over after the last one
+            int advance();
+            // the next advance() shows the first frame again, call after simulateInit() recreated the buffers
+            void rewind();
+            // frame shown by the last advance()
+            uint32_t getCurrentFrame() const;
+
+        private:
+            struct Slot {
+                GLuint buffer;
+                unsigned char* mapped;
+                std::vector<unsigned char> data;
+                // last dequantize that read the buffer
+                GLsync fence;
+                uint32_t frame;
+                // the loader is done with it, the data of frame is complete
+                bool loaded;
+            };
+
+            const TrajectoryReader& m_reader;
+            bool m_open;
+            bool m_persistent;
+            size_t m_payloadSize;
+            size_t m_positionSize;
+            ComputeShader m_dequantizeCS;
+
+            Slot m_slots[REPLAY_SLOT_COUNT];
+            unsigned int m_currentSlot;
+            uint32_t m_currentFrame;
+
+            std::thread m_thread;
+            std::mutex m_mutex;
+            std::condition_variable m_condition;
+            // slot the loader has to fill, REPLAY_SLOT_COUNT if none
+            unsigned int m_loadSlot;
+            bool m_stop;
+
+            void loaderLoop();
+            // waits for the GPU to release the slot and hands it to the loader
+            void requestLoad(unsigned int slotIndex, uint32_t frame);
+            void waitLoaded(unsigned int slotIndex);
+    };
+}
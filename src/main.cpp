@@ -1,67 +1,293 @@
 #include "renderer/window.hpp"
 #include "renderer/renderer.hpp"
 #include "simulator/simulator.hpp"
+#include "simulator/sceneFile.hpp"
 #include "common/performance_log.hpp"
+#include "common/profiler.hpp"
+#include "common/program_cache.hpp"
+#include "common/program_registry.hpp"
+#include "io/trajectory.hpp"
+#include "io/checkpoint.hpp"
+#include "io/trajectory_replay.hpp"
 #include "gui/gui.hpp"
 
 #include <iostream>
 #include <iomanip>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cctype>
+#include <exception>
+#include <memory>
+#include <chrono>
 
-int main() {
+const char* USAGE = " [--backend=gpu|cpu] [--threads=N] [--particles=N] [--edge-xz=N] [--edge-y=N] [--domain-xz=F] [--domain-height=F] [--config=FILE] [--trace=FILE]\n"
+                    "       [--scene=FILE] [--record=FILE] [--record-interval=N] [--checkpoint=FILE] [--checkpoint-interval=N] [--restore=FILE]\n"
+                    "       [--replay=FILE] [--shader-cache=DIR]";
+
+// trajectory of the simulation, written while it runs if a file is given
+std::string recordFileName;
+unsigned int recordInterval = 1;
+
+// saved from the gui, and every checkpointInterval simulated frames if that is not 0
+std::string checkpointFileName = "checkpoint.pbfc";
+unsigned int checkpointInterval = 0;
+// a run restored from a checkpoint also resets to it
+std::string restoreFileName;
+// plays a recorded trajectory instead of simulating
+std::string replayFileName;
+
+int parseArgument(const std::string& argument);
+
+// every non-empty line is `key = value` with the same keys as the command line options, `#` starts a comment
+int parseConfigFile(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "cannot open config file: " << path << std::endl;
+        return -1;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        line.erase(std::remove_if(line.begin(), line.end(), [](unsigned char c) { return std::isspace(c); }), line.end());
+        if (line.empty()) {
+            continue;
+        }
+        if (parseArgument("--" + line) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int parseArgument(const std::string& argument) {
+    auto value = [&argument]() {
+        return argument.substr(argument.find('=') + 1);
+    };
+
+    try {
+        if (argument == "--backend=gpu") {
+            simulator::backend = simulator::Backend::GPU;
+        }
+        else if (argument == "--backend=cpu") {
+            simulator::backend = simulator::Backend::CPU;
+        }
+        else if (argument.rfind("--threads=", 0) == 0) {
+            simulator::cpuThreadCount = static_cast<unsigned int>(std::stoul(value()));
+        }
+        else if (argument.rfind("--particles=", 0) == 0) {
+            simulator::SimulationScale scale = simulator::scaleFromParticleCount(static_cast<unsigned int>(std::stoul(value())));
+            simulator::simulationScale.particleCountPerEdgeXZ = scale.particleCountPerEdgeXZ;
+            simulator::simulationScale.particleCountPerEdgeY = scale.particleCountPerEdgeY;
+        }
+        else if (argument.rfind("--edge-xz=", 0) == 0) {
+            simulator::simulationScale.particleCountPerEdgeXZ = static_cast<unsigned int>(std::stoul(value()));
+        }
+        else if (argument.rfind("--edge-y=", 0) == 0) {
+            simulator::simulationScale.particleCountPerEdgeY = static_cast<unsigned int>(std::stoul(value()));
+        }
+        else if (argument.rfind("--domain-xz=", 0) == 0) {
+            simulator::simulationScale.horizonMaxCoordinate = std::stod(value());
+        }
+        else if (argument.rfind("--domain-height=", 0) == 0) {
+            simulator::simulationScale.maxHeight = std::stod(value());
+        }
+        else if (argument.rfind("--scene=", 0) == 0) {
+            return simulator::loadSceneFile(value());
+        }
+        else if (argument.rfind("--trace=", 0) == 0) {
+            common::traceFileName = value();
+        }
+        else if (argument.rfind("--record=", 0) == 0) {
+            recordFileName = value();
+        }
+        else if (argument.rfind("--record-interval=", 0) == 0) {
+            recordInterval = static_cast<unsigned int>(std::stoul(value()));
+        }
+        else if (argument.rfind("--checkpoint=", 0) == 0) {
+            checkpointFileName = value();
+        }
+        else if (argument.rfind("--checkpoint-interval=", 0) == 0) {
+            checkpointInterval = static_cast<unsigned int>(std::stoul(value()));
+        }
+        else if (argument.rfind("--restore=", 0) == 0) {
+            restoreFileName = value();
+        }
+        else if (argument.rfind("--replay=", 0) == 0) {
+            replayFileName = value();
+        }
+        else if (argument.rfind("--shader-cache=", 0) == 0) {
+            // an empty directory compiles every program
+            common::programCacheDirectory = value();
+        }
+        else if (argument.rfind("--config=", 0) == 0) {
+            return parseConfigFile(value());
+        }
+        else {
+            std::cerr << "unknown argument: " << argument << std::endl;
+            return -1;
+        }
+    }
+    catch (const std::exception&) {
+        std::cerr << "invalid value in argument: " << argument << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+int parseArguments(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (parseArgument(argv[i]) != 0) {
+            std::cerr << "usage: " << argv[0] << USAGE << std::endl;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (parseArguments(argc, argv) != 0) {
+        return -1;
+    }
+    io::Checkpoint checkpoint;
+    if (!restoreFileName.empty()) {
+        if (io::readCheckpoint(restoreFileName, checkpoint) != 0) {
+            return -1;
+        }
+        io::applyCheckpointScale(checkpoint);
+    }
+    std::unique_ptr<io::TrajectoryReader> replayReader;
+    if (!replayFileName.empty()) {
+        replayReader = std::make_unique<io::TrajectoryReader>(replayFileName);
+        if (!replayReader->isOpen() || io::applyTrajectoryScale(replayReader->getHeader()) != 0) {
+            return -1;
+        }
+    }
+    if (simulator::configureScale() != 0) {
+        return -1;
+    }
+    std::cout << "particle count: " << simulator::particleCount;
+    if (simulator::sceneShapes.empty()) {
+        std::cout << " (" << simulator::particleCountPerEdgeXZ << " x " << simulator::particleCountPerEdgeXZ << " x " << simulator::particleCountPerEdgeY << ")";
+    }
+    else {
+        std::cout << " (scene " << simulator::sceneName << ")";
+    }
+    std::cout << std::endl;
+
+    auto programBegin = std::chrono::steady_clock::now();
     renderer::Renderer renderer;
-    simulator::simulateInit();
+    if (simulator::simulateInit() != 0) {
+        return -1;
+    }
+    double programMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - programBegin).count();
+    std::cout << "renderer and simulator ready in " << programMilliseconds << " ms, "
+              << common::programCacheHitCount << " programs loaded from the shader cache, " << common::programCacheMissCount << " compiled, "
+              << common::getSharedProgramReuseCount() << " shared between passes" << std::endl;
+    if (!restoreFileName.empty()) {
+        io::applyCheckpointParameter(checkpoint);
+        io::applyCheckpointState(checkpoint);
+        std::cout << "restored frame " << checkpoint.header.frameCount << " from " << restoreFileName << std::endl;
+    }
     common::performanceLogInit();
+    common::addPerformanceLogSection([](std::ostream& os) { simulator::outputNeighborStatistics(os); });
     gui::guiInit();
 
+    std::unique_ptr<io::TrajectoryRecorder> trajectoryRecorder;
+    if (!recordFileName.empty()) {
+        trajectoryRecorder = std::make_unique<io::TrajectoryRecorder>(recordFileName, recordInterval);
+    }
+    std::unique_ptr<io::TrajectoryReplay> trajectoryReplay;
+    if (replayReader) {
+        trajectoryReplay = std::make_unique<io::TrajectoryReplay>(*replayReader);
+        if (!trajectoryReplay->isOpen()) {
+            return -1;
+        }
+        std::cout << "replaying " << replayReader->getFrameCount() << " frames from " << replayFileName << std::endl;
+    }
+    std::unique_ptr<io::CheckpointWriter> checkpointWriter = std::make_unique<io::CheckpointWriter>();
+
     while(!glfwWindowShouldClose(renderer::window::window)) {
         if (common::resetSimulation) {
             common::resetSimulation = false;
             simulator::simulateTerminate();
-            simulator::simulateInit();
+            if (simulator::simulateInit() != 0) {
+                return -1;
+            }
+            if (!restoreFileName.empty()) {
+                io::applyCheckpointState(checkpoint);
+            }
+            if (trajectoryReplay) {
+                trajectoryReplay->rewind();
+            }
         }
 
-        {
-        common::queryTime(0);
-        }
+        common::profilerBeginFrame();
 
-        if (common::enableSimulation) {
+        if (common::enableSimulation && trajectoryReplay) {
+            trajectoryReplay->advance();
+        }
+        else if (common::enableSimulation) {
             simulator::simulate();
+            if (trajectoryRecorder) {
+                trajectoryRecorder->recordFrame();
+            }
+            if (checkpointInterval > 0 && simulator::simulateFrameCount % checkpointInterval == 0) {
+                common::saveCheckpoint = true;
+            }
         }
-
-        {
-        common::queryTime(common::SIMULATE_TIME_QUERY_COUNT);
+        if (common::saveCheckpoint) {
+            // a save requested while the last one is still being written waits for the next frame
+            common::saveCheckpoint = !checkpointWriter->save(checkpointFileName);
         }
-
-        glfwPollEvents();
-        renderer::window::computeDeltaTime();
-        renderer::window::processInput(renderer::window::window);
-        if (common::cameraMode) {
-            renderer::window::enableMouseMovement();
-            glfwSetInputMode(renderer::window::window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-            renderer::window::processCameraInput(renderer::window::window);
-        }
-        else {
-            renderer::window::disableMouseMovement();
-            glfwSetInputMode(renderer::window::window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+        checkpointWriter->poll();
+        if (trajectoryRecorder) {
+            trajectoryRecorder->poll();
         }
 
         {
-        common::queryTime(common::SIMULATE_TIME_QUERY_COUNT + 1);
+            PROFILE_CPU("processInput");
+            glfwPollEvents();
+            renderer::window::computeDeltaTime();
+            renderer::window::processInput(renderer::window::window);
+            if (common::cameraMode) {
+                renderer::window::enableMouseMovement();
+                glfwSetInputMode(renderer::window::window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+                renderer::window::processCameraInput(renderer::window::window);
+            }
+            else {
+                renderer::window::disableMouseMovement();
+                glfwSetInputMode(renderer::window::window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+            }
         }
 
-        renderer.render();
-        gui::guiRender(); 
-        glfwSwapBuffers(renderer::window::window);
-
         {
-        common::queryTime(common::TIME_QUERY_COUNT - 1);
+            PROFILE_GPU("render");
+            renderer.render();
+            {
+                PROFILE_GPU("gui");
+                gui::guiRender();
+            }
+            {
+                PROFILE_GPU("swapBuffers");
+                glfwSwapBuffers(renderer::window::window);
+            }
         }
 
-
         common::updateFrameCount();
     }
 
     
+    if (trajectoryRecorder) {
+        std::cout << "recorded trajectory to " << recordFileName << ", " << trajectoryRecorder->getDroppedFrameCount() << " frames dropped" << std::endl;
+        trajectoryRecorder.reset();
+    }
+    checkpointWriter.reset();
+    trajectoryReplay.reset();
     gui::guiTerminate();
     common::performanceLogTerminate();
     simulator::simulateTerminate();
@@ -7,6 +7,7 @@
 #include <memory>
 
 #include "../common/common.hpp"
+#include "../common/program_registry.hpp"
 #include "camera.hpp"
 #include "scene.hpp"
 #include "fluid.hpp"
@@ -24,6 +25,9 @@ namespace renderer {
                 std::shared_ptr<renderer::info::CausticsInfo> m_info;
 
             private:
+                std::shared_ptr<ComputeShader> write2photonVBOCS;
+                std::shared_ptr<Shader> shader;
+
                 GLuint FBO;
                 std::shared_ptr<scene::Scene> m_scene;
                 std::shared_ptr<fluid::Fluid> m_fluid;
@@ -6,7 +6,7 @@
 
 #include "../common/shader.hpp"
 #include "../common/compute_shader.hpp"
-#include "../common/performance_log.hpp"
+#include "../common/profiler.hpp"
 #include "../simulator/simulator.hpp"
 #include "scene.hpp"
 #include "utils.hpp"
@@ -14,9 +14,10 @@
 
 namespace renderer {
     namespace fluid {
-        // performance log
-        const unsigned int QUERY_START_INDEX = common::SIMULATE_TIME_QUERY_COUNT + 2;
-        
+        // SSBO bindings read by fluid.vert, above the ones used by the simulator
+        const GLuint PARTICLE_POSITION_BINDING = 29;
+        const GLuint PARTICLE_DENSITY_BINDING = 30;
+
         // gui parameters
         DisplayMode displayMode = DisplayMode::CARTOON;
         bool enableSmoothDepth = true;
@@ -43,26 +44,6 @@ namespace renderer {
         int edgeSize = 1;
         bool enableFixInvalidNormals = true;
 
-        // common shaders
-        Shader renderFluidShader;
-        Shader renderCartoonShader;
-        Shader renderFluidDepthShader;
-        Shader renderFluidNormalShader;
-        Shader renderFluidThicknessShader;
-        Shader particleShader;
-        Shader renderFluidDepthTextureShader;
-        Shader renderFluidThicknessTextureShader;
-        Shader renderFoamTextureShader;
-        Shader renderFoamShader;
-        Shader renderEdgeShader;
-        ComputeShader clearCS;
-        ComputeShader smoothDepthCS;
-        ComputeShader computeFluidNormalCS;
-        ComputeShader erodeFoamTextureCS;
-        ComputeShader edgeCS;
-        ComputeShader extendEdgeCS;
-        ComputeShader fixInvalidNormalsCS;
-
         Fluid::Fluid(Camera& camera, unsigned int width, unsigned int height, std::shared_ptr<renderer::info::SceneInfo> sceneInfo) 
                     : m_info(std::make_shared<renderer::info::FluidInfo>(camera, width, height)),
                       m_sceneInfo(sceneInfo) {
@@ -72,27 +53,25 @@ namespace renderer {
         int Fluid::init() {
             // init shaders
             {
-            renderFluidShader = Shader("src/renderer/shader/fluid/fluid.vert", "src/renderer/shader/fluid/fluid.frag");
-            renderCartoonShader = Shader("src/renderer/shader/fluid/fluid.vert", "src/renderer/shader/fluid/cartoon.frag");
-            renderFluidDepthShader = Shader("src/renderer/shader/fluid/fluid.vert", "src/renderer/shader/fluid/fluidDepth.frag");
-            renderFluidNormalShader = Shader("src/renderer/shader/fluid/fluid.vert", "src/renderer/shader/fluid/fluidNormal.frag");
-            renderFluidThicknessShader = Shader("src/renderer/shader/fluid/fluid.vert", "src/renderer/shader/fluid/fluidThickness.frag");
-            particleShader = Shader("src/renderer/shader/fluid/fluid.vert", "src/renderer/shader/fluid/particle.frag");
-            renderFluidDepthTextureShader = Shader("src/renderer/shader/fluid/fluid.vert", "src/renderer/shader/fluid/prepare/fluidDepthTexture.frag");
-            renderFluidThicknessTextureShader = Shader("src/renderer/shader/fluid/fluid.vert", "src/renderer/shader/fluid/prepare/fluidThicknessTexture.frag");
-            renderFoamTextureShader = Shader("src/renderer/shader/fluid/fluid.vert", "src/renderer/shader/fluid/prepare/foamTexture.frag");
-            renderFoamShader = Shader("src/renderer/shader/screenQuad.vert", "src/renderer/shader/fluid/foam.frag");
-            renderEdgeShader = Shader("src/renderer/shader/screenQuad.vert", "src/renderer/shader/fluid/edge.frag");
-            clearCS = ComputeShader("src/renderer/shader/fluid/prepare/clear.comp");
-            smoothDepthCS = ComputeShader("src/renderer/shader/fluid/prepare/smoothDepth.comp");
-            computeFluidNormalCS = ComputeShader("src/renderer/shader/fluid/prepare/computeFluidNormal.comp");
-            erodeFoamTextureCS = ComputeShader("src/renderer/shader/fluid/prepare/erodeFoamTexture.comp");
-            edgeCS = ComputeShader("src/renderer/shader/fluid/prepare/edge.comp");
-            extendEdgeCS = ComputeShader("src/renderer/shader/fluid/prepare/extendEdge.comp");
-            fixInvalidNormalsCS = ComputeShader("src/renderer/shader/fluid/prepare/fixInvalidNormals.comp");
+            renderFluidShader = common::acquireShader("src/renderer/shader/fluid/fluid.vert", "src/renderer/shader/fluid/fluid.frag");
+            renderCartoonShader = common::acquireShader("src/renderer/shader/fluid/fluid.vert", "src/renderer/shader/fluid/cartoon.frag");
+            renderFluidDepthShader = common::acquireShader("src/renderer/shader/fluid/fluid.vert", "src/renderer/shader/fluid/fluidDepth.frag");
+            renderFluidNormalShader = common::acquireShader("src/renderer/shader/fluid/fluid.vert", "src/renderer/shader/fluid/fluidNormal.frag");
+            renderFluidThicknessShader = common::acquireShader("src/renderer/shader/fluid/fluid.vert", "src/renderer/shader/fluid/fluidThickness.frag");
+            particleShader = common::acquireShader("src/renderer/shader/fluid/fluid.vert", "src/renderer/shader/fluid/particle.frag");
+            renderFluidDepthTextureShader = common::acquireShader("src/renderer/shader/fluid/fluid.vert", "src/renderer/shader/fluid/prepare/fluidDepthTexture.frag");
+            renderFluidThicknessTextureShader = common::acquireShader("src/renderer/shader/fluid/fluid.vert", "src/renderer/shader/fluid/prepare/fluidThicknessTexture.frag");
+            renderFoamTextureShader = common::acquireShader("src/renderer/shader/fluid/fluid.vert", "src/renderer/shader/fluid/prepare/foamTexture.frag");
+            renderFoamShader = common::acquireShader("src/renderer/shader/screenQuad.vert", "src/renderer/shader/fluid/foam.frag");
+            renderEdgeShader = common::acquireShader("src/renderer/shader/screenQuad.vert", "src/renderer/shader/fluid/edge.frag");
+            clearCS = common::acquireComputeShader("src/renderer/shader/fluid/prepare/clear.comp");
+            smoothDepthCS = common::acquireComputeShader("src/renderer/shader/fluid/prepare/smoothDepth.comp");
+            computeFluidNormalCS = common::acquireComputeShader("src/renderer/shader/fluid/prepare/computeFluidNormal.comp");
+            erodeFoamTextureCS = common::acquireComputeShader("src/renderer/shader/fluid/prepare/erodeFoamTexture.comp");
+            edgeCS = common::acquireComputeShader("src/renderer/shader/fluid/prepare/edge.comp");
+            extendEdgeCS = common::acquireComputeShader("src/renderer/shader/fluid/prepare/extendEdge.comp");
+            fixInvalidNormalsCS = common::acquireComputeShader("src/renderer/shader/fluid/prepare/fixInvalidNormals.comp");
             }
-            ComputeShader erodeFoamTextureCS;
-            erodeFoamTextureCS = ComputeShader("src/renderer/shader/fluid/prepare/erodeFoamTexture.comp");
 
             // whole framebuffer
             {
@@ -166,61 +145,44 @@ namespace renderer {
             edgeTexture = utils::generateTextureR8I(m_info->width, m_info->height);
             extendedEdgeTexture = utils::generateTextureR8I(m_info->width, m_info->height);
 
-            // vertex array and buffer
-            {
+            // empty vertex array, fluid.vert pulls the particles from the SSBOs bound in bindParticleBuffer()
             glGenVertexArrays(1, &VAO);
-            glGenBuffers(1, &VBO);
-            glGenBuffers(1, &densityVBO);
-
-            glBindVertexArray(VAO);
-
-            glBindBuffer(GL_ARRAY_BUFFER, VBO);
-            glBufferData(GL_ARRAY_BUFFER, simulator::PARTICLE_COUNT * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
-            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
-            glEnableVertexAttribArray(0);
-
-            glBindBuffer(GL_ARRAY_BUFFER, densityVBO);
-            glBufferData(GL_ARRAY_BUFFER, simulator::PARTICLE_COUNT * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
-            glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
-            glEnableVertexAttribArray(1);
-
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
-            glBindVertexArray(0);
-            }
 
             return 0;
         }
 
         int Fluid::clear() {
-            clearCS.use();
-            clearCS.setInt("SCR_WIDTH", m_info->width);
-            clearCS.setInt("SCR_HEIGHT", m_info->height);
+            clearCS->use();
+            clearCS->setInt("SCR_WIDTH", m_info->width);
+            clearCS->setInt("SCR_HEIGHT", m_info->height);
             utils::bindTextureWithLayer0(m_info->validTexture, 0, GL_R8I, GL_WRITE_ONLY);
-            clearCS.dispatchCompute(m_info->width * m_info->height);
+            clearCS->dispatchCompute(m_info->width * m_info->height);
             glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 
             return 0;
         }
 
         int Fluid::renderDepthTexture() {
+            PROFILE_GPU("renderDepthTexture");
+
             glBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
             glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
             glEnable(GL_PROGRAM_POINT_SIZE);
             glEnable(GL_DEPTH_TEST);
             glDepthFunc(GL_LESS);
 
-            renderFluidDepthTextureShader.use();
+            renderFluidDepthTextureShader->use();
             // MVP transform
             glm::mat4 uView = m_info->view();
-            renderFluidDepthTextureShader.setMat4("uView", uView);
+            renderFluidDepthTextureShader->setMat4("uView", uView);
             glm::mat4 uProjection = m_info->projection();
-            renderFluidDepthTextureShader.setMat4("uProjection", uProjection);       
+            renderFluidDepthTextureShader->setMat4("uProjection", uProjection);       
             // other parameters
-            renderFluidDepthTextureShader.setFloat("uPointSize", static_cast<float>(simulator::PARTICLE_RADIUS * particleRadiusScaler));
-            renderFluidDepthTextureShader.setFloat("uMinimumDensity", static_cast<float>(minimumDensityScaler * simulator::REST_DENSITY));
+            renderFluidDepthTextureShader->setFloat("uPointSize", static_cast<float>(simulator::PARTICLE_RADIUS * particleRadiusScaler));
+            renderFluidDepthTextureShader->setFloat("uMinimumDensity", static_cast<float>(minimumDensityScaler * simulator::REST_DENSITY));
 
             glBindVertexArray(VAO);
-            glDrawArrays(GL_POINTS, 0, simulator::PARTICLE_COUNT);
+            glDrawArrays(GL_POINTS, 0, simulator::particleCount);
 
             glBindVertexArray(0);
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -233,6 +195,8 @@ namespace renderer {
         }
 
         int Fluid::renderThicknessTexture() {
+            PROFILE_GPU("renderThicknessTexture");
+
             glBindFramebuffer(GL_FRAMEBUFFER, thicknessFBO);
             glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -243,19 +207,19 @@ namespace renderer {
             glEnable(GL_BLEND);
             glBlendFunc(GL_ONE, GL_ONE);
 
-            renderFluidThicknessTextureShader.use();
+            renderFluidThicknessTextureShader->use();
             // MVP transform
             glm::mat4 uView = m_info->view();
-            renderFluidThicknessTextureShader.setMat4("uView", uView);
+            renderFluidThicknessTextureShader->setMat4("uView", uView);
             glm::mat4 uProjection = m_info->projection();
-            renderFluidThicknessTextureShader.setMat4("uProjection", uProjection);       
+            renderFluidThicknessTextureShader->setMat4("uProjection", uProjection);       
             // other parameters
-            renderFluidThicknessTextureShader.setFloat("uPointSize", static_cast<float>(simulator::PARTICLE_RADIUS * particleRadiusScaler));
-            renderFluidThicknessTextureShader.setFloat("uMinimumDensity", static_cast<float>(minimumDensityScaler * simulator::REST_DENSITY));
-            renderFluidThicknessTextureShader.setFloat("uThicknessScaler", thicknessScaler);
+            renderFluidThicknessTextureShader->setFloat("uPointSize", static_cast<float>(simulator::PARTICLE_RADIUS * particleRadiusScaler));
+            renderFluidThicknessTextureShader->setFloat("uMinimumDensity", static_cast<float>(minimumDensityScaler * simulator::REST_DENSITY));
+            renderFluidThicknessTextureShader->setFloat("uThicknessScaler", thicknessScaler);
 
             glBindVertexArray(VAO);
-            glDrawArrays(GL_POINTS, 0, simulator::PARTICLE_COUNT);
+            glDrawArrays(GL_POINTS, 0, simulator::particleCount);
 
             glBindVertexArray(0);
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -270,42 +234,46 @@ namespace renderer {
         }
 
         int Fluid::smoothDepthTexture(int kernelRadius) {
-            smoothDepthCS.use();
-            smoothDepthCS.setInt("SCR_WIDTH", m_info->width);
-            smoothDepthCS.setInt("SCR_HEIGHT", m_info->height);
-            smoothDepthCS.setInt("uKernelRadius", kernelRadius);
-            smoothDepthCS.setInt("uSeparate", separateBilateralFilter ? 1 : 0);
+            PROFILE_GPU("smoothDepthTexture");
+
+            smoothDepthCS->use();
+            smoothDepthCS->setInt("SCR_WIDTH", m_info->width);
+            smoothDepthCS->setInt("SCR_HEIGHT", m_info->height);
+            smoothDepthCS->setInt("uKernelRadius", kernelRadius);
+            smoothDepthCS->setInt("uSeparate", separateBilateralFilter ? 1 : 0);
             utils::bindTextureWithLayer0(m_info->validTexture, 2, GL_R8I, GL_READ_ONLY);
 
             // horizontal
-            smoothDepthCS.setInt("uHorizontal", 1);
+            smoothDepthCS->setInt("uHorizontal", 1);
             utils::bindTextureWithLayer0(m_info->smoothedDepthTexture, 0, GL_R32F, GL_READ_ONLY);
             utils::bindTextureWithLayer0(smoothedDepthAidTexture, 1, GL_R32F, GL_WRITE_ONLY);
-            smoothDepthCS.dispatchCompute(m_info->width * m_info->height);
+            smoothDepthCS->dispatchCompute(m_info->width * m_info->height);
             glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 
             // vertical
-            smoothDepthCS.setInt("uHorizontal", 0);
+            smoothDepthCS->setInt("uHorizontal", 0);
             utils::bindTextureWithLayer0(smoothedDepthAidTexture, 0, GL_R32F, GL_READ_ONLY);
             utils::bindTextureWithLayer0(m_info->smoothedDepthTexture, 1, GL_R32F, GL_WRITE_ONLY);
-            smoothDepthCS.dispatchCompute(m_info->width * m_info->height);
+            smoothDepthCS->dispatchCompute(m_info->width * m_info->height);
             glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 
             return 0;
         }
 
         int Fluid::computeNormalTexture() {
-            computeFluidNormalCS.use();
-            computeFluidNormalCS.setInt("SCR_WIDTH", m_info->width);
-            computeFluidNormalCS.setInt("SCR_HEIGHT", m_info->height);
+            PROFILE_GPU("computeNormalTexture");
+
+            computeFluidNormalCS->use();
+            computeFluidNormalCS->setInt("SCR_WIDTH", m_info->width);
+            computeFluidNormalCS->setInt("SCR_HEIGHT", m_info->height);
             glm::mat4 projection = m_info->projection();
             glm::mat4 projectionInverse = glm::inverse(projection);
-            computeFluidNormalCS.setMat4("projectionInverse", projectionInverse);
+            computeFluidNormalCS->setMat4("projectionInverse", projectionInverse);
 
             utils::bindTextureWithLayer0(m_info->smoothedDepthTexture, 0, GL_R32F, GL_READ_ONLY);
             utils::bindTextureWithLayer0(normalViewSpaceTexture, 1, GL_RGBA32F, GL_WRITE_ONLY);
 
-            computeFluidNormalCS.dispatchCompute(m_info->width * m_info->height);
+            computeFluidNormalCS->dispatchCompute(m_info->width * m_info->height);
             glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 
             if (enableFixInvalidNormals) {
@@ -316,12 +284,12 @@ namespace renderer {
         }
 
         int Fluid::fixInvalidNormals() {
-            fixInvalidNormalsCS.use();
-            fixInvalidNormalsCS.setIvec2("uResolution", glm::ivec2(m_info->width, m_info->height));
+            fixInvalidNormalsCS->use();
+            fixInvalidNormalsCS->setIvec2("uResolution", glm::ivec2(m_info->width, m_info->height));
             utils::bindTextureWithLayer0(normalViewSpaceTexture, 0, GL_RGBA32F, GL_READ_ONLY);
             utils::bindTextureWithLayer0(repairedNormalViewSpaceTexture, 1, GL_RGBA32F, GL_WRITE_ONLY);
 
-            fixInvalidNormalsCS.dispatchCompute(m_info->width * m_info->height);
+            fixInvalidNormalsCS->dispatchCompute(m_info->width * m_info->height);
             glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 
             utils::copyTexture2D(repairedNormalViewSpaceTexture, normalViewSpaceTexture, m_info->width, m_info->height);
@@ -330,20 +298,14 @@ namespace renderer {
         }
 
         int Fluid::renderPrepare() {
-            copyParticleAttribute();
+            PROFILE_GPU("renderPrepare");
 
-            {
-            common::queryTime(QUERY_START_INDEX + 1);
-            }
+            bindParticleBuffer();
 
             clear();
 
             renderDepthTexture();
 
-            {
-            common::queryTime(QUERY_START_INDEX + 2);
-            }
-
             if (enableSmoothDepth) {
                 float kernelRadius = static_cast<float>(smoothKernelRadius);
                 float delta = static_cast<float>(smoothKernelRadius - 1) / (smoothIteration - 1);
@@ -353,16 +315,8 @@ namespace renderer {
                 }
             }
 
-            {
-            common::queryTime(QUERY_START_INDEX + 3);
-            }
-
             computeNormalTexture();
 
-            {
-            common::queryTime(QUERY_START_INDEX + 4);
-            }
-
             renderThicknessTexture();
 
             return 0;
@@ -370,6 +324,8 @@ namespace renderer {
 
 
         int Fluid::renderFluid() {
+            PROFILE_GPU("renderFluid");
+
             glBindFramebuffer(GL_FRAMEBUFFER, FBO);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -378,31 +334,31 @@ namespace renderer {
             glDepthFunc(GL_LESS);
             glDepthMask(GL_TRUE);
 
-            renderFluidShader.use();
+            renderFluidShader->use();
             // MVP transform
             glm::mat4 uView = m_info->view();
-            renderFluidShader.setMat4("uView", uView);
+            renderFluidShader->setMat4("uView", uView);
             glm::mat4 uProjection = m_info->projection();
-            renderFluidShader.setMat4("uProjection", uProjection);
+            renderFluidShader->setMat4("uProjection", uProjection);
             glm::mat4 viewInverse = glm::inverse(uView);
-            renderFluidShader.setMat4("uViewInverse", viewInverse);
+            renderFluidShader->setMat4("uViewInverse", viewInverse);
             glm::mat4 viewTranspose = glm::transpose(uView);
-            renderFluidShader.setMat4("uViewTranspose", viewTranspose);
+            renderFluidShader->setMat4("uViewTranspose", viewTranspose);
             // parameters
-            renderFluidShader.setIvec2("uScreenSize", glm::ivec2(m_info->width, m_info->height));
-            renderFluidShader.setVec3("uFluidColor", glm::vec3(fluidColor[0], fluidColor[1], fluidColor[2]));
-            renderFluidShader.setFloat("uPointSize", static_cast<float>(simulator::PARTICLE_RADIUS * particleRadiusScaler));
-            renderFluidShader.setFloat("uMinimumDensity", static_cast<float>(minimumDensityScaler * simulator::REST_DENSITY));
-            renderFluidShader.setVec3("uCameraPosition", m_info->position());
+            renderFluidShader->setIvec2("uScreenSize", glm::ivec2(m_info->width, m_info->height));
+            renderFluidShader->setVec3("uFluidColor", glm::vec3(fluidColor[0], fluidColor[1], fluidColor[2]));
+            renderFluidShader->setFloat("uPointSize", static_cast<float>(simulator::PARTICLE_RADIUS * particleRadiusScaler));
+            renderFluidShader->setFloat("uMinimumDensity", static_cast<float>(minimumDensityScaler * simulator::REST_DENSITY));
+            renderFluidShader->setVec3("uCameraPosition", m_info->position());
             // textures
-            utils::bindTexture2D(renderFluidShader, "uNormalViewSpaceTexture", normalViewSpaceTexture, 0);
-            utils::bindTexture2D(renderFluidShader, "uThicknessTexture", thicknessTexture, 1);
-            utils::bindTexture2D(renderFluidShader, "uSceneColorTexture", m_sceneInfo->colorTexture, 2);
-            utils::bindTexture2D(renderFluidShader, "uSmoothedDepthTexture", m_info->smoothedDepthTexture, 3);
-            utils::bindTextureCubeMap(renderFluidShader, "uSkyboxTexture", m_sceneInfo->skyboxTexture, 4);
+            utils::bindTexture2D(*renderFluidShader, "uNormalViewSpaceTexture", normalViewSpaceTexture, 0);
+            utils::bindTexture2D(*renderFluidShader, "uThicknessTexture", thicknessTexture, 1);
+            utils::bindTexture2D(*renderFluidShader, "uSceneColorTexture", m_sceneInfo->colorTexture, 2);
+            utils::bindTexture2D(*renderFluidShader, "uSmoothedDepthTexture", m_info->smoothedDepthTexture, 3);
+            utils::bindTextureCubeMap(*renderFluidShader, "uSkyboxTexture", m_sceneInfo->skyboxTexture, 4);
 
             glBindVertexArray(VAO);
-            glDrawArrays(GL_POINTS, 0, simulator::PARTICLE_COUNT);
+            glDrawArrays(GL_POINTS, 0, simulator::particleCount);
             glBindVertexArray(0);
 
             glDisable(GL_PROGRAM_POINT_SIZE);
@@ -414,6 +370,8 @@ namespace renderer {
 
 
         int Fluid::renderDepth() {
+            PROFILE_GPU("renderDepth");
+
             glBindFramebuffer(GL_FRAMEBUFFER, FBO);
             glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
@@ -421,26 +379,26 @@ namespace renderer {
             glEnable(GL_DEPTH_TEST);
             glDepthFunc(GL_LESS);
 
-            renderFluidDepthShader.use();
+            renderFluidDepthShader->use();
             // MVP transform
             glm::mat4 uView = m_info->view();
-            renderFluidDepthShader.setMat4("uView", uView);
+            renderFluidDepthShader->setMat4("uView", uView);
             glm::mat4 uProjection = m_info->projection();
-            renderFluidDepthShader.setMat4("uProjection", uProjection);
+            renderFluidDepthShader->setMat4("uProjection", uProjection);
             glm::mat4 viewInverse = glm::inverse(uView);
-            renderFluidDepthShader.setMat4("uViewInverse", viewInverse);
+            renderFluidDepthShader->setMat4("uViewInverse", viewInverse);
             glm::mat4 viewTranspose = glm::transpose(uView);
-            renderFluidDepthShader.setMat4("uViewTranspose", viewTranspose);
+            renderFluidDepthShader->setMat4("uViewTranspose", viewTranspose);
             // parameters
-            renderFluidDepthShader.setIvec2("uScreenSize", glm::ivec2(m_info->width, m_info->height));
-            renderFluidDepthShader.setFloat("uPointSize", static_cast<float>(simulator::PARTICLE_RADIUS * particleRadiusScaler));
-            renderFluidDepthShader.setFloat("uMinimumDensity", static_cast<float>(minimumDensityScaler * simulator::REST_DENSITY));
+            renderFluidDepthShader->setIvec2("uScreenSize", glm::ivec2(m_info->width, m_info->height));
+            renderFluidDepthShader->setFloat("uPointSize", static_cast<float>(simulator::PARTICLE_RADIUS * particleRadiusScaler));
+            renderFluidDepthShader->setFloat("uMinimumDensity", static_cast<float>(minimumDensityScaler * simulator::REST_DENSITY));
             // textures
-            utils::bindTexture2D(renderFluidDepthShader, "uNormalViewSpaceTexture", normalViewSpaceTexture, 0);
-            utils::bindTexture2D(renderFluidDepthShader, "uSmoothedDepthTexture", m_info->smoothedDepthTexture, 1);
+            utils::bindTexture2D(*renderFluidDepthShader, "uNormalViewSpaceTexture", normalViewSpaceTexture, 0);
+            utils::bindTexture2D(*renderFluidDepthShader, "uSmoothedDepthTexture", m_info->smoothedDepthTexture, 1);
 
             glBindVertexArray(VAO);
-            glDrawArrays(GL_POINTS, 0, simulator::PARTICLE_COUNT);
+            glDrawArrays(GL_POINTS, 0, simulator::particleCount);
 
             glBindVertexArray(0);
             glDisable(GL_DEPTH_TEST);
@@ -451,6 +409,8 @@ namespace renderer {
         }
 
         int Fluid::renderThickness() {
+            PROFILE_GPU("renderThickness");
+
             glBindFramebuffer(GL_FRAMEBUFFER, FBO); 
             glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
@@ -458,28 +418,28 @@ namespace renderer {
             glEnable(GL_DEPTH_TEST);
             glDepthFunc(GL_LESS);
 
-            renderFluidThicknessShader.use();
+            renderFluidThicknessShader->use();
             // MVP transform
             glm::mat4 uView = m_info->view();
-            renderFluidThicknessShader.setMat4("uView", uView);
+            renderFluidThicknessShader->setMat4("uView", uView);
             glm::mat4 uProjection = m_info->projection();
-            renderFluidThicknessShader.setMat4("uProjection", uProjection);
+            renderFluidThicknessShader->setMat4("uProjection", uProjection);
             glm::mat4 viewInverse = glm::inverse(uView);
-            renderFluidThicknessShader.setMat4("uViewInverse", viewInverse);
+            renderFluidThicknessShader->setMat4("uViewInverse", viewInverse);
             glm::mat4 viewTranspose = glm::transpose(uView);
-            renderFluidThicknessShader.setMat4("uViewTranspose", viewTranspose);
+            renderFluidThicknessShader->setMat4("uViewTranspose", viewTranspose);
             // parameters
-            renderFluidThicknessShader.setIvec2("uScreenSize", glm::ivec2(m_info->width, m_info->height));
-            renderFluidThicknessShader.setVec3("uFluidColor", glm::vec3(fluidColor[0], fluidColor[1], fluidColor[2]));
-            renderFluidThicknessShader.setFloat("uPointSize", static_cast<float>(simulator::PARTICLE_RADIUS * particleRadiusScaler));
-            renderFluidThicknessShader.setFloat("uMinimumDensity", static_cast<float>(minimumDensityScaler * simulator::REST_DENSITY));
+            renderFluidThicknessShader->setIvec2("uScreenSize", glm::ivec2(m_info->width, m_info->height));
+            renderFluidThicknessShader->setVec3("uFluidColor", glm::vec3(fluidColor[0], fluidColor[1], fluidColor[2]));
+            renderFluidThicknessShader->setFloat("uPointSize", static_cast<float>(simulator::PARTICLE_RADIUS * particleRadiusScaler));
+            renderFluidThicknessShader->setFloat("uMinimumDensity", static_cast<float>(minimumDensityScaler * simulator::REST_DENSITY));
             // textures
-            utils::bindTexture2D(renderFluidThicknessShader, "uNormalViewSpaceTexture", normalViewSpaceTexture, 0);
-            utils::bindTexture2D(renderFluidThicknessShader, "uThicknessTexture", thicknessTexture, 1);
-            utils::bindTexture2D(renderFluidThicknessShader, "uSmoothedDepthTexture", m_info->smoothedDepthTexture, 2);
+            utils::bindTexture2D(*renderFluidThicknessShader, "uNormalViewSpaceTexture", normalViewSpaceTexture, 0);
+            utils::bindTexture2D(*renderFluidThicknessShader, "uThicknessTexture", thicknessTexture, 1);
+            utils::bindTexture2D(*renderFluidThicknessShader, "uSmoothedDepthTexture", m_info->smoothedDepthTexture, 2);
 
             glBindVertexArray(VAO);
-            glDrawArrays(GL_POINTS, 0, simulator::PARTICLE_COUNT);
+            glDrawArrays(GL_POINTS, 0, simulator::particleCount);
 
             glBindVertexArray(0);
 
@@ -491,6 +451,8 @@ namespace renderer {
         }
 
         int Fluid::renderNormal() {
+            PROFILE_GPU("renderNormal");
+
             glBindFramebuffer(GL_FRAMEBUFFER, FBO);
             glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
@@ -498,25 +460,25 @@ namespace renderer {
             glEnable(GL_DEPTH_TEST);
             glDepthFunc(GL_LESS);
 
-            renderFluidNormalShader.use();
+            renderFluidNormalShader->use();
             // MVP transform
             glm::mat4 uView = m_info->view();
-            renderFluidNormalShader.setMat4("uView", uView);
+            renderFluidNormalShader->setMat4("uView", uView);
             glm::mat4 uProjection = m_info->projection();
-            renderFluidNormalShader.setMat4("uProjection", uProjection);
+            renderFluidNormalShader->setMat4("uProjection", uProjection);
             glm::mat4 uViewInverse = glm::inverse(uView);
-            renderFluidNormalShader.setMat4("uViewInverse", uViewInverse);
+            renderFluidNormalShader->setMat4("uViewInverse", uViewInverse);
             glm::mat4 uViewTranspose = glm::transpose(uView);
-            renderFluidNormalShader.setMat4("uViewTranspose", uViewTranspose);
+            renderFluidNormalShader->setMat4("uViewTranspose", uViewTranspose);
             // other parameters
-            renderFluidNormalShader.setIvec2("uScreenSize", glm::ivec2(m_info->width, m_info->height));
-            renderFluidNormalShader.setFloat("uPointSize", static_cast<float>(simulator::PARTICLE_RADIUS * particleRadiusScaler));
-            renderFluidNormalShader.setFloat("uMinimumDensity", static_cast<float>(minimumDensityScaler * simulator::REST_DENSITY));
-            utils::bindTexture2D(renderFluidNormalShader, "uNormalViewSpaceTexture", normalViewSpaceTexture, 0);
-            utils::bindTexture2D(renderFluidNormalShader, "uSmoothedDepthTexture", m_info->smoothedDepthTexture, 1);
+            renderFluidNormalShader->setIvec2("uScreenSize", glm::ivec2(m_info->width, m_info->height));
+            renderFluidNormalShader->setFloat("uPointSize", static_cast<float>(simulator::PARTICLE_RADIUS * particleRadiusScaler));
+            renderFluidNormalShader->setFloat("uMinimumDensity", static_cast<float>(minimumDensityScaler * simulator::REST_DENSITY));
+            utils::bindTexture2D(*renderFluidNormalShader, "uNormalViewSpaceTexture", normalViewSpaceTexture, 0);
+            utils::bindTexture2D(*renderFluidNormalShader, "uSmoothedDepthTexture", m_info->smoothedDepthTexture, 1);
 
             glBindVertexArray(VAO);
-            glDrawArrays(GL_POINTS, 0, simulator::PARTICLE_COUNT);
+            glDrawArrays(GL_POINTS, 0, simulator::particleCount);
 
             glBindVertexArray(0);
 
@@ -529,6 +491,8 @@ namespace renderer {
         }
 
         int Fluid::renderParticle() {
+            PROFILE_GPU("renderParticle");
+
             glBindFramebuffer(GL_FRAMEBUFFER, FBO);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -536,21 +500,21 @@ namespace renderer {
             glEnable(GL_DEPTH_TEST);
             glDepthFunc(GL_LESS);
 
-            particleShader.use();
+            particleShader->use();
             // MVP transform
             glm::mat4 uView = m_info->view();
-            particleShader.setMat4("uView", uView);
+            particleShader->setMat4("uView", uView);
             glm::mat4 uProjection = m_info->projection();
-            particleShader.setMat4("uProjection", uProjection);
+            particleShader->setMat4("uProjection", uProjection);
             glm::mat4 uViewInverse = glm::inverse(uView);
-            particleShader.setMat4("uViewInverse", uViewInverse);
+            particleShader->setMat4("uViewInverse", uViewInverse);
             glm::mat4 uViewTranspose = glm::transpose(uView);
-            particleShader.setMat4("uViewTranspose", uViewTranspose);
+            particleShader->setMat4("uViewTranspose", uViewTranspose);
             // other parameters
-            particleShader.setIvec2("uScreenSize", glm::ivec2(m_info->width, m_info->height));
-            particleShader.setVec3("uFluidColor", glm::vec3(fluidColor[0], fluidColor[1], fluidColor[2]));
-            particleShader.setFloat("uPointSize", static_cast<float>(simulator::PARTICLE_RADIUS * particleRadiusScaler));
-            particleShader.setFloat("uMinimumDensity", static_cast<float>(minimumDensityScaler * simulator::REST_DENSITY));
+            particleShader->setIvec2("uScreenSize", glm::ivec2(m_info->width, m_info->height));
+            particleShader->setVec3("uFluidColor", glm::vec3(fluidColor[0], fluidColor[1], fluidColor[2]));
+            particleShader->setFloat("uPointSize", static_cast<float>(simulator::PARTICLE_RADIUS * particleRadiusScaler));
+            particleShader->setFloat("uMinimumDensity", static_cast<float>(minimumDensityScaler * simulator::REST_DENSITY));
             // light
             glm::vec3 lightDir = glm::vec3(1.0f, 1.0f, 0.5f);
             glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
@@ -558,15 +522,15 @@ namespace renderer {
             float diffuse = 1.0f;
             float specular = 0.5f;
             float shininess = 64.0f;
-            particleShader.setVec3("uLight.direction", lightDir);
-            particleShader.setVec3("uLight.color", lightColor);
-            particleShader.setFloat("uLight.ambient", ambient);
-            particleShader.setFloat("uLight.diffuse", diffuse);
-            particleShader.setFloat("uLight.specular", specular);
-            particleShader.setFloat("uLight.shininess", shininess);
+            particleShader->setVec3("uLight.direction", lightDir);
+            particleShader->setVec3("uLight.color", lightColor);
+            particleShader->setFloat("uLight.ambient", ambient);
+            particleShader->setFloat("uLight.diffuse", diffuse);
+            particleShader->setFloat("uLight.specular", specular);
+            particleShader->setFloat("uLight.shininess", shininess);
 
             glBindVertexArray(VAO);
-            glDrawArrays(GL_POINTS, 0, simulator::PARTICLE_COUNT);
+            glDrawArrays(GL_POINTS, 0, simulator::particleCount);
             glBindVertexArray(0);
 
             glDisable(GL_PROGRAM_POINT_SIZE);
@@ -576,6 +540,8 @@ namespace renderer {
         }
 
         int Fluid::renderFoamTexture() {
+            PROFILE_GPU("renderFoamTexture");
+
             glBindFramebuffer(GL_FRAMEBUFFER, foamFBO);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
             
@@ -583,18 +549,18 @@ namespace renderer {
             glEnable(GL_DEPTH_TEST);
             glDepthFunc(GL_LESS);
 
-            renderFoamTextureShader.use();
+            renderFoamTextureShader->use();
             glm::mat4 uView = m_info->view();
-            renderFoamTextureShader.setMat4("uView", uView);
+            renderFoamTextureShader->setMat4("uView", uView);
             glm::mat4 uProjection = m_info->projection();
-            renderFoamTextureShader.setMat4("uProjection", uProjection);
-            renderFoamTextureShader.setFloat("uPointSize", static_cast<float>(simulator::PARTICLE_RADIUS * particleRadiusScaler));
+            renderFoamTextureShader->setMat4("uProjection", uProjection);
+            renderFoamTextureShader->setFloat("uPointSize", static_cast<float>(simulator::PARTICLE_RADIUS * particleRadiusScaler));
             // other parameters
-            renderFoamTextureShader.setFloat("uMinimumDensity", static_cast<float>(minimumDensityScaler * simulator::REST_DENSITY));
-            renderFoamTextureShader.setFloat("uFoamDensity", static_cast<float>(foamDensityScaler * simulator::REST_DENSITY));
+            renderFoamTextureShader->setFloat("uMinimumDensity", static_cast<float>(minimumDensityScaler * simulator::REST_DENSITY));
+            renderFoamTextureShader->setFloat("uFoamDensity", static_cast<float>(foamDensityScaler * simulator::REST_DENSITY));
 
             glBindVertexArray(VAO);
-            glDrawArrays(GL_POINTS, 0, simulator::PARTICLE_COUNT);
+            glDrawArrays(GL_POINTS, 0, simulator::particleCount);
             glBindVertexArray(0);
 
             glDisable(GL_PROGRAM_POINT_SIZE);
@@ -604,20 +570,22 @@ namespace renderer {
         }
 
         int Fluid::erodeFoamTexture() {
-            erodeFoamTextureCS.use();
-            erodeFoamTextureCS.setIvec2("uResolution", glm::ivec2(m_info->width, m_info->height));
-            erodeFoamTextureCS.setInt("uKernelRadius", foamErodeKernelRadius);
-            erodeFoamTextureCS.setInt("uMinimunNeighborCount", foamErodeMinimunNeighborCount);
+            erodeFoamTextureCS->use();
+            erodeFoamTextureCS->setIvec2("uResolution", glm::ivec2(m_info->width, m_info->height));
+            erodeFoamTextureCS->setInt("uKernelRadius", foamErodeKernelRadius);
+            erodeFoamTextureCS->setInt("uMinimunNeighborCount", foamErodeMinimunNeighborCount);
             utils::bindTextureWithLayer0(foamTexture, 3, GL_R8I, GL_READ_ONLY);
             utils::bindTextureWithLayer0(erodedFoamTexture, 4, GL_R8I, GL_WRITE_ONLY);
 
-            erodeFoamTextureCS.dispatchCompute(m_info->width * m_info->height);
+            erodeFoamTextureCS->dispatchCompute(m_info->width * m_info->height);
             glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 
             return 0;
         }
 
         int Fluid::renderFoam() {
+            PROFILE_GPU("renderFoam");
+
             renderFoamTexture();
             erodeFoamTexture();
 
@@ -628,8 +596,8 @@ namespace renderer {
                 glClear(GL_COLOR_BUFFER_BIT);
             }
             
-            renderFoamShader.use();
-            utils::bindTexture2D(renderFoamShader, "uFoamTexture", erodedFoamTexture, 0);
+            renderFoamShader->use();
+            utils::bindTexture2D(*renderFoamShader, "uFoamTexture", erodedFoamTexture, 0);
 
             utils::drawScreenQuad();
 
@@ -640,12 +608,14 @@ namespace renderer {
         }
 
         int Fluid::computeEdgeTexture() {
-            edgeCS.use();
-            edgeCS.setIvec2("uResolution", glm::ivec2(m_info->width, m_info->height));
+            PROFILE_GPU("computeEdgeTexture");
+
+            edgeCS->use();
+            edgeCS->setIvec2("uResolution", glm::ivec2(m_info->width, m_info->height));
             utils::bindTextureWithLayer0(m_info->validTexture, 5, GL_R8I, GL_READ_ONLY);
             utils::bindTextureWithLayer0(edgeTexture, 6, GL_R8I, GL_WRITE_ONLY);
 
-            edgeCS.dispatchCompute(m_info->width * m_info->height);
+            edgeCS->dispatchCompute(m_info->width * m_info->height);
             glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 
             for (int i = 0; i < edgeSize; i++) {
@@ -656,12 +626,14 @@ namespace renderer {
         }
 
         int Fluid::extendEdgeTexture() {
-            extendEdgeCS.use();
-            extendEdgeCS.setIvec2("uResolution", glm::ivec2(m_info->width, m_info->height));
+            PROFILE_GPU("extendEdgeTexture");
+
+            extendEdgeCS->use();
+            extendEdgeCS->setIvec2("uResolution", glm::ivec2(m_info->width, m_info->height));
             utils::bindTextureWithLayer0(edgeTexture, 6, GL_R8I, GL_READ_ONLY);
             utils::bindTextureWithLayer0(extendedEdgeTexture, 7, GL_R8I, GL_WRITE_ONLY);
 
-            extendEdgeCS.dispatchCompute(m_info->width * m_info->height);
+            extendEdgeCS->dispatchCompute(m_info->width * m_info->height);
             glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 
             utils::copyTexture2D(extendedEdgeTexture, edgeTexture, m_info->width, m_info->height);
@@ -670,13 +642,15 @@ namespace renderer {
         }
 
         int Fluid::renderEdge() {
+            PROFILE_GPU("renderEdge");
+
             computeEdgeTexture();
 
             glBindFramebuffer(GL_FRAMEBUFFER, FBO);
             glDepthFunc(GL_ALWAYS);
 
-            renderEdgeShader.use();
-            utils::bindTexture2D(renderEdgeShader, "uEdgeTexture", edgeTexture, 0);
+            renderEdgeShader->use();
+            utils::bindTexture2D(*renderEdgeShader, "uEdgeTexture", edgeTexture, 0);
 
             utils::drawScreenQuad();
 
@@ -687,6 +661,8 @@ namespace renderer {
         }
 
         int Fluid::renderCartoon() {
+            PROFILE_GPU("renderCartoon");
+
             glBindFramebuffer(GL_FRAMEBUFFER, FBO);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -695,41 +671,41 @@ namespace renderer {
             glDepthFunc(GL_LESS);
             glDepthMask(GL_TRUE);
 
-            renderCartoonShader.use();
+            renderCartoonShader->use();
             // MVP transform
             glm::mat4 uView = m_info->view();
-            renderCartoonShader.setMat4("uView", uView);
+            renderCartoonShader->setMat4("uView", uView);
             glm::mat4 uProjection = m_info->projection();
-            renderCartoonShader.setMat4("uProjection", uProjection);
+            renderCartoonShader->setMat4("uProjection", uProjection);
             glm::mat4 viewInverse = glm::inverse(uView);
-            renderCartoonShader.setMat4("uViewInverse", viewInverse);
+            renderCartoonShader->setMat4("uViewInverse", viewInverse);
             glm::mat4 viewTranspose = glm::transpose(uView);
-            renderCartoonShader.setMat4("uViewTranspose", viewTranspose);
+            renderCartoonShader->setMat4("uViewTranspose", viewTranspose);
             // parameters
-            renderCartoonShader.setIvec2("uScreenSize", glm::ivec2(m_info->width, m_info->height));
-            renderCartoonShader.setVec3("uFluidColor", glm::vec3(fluidColor[0], fluidColor[1], fluidColor[2]));
-            renderCartoonShader.setFloat("uPointSize", static_cast<float>(simulator::PARTICLE_RADIUS * particleRadiusScaler));
-            renderCartoonShader.setFloat("uMinimumDensity", static_cast<float>(minimumDensityScaler * simulator::REST_DENSITY));
-            renderCartoonShader.setVec3("uCameraPosition", m_info->position());
+            renderCartoonShader->setIvec2("uScreenSize", glm::ivec2(m_info->width, m_info->height));
+            renderCartoonShader->setVec3("uFluidColor", glm::vec3(fluidColor[0], fluidColor[1], fluidColor[2]));
+            renderCartoonShader->setFloat("uPointSize", static_cast<float>(simulator::PARTICLE_RADIUS * particleRadiusScaler));
+            renderCartoonShader->setFloat("uMinimumDensity", static_cast<float>(minimumDensityScaler * simulator::REST_DENSITY));
+            renderCartoonShader->setVec3("uCameraPosition", m_info->position());
             // textures
-            utils::bindTexture2D(renderCartoonShader, "uNormalViewSpaceTexture", normalViewSpaceTexture, 0);
-            utils::bindTexture2D(renderCartoonShader, "uThicknessTexture", thicknessTexture, 1);
-            utils::bindTexture2D(renderCartoonShader, "uSceneColorTexture", m_sceneInfo->colorTexture, 2);
-            utils::bindTexture2D(renderCartoonShader, "uSmoothedDepthTexture", m_info->smoothedDepthTexture, 3);
-            utils::bindTextureCubeMap(renderCartoonShader, "uSkyboxTexture", m_sceneInfo->skyboxTexture, 4);
-            utils::bindTexture2D(renderCartoonShader, "uValidTexture", m_info->validTexture, 5);
+            utils::bindTexture2D(*renderCartoonShader, "uNormalViewSpaceTexture", normalViewSpaceTexture, 0);
+            utils::bindTexture2D(*renderCartoonShader, "uThicknessTexture", thicknessTexture, 1);
+            utils::bindTexture2D(*renderCartoonShader, "uSceneColorTexture", m_sceneInfo->colorTexture, 2);
+            utils::bindTexture2D(*renderCartoonShader, "uSmoothedDepthTexture", m_info->smoothedDepthTexture, 3);
+            utils::bindTextureCubeMap(*renderCartoonShader, "uSkyboxTexture", m_sceneInfo->skyboxTexture, 4);
+            utils::bindTexture2D(*renderCartoonShader, "uValidTexture", m_info->validTexture, 5);
             // cartoon
-            renderCartoonShader.setFloat("uBrightThreshold", brightThreshold);
-            renderCartoonShader.setFloat("uBrightFactor", brightFactor);
-            renderCartoonShader.setFloat("uDarkThreshold", darkThreshold);
-            renderCartoonShader.setFloat("uDarkFactor", darkFactor);
-            renderCartoonShader.setFloat("uRefractThreshold", refractThreshold);
-            renderCartoonShader.setFloat("uRefractMax", refractMax);
-            renderCartoonShader.setFloat("uReflectThreshold", reflectThreshold);
-            renderCartoonShader.setFloat("uReflectMax", reflectMax);
+            renderCartoonShader->setFloat("uBrightThreshold", brightThreshold);
+            renderCartoonShader->setFloat("uBrightFactor", brightFactor);
+            renderCartoonShader->setFloat("uDarkThreshold", darkThreshold);
+            renderCartoonShader->setFloat("uDarkFactor", darkFactor);
+            renderCartoonShader->setFloat("uRefractThreshold", refractThreshold);
+            renderCartoonShader->setFloat("uRefractMax", refractMax);
+            renderCartoonShader->setFloat("uReflectThreshold", reflectThreshold);
+            renderCartoonShader->setFloat("uReflectMax", reflectMax);
 
             glBindVertexArray(VAO);
-            glDrawArrays(GL_POINTS, 0, simulator::PARTICLE_COUNT);
+            glDrawArrays(GL_POINTS, 0, simulator::particleCount);
             glBindVertexArray(0);
 
             glDisable(GL_PROGRAM_POINT_SIZE);
@@ -745,6 +721,8 @@ namespace renderer {
         }
         
         int Fluid::render(bool prepare) {
+            PROFILE_GPU("fluid");
+
             m_info->setViewport();
 
             if (prepare) {
@@ -788,24 +766,22 @@ namespace renderer {
         Fluid::~Fluid() {
             glDeleteFramebuffers(1, &depthFBO);
             glDeleteFramebuffers(1, &thicknessFBO);
-            glDeleteTextures(1, &smoothedDepthAidTexture);
-            glDeleteTextures(1, &normalViewSpaceTexture);
-            glDeleteTextures(1, &repairedNormalViewSpaceTexture);
-
-            glDeleteProgram(renderFluidShader.ID);
-            glDeleteProgram(renderCartoonShader.ID);
-            glDeleteProgram(renderFluidDepthShader.ID);
-            glDeleteProgram(renderFluidDepthTextureShader.ID);
-            glDeleteProgram(renderFluidThicknessTextureShader.ID);
-            glDeleteProgram(smoothDepthCS.ID);
-            glDeleteProgram(computeFluidNormalCS.ID);
-            glDeleteProgram(fixInvalidNormalsCS.ID);
+            common::gpuDeleteTextures(1, &smoothedDepthAidTexture);
+            common::gpuDeleteTextures(1, &normalViewSpaceTexture);
+            common::gpuDeleteTextures(1, &repairedNormalViewSpaceTexture);
+            common::gpuDeleteTextures(1, &thicknessTexture);
+            common::gpuDeleteTextures(1, &foamTexture);
+            common::gpuDeleteTextures(1, &erodedFoamTexture);
+            common::gpuDeleteTextures(1, &edgeTexture);
+            common::gpuDeleteTextures(1, &extendedEdgeTexture);
+            glDeleteVertexArrays(1, &VAO);
         }       
 
 
-        int Fluid::copyParticleAttribute() {
-            utils::copySSBO2VBO(simulator::particlePositionSSBO, VBO, simulator::PARTICLE_COUNT * sizeof(glm::vec4));
-            utils::copySSBO2VBO(simulator::densitySSBO, densityVBO, simulator::PARTICLE_COUNT * sizeof(float));
+        int Fluid::bindParticleBuffer() {
+            // the simulator swaps its position buffers every frame, so the binding follows the current one
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARTICLE_POSITION_BINDING, simulator::particlePositionSSBO);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARTICLE_DENSITY_BINDING, simulator::densitySSBO);
 
             return 0;
         }
@@ -4,6 +4,7 @@
 
 #include "../common/shader.hpp"
 #include "../common/compute_shader.hpp"
+#include "../common/program_registry.hpp"
 #include "camera.hpp"
 #include "info.hpp"
 
@@ -24,9 +25,28 @@ namespace renderer {
             private:
                 std::shared_ptr<renderer::info::SceneInfo> m_sceneInfo;
 
+                // the other Fluid instances share these through the program registry
+                std::shared_ptr<Shader> renderFluidShader;
+                std::shared_ptr<Shader> renderCartoonShader;
+                std::shared_ptr<Shader> renderFluidDepthShader;
+                std::shared_ptr<Shader> renderFluidNormalShader;
+                std::shared_ptr<Shader> renderFluidThicknessShader;
+                std::shared_ptr<Shader> particleShader;
+                std::shared_ptr<Shader> renderFluidDepthTextureShader;
+                std::shared_ptr<Shader> renderFluidThicknessTextureShader;
+                std::shared_ptr<Shader> renderFoamTextureShader;
+                std::shared_ptr<Shader> renderFoamShader;
+                std::shared_ptr<Shader> renderEdgeShader;
+                std::shared_ptr<ComputeShader> clearCS;
+                std::shared_ptr<ComputeShader> smoothDepthCS;
+                std::shared_ptr<ComputeShader> computeFluidNormalCS;
+                std::shared_ptr<ComputeShader> erodeFoamTextureCS;
+                std::shared_ptr<ComputeShader> edgeCS;
+                std::shared_ptr<ComputeShader> extendEdgeCS;
+                std::shared_ptr<ComputeShader> fixInvalidNormalsCS;
+
                 GLuint FBO;
                 GLuint VAO;
-                GLuint VBO;
                 GLuint depthFBO;
                 GLuint thicknessFBO;
 
@@ -35,8 +55,6 @@ namespace renderer {
                 GLuint normalViewSpaceTexture;
                 GLuint repairedNormalViewSpaceTexture;
 
-                GLuint densityVBO;
-
                 int init();
                 int clear();
                 int renderDepthTexture();
@@ -65,7 +83,7 @@ namespace renderer {
                 int extendEdgeTexture();
                 int renderEdge();
 
-                int copyParticleAttribute();
+                int bindParticleBuffer();
         };
     }
 }
\ No newline at end of file
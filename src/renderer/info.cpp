@@ -42,14 +42,14 @@ namespace renderer {
         }
 
         SceneInfo::~SceneInfo() {
-            glDeleteTextures(1, &colorTexture);
-            glDeleteTextures(1, &validTexture);
-            glDeleteTextures(1, &depthTexture);
-            glDeleteTextures(1, &positionTexture);
-            glDeleteTextures(1, &normalTexture);
-
-            glDeleteTextures(1, &skyboxColorTexture);
-            glDeleteTextures(1, &otherSceneColorTexture);
+            common::gpuDeleteTextures(1, &colorTexture);
+            common::gpuDeleteTextures(1, &validTexture);
+            common::gpuDeleteTextures(1, &depthTexture);
+            common::gpuDeleteTextures(1, &positionTexture);
+            common::gpuDeleteTextures(1, &normalTexture);
+
+            common::gpuDeleteTextures(1, &skyboxColorTexture);
+            common::gpuDeleteTextures(1, &otherSceneColorTexture);
         }
 
         // Fluid Info
@@ -64,12 +64,12 @@ namespace renderer {
         }
 
         FluidInfo::~FluidInfo() {
-            glDeleteTextures(1, &colorTexture);
-            glDeleteTextures(1, &validTexture);
-            glDeleteTextures(1, &positionTexture);
-            glDeleteTextures(1, &normalTexture);
-            glDeleteTextures(1, &depthTexture);
-            glDeleteTextures(1, &smoothedDepthTexture);
+            common::gpuDeleteTextures(1, &colorTexture);
+            common::gpuDeleteTextures(1, &validTexture);
+            common::gpuDeleteTextures(1, &positionTexture);
+            common::gpuDeleteTextures(1, &normalTexture);
+            common::gpuDeleteTextures(1, &depthTexture);
+            common::gpuDeleteTextures(1, &smoothedDepthTexture);
         }
 
         // Caustics Info
@@ -86,43 +86,43 @@ namespace renderer {
             photonCount = width * height;
             glGenBuffers(1, &photonPositionVBO);
             glBindBuffer(GL_ARRAY_BUFFER, photonPositionVBO);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec4) * photonCount, NULL, GL_DYNAMIC_DRAW);
+            common::gpuBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec4) * photonCount, NULL, GL_DYNAMIC_DRAW);
             glBindBuffer(GL_ARRAY_BUFFER, 0);
 
             glGenBuffers(1, &redPhotonPositionVBO);
             glBindBuffer(GL_ARRAY_BUFFER, redPhotonPositionVBO);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec4) * photonCount, NULL, GL_DYNAMIC_DRAW);
+            common::gpuBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec4) * photonCount, NULL, GL_DYNAMIC_DRAW);
             glBindBuffer(GL_ARRAY_BUFFER, 0);
 
             glGenBuffers(1, &greenPhotonPositionVBO);
             glBindBuffer(GL_ARRAY_BUFFER, greenPhotonPositionVBO);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec4) * photonCount, NULL, GL_DYNAMIC_DRAW);
+            common::gpuBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec4) * photonCount, NULL, GL_DYNAMIC_DRAW);
             glBindBuffer(GL_ARRAY_BUFFER, 0);
 
             glGenBuffers(1, &bluePhotonPositionVBO);
             glBindBuffer(GL_ARRAY_BUFFER, bluePhotonPositionVBO);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec4) * photonCount, NULL, GL_DYNAMIC_DRAW);
+            common::gpuBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec4) * photonCount, NULL, GL_DYNAMIC_DRAW);
             glBindBuffer(GL_ARRAY_BUFFER, 0);
 
             glGenBuffers(1, &photonSSBO);
             glBindBuffer(GL_SHADER_STORAGE_BUFFER, photonSSBO);
-            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(glm::vec4) * photonCount, NULL, GL_DYNAMIC_COPY);
+            common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(glm::vec4) * photonCount, NULL, GL_DYNAMIC_COPY);
             glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
         }
 
         CausticsInfo::~CausticsInfo() {
-            glDeleteTextures(1, &depthTexture);
-            glDeleteTextures(1, &validTexture);
-            glDeleteTextures(1, &terminatePositionTexture);
-            glDeleteTextures(1, &redPositionTexture);
-            glDeleteTextures(1, &greenPositionTexture);
-            glDeleteTextures(1, &bluePositionTexture);
-
-            glDeleteBuffers(1, &photonPositionVBO);
-            glDeleteBuffers(1, &redPhotonPositionVBO);
-            glDeleteBuffers(1, &greenPhotonPositionVBO);
-            glDeleteBuffers(1, &bluePhotonPositionVBO);
-            glDeleteBuffers(1, &photonSSBO);
+            common::gpuDeleteTextures(1, &depthTexture);
+            common::gpuDeleteTextures(1, &validTexture);
+            common::gpuDeleteTextures(1, &terminatePositionTexture);
+            common::gpuDeleteTextures(1, &redPositionTexture);
+            common::gpuDeleteTextures(1, &greenPositionTexture);
+            common::gpuDeleteTextures(1, &bluePositionTexture);
+
+            common::gpuDeleteBuffers(1, &photonPositionVBO);
+            common::gpuDeleteBuffers(1, &redPhotonPositionVBO);
+            common::gpuDeleteBuffers(1, &greenPhotonPositionVBO);
+            common::gpuDeleteBuffers(1, &bluePhotonPositionVBO);
+            common::gpuDeleteBuffers(1, &photonSSBO);
         }
     }
 }
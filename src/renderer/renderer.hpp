@@ -9,6 +9,7 @@
 #include <memory>
 
 #include "../common/common.hpp"
+#include "../common/program_registry.hpp"
 #include "scene.hpp"
 #include "sceneWithCaustics.hpp"
 #include "fluid.hpp"
@@ -40,6 +41,9 @@ namespace renderer {
             std::shared_ptr<scene::Scene> m_scene;
             std::shared_ptr<fluid::Fluid> m_fluid;
 
+            std::shared_ptr<Shader> fluidAndSceneShader;
+            std::shared_ptr<Shader> photonTerminatePositionShader;
+
             int init();
 
             int renderCausticsTerminatePosition();
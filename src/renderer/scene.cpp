@@ -11,16 +11,12 @@
 
 #include "../common/shader.hpp"
 #include "../common/compute_shader.hpp"
+#include "../common/profiler.hpp"
 #include "utils.hpp"
 #include "parameter.hpp"
 
 namespace renderer {
     namespace scene {
-        ComputeShader clearCS;
-        Shader skyboxShader;
-        Shader floorShader;
-        Shader shader;
-
         // skybox
         std::vector<float> skyboxVertices = {
             // positions          
@@ -100,7 +96,7 @@ namespace renderer {
 
         // scene
         int Scene::initSkybox() {
-            skyboxShader = Shader("src/renderer/shader/scene/skybox/skybox.vert", "src/renderer/shader/scene/skybox/skybox.frag");
+            skyboxShader = common::acquireShader("src/renderer/shader/scene/skybox/skybox.vert", "src/renderer/shader/scene/skybox/skybox.frag");
 
             stbi_set_flip_vertically_on_load(false);
             skyboxTextureRealistic = utils::loadCubemap(skyboxFacesRealistic);
@@ -127,7 +123,7 @@ namespace renderer {
         
             glBindVertexArray(skyboxVAO);
             glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-            glBufferData(GL_ARRAY_BUFFER, skyboxVertices.size() * sizeof(float), &skyboxVertices[0], GL_STATIC_DRAW);
+            common::gpuBufferData(GL_ARRAY_BUFFER, skyboxVertices.size() * sizeof(float), &skyboxVertices[0], GL_STATIC_DRAW);
 
             glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
             glEnableVertexAttribArray(0);
@@ -139,19 +135,21 @@ namespace renderer {
         }
 
         int Scene::renderSkybox() {
+            PROFILE_GPU("renderSkybox");
+
             glBindFramebuffer(GL_FRAMEBUFFER, skyboxFBO);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
             glEnable(GL_DEPTH_TEST);
             glDepthFunc(GL_LEQUAL);
             glDepthMask(GL_TRUE);
 
-            skyboxShader.use();
+            skyboxShader->use();
 
             glm::mat4 uView = glm::mat4(glm::mat3(m_info->view()));
-            skyboxShader.setMat4("uView", uView);
+            skyboxShader->setMat4("uView", uView);
 
             glm::mat4 uProjection = m_info->projection();
-            skyboxShader.setMat4("uProjection", uProjection);
+            skyboxShader->setMat4("uProjection", uProjection);
 
             if (renderer::fluid::displayMode == renderer::fluid::DisplayMode::CARTOON || renderer::fluid::displayMode == renderer::fluid::DisplayMode::FOAM) {
                 m_info->skyboxTexture = skyboxTextureCartoon;
@@ -159,7 +157,7 @@ namespace renderer {
             else {
                 m_info->skyboxTexture = skyboxTextureRealistic;
             }
-            utils::bindTextureCubeMap(skyboxShader, "uSkyboxTexture", m_info->skyboxTexture, 0);
+            utils::bindTextureCubeMap(*skyboxShader, "uSkyboxTexture", m_info->skyboxTexture, 0);
 
             glBindVertexArray(skyboxVAO);
             glDrawArrays(GL_TRIANGLES, 0, 36);
@@ -173,11 +171,10 @@ namespace renderer {
 
         int Scene::terminateSkybox() {
             glDeleteVertexArrays(1, &skyboxVAO);
-            glDeleteBuffers(1, &skyboxVBO);
-            glDeleteProgram(skyboxShader.ID);
+            common::gpuDeleteBuffers(1, &skyboxVBO);
 
-            glDeleteTextures(1, &skyboxTextureRealistic);
-            glDeleteTextures(1, &skyboxTextureCartoon);
+            common::gpuDeleteTextures(1, &skyboxTextureRealistic);
+            common::gpuDeleteTextures(1, &skyboxTextureCartoon);
 
             skyboxVertices.clear();
             skyboxFacesRealistic.clear();
@@ -187,7 +184,7 @@ namespace renderer {
         }
     
         int Scene::initFloor() {
-            floorShader = Shader("src/renderer/shader/scene/floor/floor.vert", "src/renderer/shader/scene/floor/floor.frag");
+            floorShader = common::acquireShader("src/renderer/shader/scene/floor/floor.vert", "src/renderer/shader/scene/floor/floor.frag");
 
             stbi_set_flip_vertically_on_load(false);
             floorTextureRealistic = utils::loadTexture("resource/floor/realistic.jpg");
@@ -218,7 +215,7 @@ namespace renderer {
 
             glBindVertexArray(floorVAO);
             glBindBuffer(GL_ARRAY_BUFFER, floorVBO);
-            glBufferData(GL_ARRAY_BUFFER, floorVertices.size() * sizeof(float), &floorVertices[0], GL_STATIC_DRAW);
+            common::gpuBufferData(GL_ARRAY_BUFFER, floorVertices.size() * sizeof(float), &floorVertices[0], GL_STATIC_DRAW);
 
             glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
             glEnableVertexAttribArray(0);
@@ -235,13 +232,15 @@ namespace renderer {
         }
 
         int Scene::renderFloor() {
+            PROFILE_GPU("renderFloor");
+
             glBindFramebuffer(GL_FRAMEBUFFER, floorFBO);
             glClear(GL_COLOR_BUFFER_BIT);
             glEnable(GL_DEPTH_TEST);
             glDepthFunc(GL_LEQUAL);
             glDepthMask(GL_TRUE);
 
-            floorShader.use();
+            floorShader->use();
             // MVP transform
             glm::mat4 uModel = glm::mat4(1.0f);
             uModel = glm::scale(uModel, glm::vec3(FLOOR_SIZE, 1.0f, FLOOR_SIZE));
@@ -251,23 +250,23 @@ namespace renderer {
             uModel = glm::translate(uModel, glm::vec3(0.0f, -0.25f, 0.0f));
             #endif
             // uModel = glm::translate(uModel, glm::vec3(0.0f, -1.0f, 0.0f));
-            floorShader.setMat4("uModel", uModel);
+            floorShader->setMat4("uModel", uModel);
             glm::mat4 uView = m_info->view();
-            floorShader.setMat4("uView", uView);
+            floorShader->setMat4("uView", uView);
             glm::mat4 uProjection = m_info->projection();
-            floorShader.setMat4("uProjection", uProjection);
+            floorShader->setMat4("uProjection", uProjection);
             glm::mat4 uModelTranspose = glm::transpose(uModel);
-            floorShader.setMat4("uModelTranspose", uModelTranspose);
+            floorShader->setMat4("uModelTranspose", uModelTranspose);
             // textures
             if (renderer::fluid::displayMode == renderer::fluid::DisplayMode::CARTOON || renderer::fluid::displayMode == renderer::fluid::DisplayMode::FOAM) {
-                utils::bindTexture2D(floorShader, "uFloorTexture", floorTextureCartoon, 0);
+                utils::bindTexture2D(*floorShader, "uFloorTexture", floorTextureCartoon, 0);
             }
             else {
-                utils::bindTexture2D(floorShader, "uFloorTexture", floorTextureRealistic, 0);
+                utils::bindTexture2D(*floorShader, "uFloorTexture", floorTextureRealistic, 0);
             }
             // light
-            floorShader.setVec3("uLight.position", glm::vec3(3.0f, 3.0f, 3.0f));
-            floorShader.setVec3("uLight.intensity", glm::vec3(1.0f, 1.0f, 1.0f));
+            floorShader->setVec3("uLight.position", glm::vec3(3.0f, 3.0f, 3.0f));
+            floorShader->setVec3("uLight.intensity", glm::vec3(1.0f, 1.0f, 1.0f));
 
             glBindVertexArray(floorVAO);
             glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -280,10 +279,9 @@ namespace renderer {
 
         int Scene::terminateFloor() {
             glDeleteVertexArrays(1, &floorVAO);
-            glDeleteBuffers(1, &floorVBO);
-            glDeleteTextures(1, &floorTextureRealistic);
-            glDeleteTextures(1, &floorTextureCartoon);
-            glDeleteProgram(floorShader.ID);
+            common::gpuDeleteBuffers(1, &floorVBO);
+            common::gpuDeleteTextures(1, &floorTextureRealistic);
+            common::gpuDeleteTextures(1, &floorTextureCartoon);
 
             floorVertices.clear();
 
@@ -291,8 +289,8 @@ namespace renderer {
         }
 
         int Scene::init() {
-            clearCS = ComputeShader("src/renderer/shader/scene/clear.comp");
-            shader = Shader("src/renderer/shader/scene/scene.vert", "src/renderer/shader/scene/scene.frag");
+            clearCS = common::acquireComputeShader("src/renderer/shader/scene/clear.comp");
+            shader = common::acquireShader("src/renderer/shader/scene/scene.vert", "src/renderer/shader/scene/scene.frag");
 
             // framebuffer
             {
@@ -319,15 +317,17 @@ namespace renderer {
         }
 
         int Scene::clear() {
-            clearCS.use();
-            clearCS.setIvec2("uScreenSize", glm::ivec2(m_info->width, m_info->height));
-            clearCS.dispatchCompute(m_info->width * m_info->height);
+            clearCS->use();
+            clearCS->setIvec2("uScreenSize", glm::ivec2(m_info->width, m_info->height));
+            clearCS->dispatchCompute(m_info->width * m_info->height);
 
             glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
             return 0;
         }
 
         int Scene::render() {
+            PROFILE_GPU("scene");
+
             m_info->setViewport();
 
             // prepare
@@ -342,10 +342,10 @@ namespace renderer {
             glDepthFunc(GL_LESS);
             glDepthMask(GL_FALSE);
 
-            shader.use();
-            utils::bindTexture2D(shader, "uOtherSceneColorTexture", m_info->otherSceneColorTexture, 0);
-            utils::bindTexture2D(shader, "uSkyboxColorTexture", m_info->skyboxColorTexture, 1);
-            utils::bindTexture2D(shader, "uValidTexture", m_info->validTexture, 2);
+            shader->use();
+            utils::bindTexture2D(*shader, "uOtherSceneColorTexture", m_info->otherSceneColorTexture, 0);
+            utils::bindTexture2D(*shader, "uSkyboxColorTexture", m_info->skyboxColorTexture, 1);
+            utils::bindTexture2D(*shader, "uValidTexture", m_info->validTexture, 2);
 
             utils::drawScreenQuad();
 
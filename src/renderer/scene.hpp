@@ -4,6 +4,7 @@
 
 #include <memory>
 
+#include "../common/program_registry.hpp"
 #include "camera.hpp"
 #include "info.hpp"
 
@@ -21,6 +22,12 @@ namespace renderer {
                 std::shared_ptr<renderer::info::SceneInfo> m_info;
             
             private:
+                // the other Scene instances share these through the program registry
+                std::shared_ptr<ComputeShader> clearCS;
+                std::shared_ptr<Shader> skyboxShader;
+                std::shared_ptr<Shader> floorShader;
+                std::shared_ptr<Shader> shader;
+
                 GLuint FBO;
 
                 GLuint skyboxFBO;
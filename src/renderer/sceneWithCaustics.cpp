@@ -1,24 +1,20 @@
 #include "sceneWithCaustics.hpp"
 
 #include "utils.hpp"
+#include "../common/profiler.hpp"
 
 namespace renderer {
     namespace sceneWithCaustics {
-        Shader shader;
-        Shader causticsPointShader;
-        Shader causticsTriangleShader;
-        Shader causticsPixelShader;
-
-        ComputeShader discardTooFewPhotonsCS;
-        ComputeShader spatialBlurCS;
-
         float uPhotonEnergy = 0.002f;
         float uPhotonSize = 0.05f;
         int blurCount = 3;
 
         SceneWithCaustics::SceneWithCaustics(Camera& camera, unsigned int width, unsigned int height, std::shared_ptr<renderer::info::CausticsInfo> causticsInfo) {
             m_causticsInfo = causticsInfo;
+            {
+            common::GPUMemoryOwner sceneOwner("scene");
             m_scene = std::make_shared<renderer::scene::Scene>(camera, width, height);
+            }
 
             m_info = std::make_shared<renderer::info::SceneInfo>(camera, width, height);
 
@@ -27,11 +23,14 @@ namespace renderer {
 
         SceneWithCaustics::~SceneWithCaustics() {
             glDeleteFramebuffers(1, &FBO);
+            glDeleteFramebuffers(1, &causticsFBO);
+            common::gpuDeleteTextures(1, &causticsColorTexture);
+            common::gpuDeleteTextures(1, &causticsBlurTexture);
         }
 
         int SceneWithCaustics::init() {
             // main shader
-            shader = Shader("src/renderer/shader/sceneWithCaustics/sceneWithCaustics.vert", "src/renderer/shader/sceneWithCaustics/sceneWithCaustics.frag");
+            shader = common::acquireShader("src/renderer/shader/sceneWithCaustics/sceneWithCaustics.vert", "src/renderer/shader/sceneWithCaustics/sceneWithCaustics.frag");
 
             // main framebuffer
             glGenFramebuffers(1, &FBO);
@@ -66,7 +65,7 @@ namespace renderer {
             }
 
             // caustics as points
-            causticsPointShader = Shader("src/renderer/shader/sceneWithCaustics/causticsPoint.vert", "src/renderer/shader/sceneWithCaustics/causticsPoint.frag");
+            causticsPointShader = common::acquireShader("src/renderer/shader/sceneWithCaustics/causticsPoint.vert", "src/renderer/shader/sceneWithCaustics/causticsPoint.frag");
 
             glGenVertexArrays(1, &causticsPointVAO);
             glBindVertexArray(causticsPointVAO);
@@ -97,10 +96,10 @@ namespace renderer {
             glEnableVertexAttribArray(0);
 
             // discard too few photons
-            discardTooFewPhotonsCS = ComputeShader("src/renderer/shader/sceneWithCaustics/discardTooFewPhotons.comp");
+            discardTooFewPhotonsCS = common::acquireComputeShader("src/renderer/shader/sceneWithCaustics/discardTooFewPhotons.comp");
 
             // blur
-            spatialBlurCS = ComputeShader("src/renderer/shader/sceneWithCaustics/spatialBlur.comp");
+            spatialBlurCS = common::acquireComputeShader("src/renderer/shader/sceneWithCaustics/spatialBlur.comp");
             causticsBlurTexture = utils::generateTextureRGBA32F(m_info->width, m_info->height);
 
             return 0;
@@ -129,17 +128,17 @@ namespace renderer {
         }
 
         int SceneWithCaustics::renderCausticsAsPoint(int flag) {
-            causticsPointShader.use();
+            causticsPointShader->use();
             // uniforms
             // MVP transforms
             glm::mat4 uView = m_info->view();
-            causticsPointShader.setMat4("uView", uView);
+            causticsPointShader->setMat4("uView", uView);
             glm::mat4 uProjection = m_info->projection();
-            causticsPointShader.setMat4("uProjection", uProjection);
+            causticsPointShader->setMat4("uProjection", uProjection);
             // other parameters
-            causticsPointShader.setFloat("uPhotonSize", uPhotonSize);
-            causticsPointShader.setInt("uFlag", flag);
-            causticsPointShader.setFloat("uPhotonEnergy", uPhotonEnergy);
+            causticsPointShader->setFloat("uPhotonSize", uPhotonSize);
+            causticsPointShader->setInt("uFlag", flag);
+            causticsPointShader->setFloat("uPhotonEnergy", uPhotonEnergy);
 
             if (flag == 0) {
                 glBindVertexArray(causticsPointVAO);
@@ -157,44 +156,46 @@ namespace renderer {
         }
 
         int SceneWithCaustics::discardTooFewPhotons(int count) {
-            discardTooFewPhotonsCS.use();
+            discardTooFewPhotonsCS->use();
             // uniforms
             // textures
             utils::bindTextureWithLayer0(causticsColorTexture, 0, GL_RGBA32F, GL_READ_WRITE);
             // other parameters
-            discardTooFewPhotonsCS.setIvec2("uCausticsTextureSize", glm::ivec2(m_info->width, m_info->height));
-            discardTooFewPhotonsCS.setFloat("uPhotonEnergy", uPhotonEnergy);
-            discardTooFewPhotonsCS.setInt("uMinPhotons", count);
+            discardTooFewPhotonsCS->setIvec2("uCausticsTextureSize", glm::ivec2(m_info->width, m_info->height));
+            discardTooFewPhotonsCS->setFloat("uPhotonEnergy", uPhotonEnergy);
+            discardTooFewPhotonsCS->setInt("uMinPhotons", count);
 
-            discardTooFewPhotonsCS.dispatchCompute(m_info->width * m_info->height);
+            discardTooFewPhotonsCS->dispatchCompute(m_info->width * m_info->height);
             glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 
             return 0;
         }
 
         int SceneWithCaustics::spatialBlur() {
-            spatialBlurCS.use();
+            spatialBlurCS->use();
             // uniforms
-            spatialBlurCS.setIvec2("uTextureSize", glm::ivec2(m_info->width, m_info->height));
+            spatialBlurCS->setIvec2("uTextureSize", glm::ivec2(m_info->width, m_info->height));
 
             // horizontal
-            spatialBlurCS.setBool("uHorizontal", true);
+            spatialBlurCS->setBool("uHorizontal", true);
             utils::bindTextureWithLayer0(causticsColorTexture, 1, GL_RGBA32F, GL_READ_WRITE);
             utils::bindTextureWithLayer0(causticsBlurTexture, 2, GL_RGBA32F, GL_WRITE_ONLY);
-            spatialBlurCS.dispatchCompute(m_info->width * m_info->height);
+            spatialBlurCS->dispatchCompute(m_info->width * m_info->height);
             glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 
             // vertical
-            spatialBlurCS.setBool("uHorizontal", false);
+            spatialBlurCS->setBool("uHorizontal", false);
             utils::bindTextureWithLayer0(causticsBlurTexture, 1, GL_RGBA32F, GL_READ_WRITE);
             utils::bindTextureWithLayer0(causticsColorTexture, 2, GL_RGBA32F, GL_WRITE_ONLY);
-            spatialBlurCS.dispatchCompute(m_info->width * m_info->height);
+            spatialBlurCS->dispatchCompute(m_info->width * m_info->height);
             glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 
             return 0;
         }
 
         int SceneWithCaustics::render() {
+            PROFILE_GPU("sceneWithCaustics");
+
             m_info->setViewport();
             m_scene->render();
 
@@ -217,22 +218,22 @@ namespace renderer {
             glDepthFunc(GL_LEQUAL);
             glDepthMask(GL_TRUE);
 
-            shader.use();
+            shader->use();
             // textures
-            utils::bindTexture2D(shader, "uCausticsTexture", causticsColorTexture, 0);
-            utils::bindTexture2D(shader, "uSceneColorTexture", m_scene->m_info->colorTexture, 1);
-            utils::bindTexture2D(shader, "uSceneValidTexture", m_scene->m_info->validTexture, 2);
-            utils::bindTexture2D(shader, "uScenePositionTexture", m_scene->m_info->positionTexture, 3);
-            utils::bindTexture2D(shader, "uSceneNormalTexture", m_scene->m_info->normalTexture, 4);
-            utils::bindTexture2D(shader, "uSceneDepthTexture", m_scene->m_info->depthTexture, 5);
+            utils::bindTexture2D(*shader, "uCausticsTexture", causticsColorTexture, 0);
+            utils::bindTexture2D(*shader, "uSceneColorTexture", m_scene->m_info->colorTexture, 1);
+            utils::bindTexture2D(*shader, "uSceneValidTexture", m_scene->m_info->validTexture, 2);
+            utils::bindTexture2D(*shader, "uScenePositionTexture", m_scene->m_info->positionTexture, 3);
+            utils::bindTexture2D(*shader, "uSceneNormalTexture", m_scene->m_info->normalTexture, 4);
+            utils::bindTexture2D(*shader, "uSceneDepthTexture", m_scene->m_info->depthTexture, 5);
             // shadow
-            utils::bindTexture2D(shader, "uCausticsDepthTexture", m_causticsInfo->depthTexture, 6);
+            utils::bindTexture2D(*shader, "uCausticsDepthTexture", m_causticsInfo->depthTexture, 6);
             // other uniforms
-            shader.setIvec2("uCausticsResolution", glm::ivec2(m_causticsInfo->width, m_causticsInfo->height));
-            shader.setVec3("uLightPosition", m_causticsInfo->position());
-            shader.setMat4("uCausticsView", m_causticsInfo->view());
-            shader.setMat4("uCausticsProjection", m_causticsInfo->projection());
-            shader.setFloat("uEpsilon", 0.001f);
+            shader->setIvec2("uCausticsResolution", glm::ivec2(m_causticsInfo->width, m_causticsInfo->height));
+            shader->setVec3("uLightPosition", m_causticsInfo->position());
+            shader->setMat4("uCausticsView", m_causticsInfo->view());
+            shader->setMat4("uCausticsProjection", m_causticsInfo->projection());
+            shader->setFloat("uEpsilon", 0.001f);
 
             utils::drawScreenQuad();
 
@@ -6,6 +6,7 @@
 
 #include <memory>
 
+#include "../common/program_registry.hpp"
 #include "camera.hpp"
 #include "scene.hpp"
 #include "caustics.hpp"
@@ -30,6 +31,11 @@ namespace renderer {
                 std::shared_ptr<renderer::info::CausticsInfo> m_causticsInfo;
                 std::shared_ptr<renderer::scene::Scene> m_scene;
 
+                std::shared_ptr<Shader> shader;
+                std::shared_ptr<Shader> causticsPointShader;
+                std::shared_ptr<ComputeShader> discardTooFewPhotonsCS;
+                std::shared_ptr<ComputeShader> spatialBlurCS;
+
                 GLuint FBO;
 
                 GLuint causticsFBO;
@@ -1,7 +1,13 @@
 #version 430 core
 
-layout (location = 0) in vec4 aPos;
-layout (location = 1) in float aDensity;
+// pulled straight from the simulator, one point per particle, the VAO has no attributes
+layout(std430, binding = 29) readonly buffer ParticlePosition {
+    vec4 particlePosition[];
+};
+
+layout(std430, binding = 30) readonly buffer Density {
+    float density[];
+};
 
 out vec3 vCenterPosViewSpace;
 out float vDensity;
@@ -16,6 +22,9 @@ uniform float uPointSize;
 const float POINT_SIZE_SCALER = 2000;
 
 void main() {
+    vec4 aPos = particlePosition[gl_VertexID];
+    float aDensity = density[gl_VertexID];
+
     gl_Position = uProjection * uView * vec4(aPos.xyz, 1.0);
     vCenterPosViewSpace = (uView * vec4(aPos.xyz, 1.0)).xyz;
     gl_PointSize = POINT_SIZE_SCALER * uPointSize / (-vCenterPosViewSpace.z);
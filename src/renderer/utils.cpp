@@ -28,8 +28,8 @@ namespace renderer {
                     format = GL_RGBA;
 
                 glBindTexture(GL_TEXTURE_2D, textureID);
-                glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-                glGenerateMipmap(GL_TEXTURE_2D);
+                common::gpuTexImage2D(GL_TEXTURE_2D, 0, format, width, height, format, GL_UNSIGNED_BYTE, data);
+                common::gpuGenerateMipmap(GL_TEXTURE_2D);
 
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -54,7 +54,7 @@ namespace renderer {
             for (unsigned int i = 0; i < faces.size(); i++) {
                 unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
                 if (data) {
-                    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+                    common::gpuTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, GL_RGB, GL_UNSIGNED_BYTE, data);
                 }
                 else {
                     std::cerr << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
@@ -80,7 +80,7 @@ namespace renderer {
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mgFilter);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, warpS);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, warpT);
-            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, data);
+            common::gpuTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, format, type, data);
 
             return id;
         }
@@ -163,7 +163,7 @@ namespace renderer {
 
             glBindVertexArray(screenQuadVAO);
             glBindBuffer(GL_ARRAY_BUFFER, screenQuadVBO);
-            glBufferData(GL_ARRAY_BUFFER, screenQuadVertices.size() * sizeof(float), screenQuadVertices.data(), GL_STATIC_DRAW);
+            common::gpuBufferData(GL_ARRAY_BUFFER, screenQuadVertices.size() * sizeof(float), screenQuadVertices.data(), GL_STATIC_DRAW);
             glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
             glEnableVertexAttribArray(0);
             glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
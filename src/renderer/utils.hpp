@@ -6,6 +6,7 @@
 #include "glad/glad.h"
 
 #include "../common/shader.hpp"
+#include "../common/gpu_memory.hpp"
 
 namespace renderer {
     namespace utils {
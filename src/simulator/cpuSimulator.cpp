@@ -0,0 +1,567 @@
+#include "cpuSimulator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+
+#include "simulator.hpp"
+#include "../common/thread_pool.hpp"
+#include "../common/profiler.hpp"
+
+namespace simulator {
+    namespace cpu {
+        std::unique_ptr<common::ThreadPool> threadPool;
+
+        // every kernel works in single precision like its GLSL counterpart
+        const float kernelRadius = static_cast<float>(KERNEL_RADIUS);
+        const float mass = static_cast<float>(MASS);
+        const float restDensityReverse = static_cast<float>(REST_DENSITY_REVERSE);
+        const float poly6Factor = static_cast<float>(315.0 / (64.0 * common::PI * std::pow(KERNEL_RADIUS, 9)));
+        const float spikyGradientFactor = static_cast<float>(-45.0 / (common::PI * std::pow(KERNEL_RADIUS, 6)));
+
+        std::vector<glm::vec4> particlePosition;
+        std::vector<glm::vec4> positionPredict;
+        std::vector<glm::vec4> velocity;
+        std::vector<glm::vec4> velocityAid;
+
+        // uniform grid, same layout as divideCube() on the GPU
+        int cubeCountXZ;
+        int cubeCountY;
+        std::vector<unsigned int> cubeIndexPerParticle;
+        std::unique_ptr<std::atomic<unsigned int>[]> particleCountPerCube;
+        std::vector<unsigned int> cubeOffset;
+        std::vector<unsigned int> particleIndexInCube;
+
+        // neighbors in compressed sparse row layout: neighbors of i are neighborIndex[neighborOffset[i], neighborOffset[i + 1])
+        std::vector<unsigned int> neighborOffset;
+        std::vector<unsigned int> neighborIndex;
+
+        std::vector<float> density;
+        std::vector<float> constraint;
+        std::vector<float> constraintGradSquareSum;
+        std::vector<float> lambda;
+
+        std::vector<glm::vec4> positionPredictAid;
+
+        std::vector<glm::vec3> curl;
+        std::vector<glm::vec3> curlX;
+        std::vector<glm::vec3> curlY;
+        std::vector<glm::vec3> curlZ;
+
+        float poly6(glm::vec3 r) {
+            float h2 = kernelRadius * kernelRadius;
+            float r2 = glm::dot(r, r);
+            if (r2 > h2) {
+                return 0.0f;
+            }
+            float d = h2 - r2;
+            return poly6Factor * d * d * d;
+        }
+
+        glm::vec3 spikyGradient(glm::vec3 r) {
+            float rMag = glm::length(r);
+            if (rMag > kernelRadius || rMag < 0.00001f) {
+                return glm::vec3(0.0f);
+            }
+            float d = kernelRadius - rMag;
+            return r * (spikyGradientFactor * d * d / rMag);
+        }
+
+        glm::ivec3 getIndexInCube(const glm::vec4& position) {
+            float horizon = static_cast<float>(domainHorizonMaxCoordinate);
+            glm::vec3 positionInCube = (glm::vec3(position) + glm::vec3(0.5f * horizon, 0.0f, 0.5f * horizon)) / kernelRadius;
+            // the GPU trusts the boundary padding to keep particles inside the grid, here we clamp to stay in bounds
+            return glm::ivec3(std::clamp(static_cast<int>(std::floor(positionInCube.x)), 0, cubeCountXZ - 1),
+                              std::clamp(static_cast<int>(std::floor(positionInCube.y)), 0, cubeCountY - 1),
+                              std::clamp(static_cast<int>(std::floor(positionInCube.z)), 0, cubeCountXZ - 1));
+        }
+
+        unsigned int getCubeIndex(glm::ivec3 indexInCube) {
+            return static_cast<unsigned int>(indexInCube.x * cubeCountXZ * cubeCountY + indexInCube.y * cubeCountXZ + indexInCube.z);
+        }
+
+        // calls visit(neighborIndex) for every particle within KERNEL_RADIUS of `index`, in the same cube order as the GPU
+        template <typename Visitor>
+        void forEachNeighborInCube(unsigned int index, Visitor visit) {
+            glm::ivec3 indexInCube = getIndexInCube(positionPredict[index]);
+            glm::vec3 position = glm::vec3(positionPredict[index]);
+            for (int i = -1; i <= 1; i++) {
+                for (int j = -1; j <= 1; j++) {
+                    for (int k = -1; k <= 1; k++) {
+                        glm::ivec3 surrounding = indexInCube + glm::ivec3(i, j, k);
+                        if (surrounding.x < 0 || surrounding.y < 0 || surrounding.z < 0 ||
+                            surrounding.x >= cubeCountXZ || surrounding.y >= cubeCountY || surrounding.z >= cubeCountXZ) {
+                            continue;
+                        }
+                        unsigned int cubeIndex = getCubeIndex(surrounding);
+                        for (unsigned int n = cubeOffset[cubeIndex]; n < cubeOffset[cubeIndex + 1]; n++) {
+                            unsigned int neighbor = particleIndexInCube[n];
+                            if (neighbor != index && glm::length(position - glm::vec3(positionPredict[neighbor])) <= kernelRadius) {
+                                visit(neighbor);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // in-place exclusive prefix sum, values.back() holds the total afterwards
+        // the last element is expected to be a zero sentinel
+        void exclusiveScan(std::vector<unsigned int>& values) {
+            size_t count = values.size();
+            size_t chunkCount = std::min<size_t>(count, threadPool->getThreadCount() * 4);
+            size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+            std::vector<unsigned int> chunkSum(chunkCount + 1, 0);
+
+            threadPool->parallelFor(0, chunkCount, 1, [&](size_t begin, size_t end) {
+                for (size_t chunk = begin; chunk < end; chunk++) {
+                    unsigned int sum = 0;
+                    for (size_t i = chunk * chunkSize; i < std::min(count, (chunk + 1) * chunkSize); i++) {
+                        sum += values[i];
+                    }
+                    chunkSum[chunk + 1] = sum;
+                }
+            });
+            for (size_t chunk = 1; chunk <= chunkCount; chunk++) {
+                chunkSum[chunk] += chunkSum[chunk - 1];
+            }
+            threadPool->parallelFor(0, chunkCount, 1, [&](size_t begin, size_t end) {
+                for (size_t chunk = begin; chunk < end; chunk++) {
+                    unsigned int offset = chunkSum[chunk];
+                    for (size_t i = chunk * chunkSize; i < std::min(count, (chunk + 1) * chunkSize); i++) {
+                        unsigned int value = values[i];
+                        values[i] = offset;
+                        offset += value;
+                    }
+                }
+            });
+        }
+
+        int simulateInit(const std::vector<glm::vec4>& initialParticlePosition, unsigned int threadCount) {
+            threadPool = std::make_unique<common::ThreadPool>(threadCount);
+
+            particlePosition = initialParticlePosition;
+            positionPredict = initialParticlePosition;
+            velocity.assign(particleCount, glm::vec4(0.0f));
+            velocityAid.assign(particleCount, glm::vec4(0.0f));
+
+            float horizon = static_cast<float>(domainHorizonMaxCoordinate);
+            float maxHeight = static_cast<float>(domainMaxHeight);
+            cubeCountXZ = static_cast<int>(std::ceil(horizon / kernelRadius));
+            cubeCountY = static_cast<int>(std::ceil(maxHeight / kernelRadius));
+            unsigned int cubeCount = static_cast<unsigned int>(cubeCountXZ * cubeCountXZ * cubeCountY);
+
+            cubeIndexPerParticle.assign(particleCount, 0);
+            particleCountPerCube = std::make_unique<std::atomic<unsigned int>[]>(cubeCount);
+            cubeOffset.assign(cubeCount + 1, 0);
+            particleIndexInCube.assign(particleCount, 0);
+
+            neighborOffset.assign(particleCount + 1, 0);
+            neighborIndex.clear();
+
+            density.assign(particleCount, 0.0f);
+            constraint.assign(particleCount, 0.0f);
+            constraintGradSquareSum.assign(particleCount, 0.0f);
+            lambda.assign(particleCount, 0.0f);
+
+            positionPredictAid.assign(particleCount, glm::vec4(0.0f));
+
+            curl.assign(particleCount, glm::vec3(0.0f));
+            curlX.assign(particleCount, glm::vec3(0.0f));
+            curlY.assign(particleCount, glm::vec3(0.0f));
+            curlZ.assign(particleCount, glm::vec3(0.0f));
+
+            return 0;
+        }
+
+        int simulate() {
+            applyExternalForce();
+
+            searchNeighbor();
+
+            for (int i = 0; i < constraintProjectionIteration; i++) {
+                computeLambda();
+                correctPositionPredict();
+            }
+
+            updateVelocityByPosition();
+
+            if (vorticityParameter > 0.0f)
+                applyVorticityConfinement();
+
+            if (viscosityParameter > 0.0f)
+                applyViscosity();
+
+            manipulateVelocity();
+
+            handleBoundaryCollision();
+
+            updateParticlePosition();
+
+            return 0;
+        }
+
+        int setParticleState(const std::vector<glm::vec4>& statePosition, const std::vector<glm::vec4>& stateVelocity) {
+            particlePosition = statePosition;
+            positionPredict = statePosition;
+            velocity = stateVelocity;
+
+            return 0;
+        }
+
+        int simulateTerminate() {
+            threadPool.reset();
+
+            particlePosition.clear();
+            positionPredict.clear();
+            velocity.clear();
+            velocityAid.clear();
+            cubeIndexPerParticle.clear();
+            particleCountPerCube.reset();
+            cubeOffset.clear();
+            particleIndexInCube.clear();
+            neighborOffset.clear();
+            neighborIndex.clear();
+            density.clear();
+            constraint.clear();
+            constraintGradSquareSum.clear();
+            lambda.clear();
+            positionPredictAid.clear();
+            curl.clear();
+            curlX.clear();
+            curlY.clear();
+            curlZ.clear();
+
+            return 0;
+        }
+
+
+        int applyExternalForce() {
+            PROFILE_CPU("applyExternalForce");
+
+            const glm::vec3 deltaVelocity = GRAVITY * static_cast<float>(DELTA_TIME) * static_cast<float>(MASS_REVERSE);
+            const float deltaTime = static_cast<float>(DELTA_TIME);
+
+            threadPool->parallelFor(0, particleCount, [&](size_t begin, size_t end) {
+                for (size_t index = begin; index < end; index++) {
+                    velocity[index] += glm::vec4(deltaVelocity, 0.0f);
+                    glm::vec3 predict = glm::vec3(particlePosition[index]) + glm::vec3(velocity[index]) * deltaTime;
+                    positionPredict[index] = glm::vec4(predict, positionPredict[index].w);
+                }
+            });
+
+            return 0;
+        }
+
+        int searchNeighbor() {
+            PROFILE_CPU("searchNeighbor");
+
+            size_t cubeCount = cubeOffset.size() - 1;
+
+            // divide cube: count, scan, scatter
+            threadPool->parallelFor(0, cubeCount, [&](size_t begin, size_t end) {
+                for (size_t cubeIndex = begin; cubeIndex < end; cubeIndex++) {
+                    particleCountPerCube[cubeIndex].store(0, std::memory_order_relaxed);
+                }
+            });
+            threadPool->parallelFor(0, particleCount, [&](size_t begin, size_t end) {
+                for (size_t index = begin; index < end; index++) {
+                    unsigned int cubeIndex = getCubeIndex(getIndexInCube(positionPredict[index]));
+                    cubeIndexPerParticle[index] = cubeIndex;
+                    particleCountPerCube[cubeIndex].fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+            threadPool->parallelFor(0, cubeCount, [&](size_t begin, size_t end) {
+                for (size_t cubeIndex = begin; cubeIndex < end; cubeIndex++) {
+                    cubeOffset[cubeIndex] = particleCountPerCube[cubeIndex].load(std::memory_order_relaxed);
+                }
+            });
+            cubeOffset[cubeCount] = 0;
+            exclusiveScan(cubeOffset);
+
+            // reuse the counters as per-cube write cursors
+            threadPool->parallelFor(0, cubeCount, [&](size_t begin, size_t end) {
+                for (size_t cubeIndex = begin; cubeIndex < end; cubeIndex++) {
+                    particleCountPerCube[cubeIndex].store(cubeOffset[cubeIndex], std::memory_order_relaxed);
+                }
+            });
+            threadPool->parallelFor(0, particleCount, [&](size_t begin, size_t end) {
+                for (size_t index = begin; index < end; index++) {
+                    unsigned int slot = particleCountPerCube[cubeIndexPerParticle[index]].fetch_add(1, std::memory_order_relaxed);
+                    particleIndexInCube[slot] = static_cast<unsigned int>(index);
+                }
+            });
+            // the scatter order inside a cube depends on thread timing, sorting keeps the summation order deterministic
+            threadPool->parallelFor(0, cubeCount, [&](size_t begin, size_t end) {
+                for (size_t cubeIndex = begin; cubeIndex < end; cubeIndex++) {
+                    std::sort(particleIndexInCube.begin() + cubeOffset[cubeIndex], particleIndexInCube.begin() + cubeOffset[cubeIndex + 1]);
+                }
+            });
+
+            // search neighbor from cube: count, scan, fill
+            threadPool->parallelFor(0, particleCount, [&](size_t begin, size_t end) {
+                for (size_t index = begin; index < end; index++) {
+                    unsigned int neighborCount = 0;
+                    forEachNeighborInCube(static_cast<unsigned int>(index), [&](unsigned int) {
+                        neighborCount++;
+                    });
+                    neighborOffset[index] = neighborCount;
+                }
+            });
+            neighborOffset[particleCount] = 0;
+            exclusiveScan(neighborOffset);
+            neighborIndex.resize(neighborOffset[particleCount]);
+            threadPool->parallelFor(0, particleCount, [&](size_t begin, size_t end) {
+                for (size_t index = begin; index < end; index++) {
+                    unsigned int cursor = neighborOffset[index];
+                    forEachNeighborInCube(static_cast<unsigned int>(index), [&](unsigned int neighbor) {
+                        neighborIndex[cursor++] = neighbor;
+                    });
+                }
+            });
+
+            return 0;
+        }
+
+        int computeLambda() {
+            PROFILE_CPU("computeLambda");
+
+            const float relaxationParameter = static_cast<float>(RELAXATION_PARAMETER);
+
+            threadPool->parallelFor(0, particleCount, [&](size_t begin, size_t end) {
+                for (size_t index = begin; index < end; index++) {
+                    glm::vec3 position = glm::vec3(positionPredict[index]);
+
+                    // computeDensity
+                    float densityValue = poly6(glm::vec3(0.0f));
+                    for (unsigned int n = neighborOffset[index]; n < neighborOffset[index + 1]; n++) {
+                        densityValue += poly6(position - glm::vec3(positionPredict[neighborIndex[n]]));
+                    }
+                    densityValue *= mass;
+                    density[index] = densityValue;
+
+                    // computeConstraint
+                    constraint[index] = std::max(densityValue * restDensityReverse - 1.0f, 0.0f);
+
+                    // computeConstraintGradSquareSum
+                    float squareSum = 0.0f;
+                    glm::vec3 constraintGrad_i = glm::vec3(0.0f);
+                    for (unsigned int n = neighborOffset[index]; n < neighborOffset[index + 1]; n++) {
+                        glm::vec3 constraintGrad_j = spikyGradient(position - glm::vec3(positionPredict[neighborIndex[n]]));
+                        constraintGrad_j *= mass * restDensityReverse;
+                        squareSum += glm::dot(constraintGrad_j, constraintGrad_j);
+                        constraintGrad_i += constraintGrad_j;
+                    }
+                    squareSum += glm::dot(constraintGrad_i, constraintGrad_i);
+                    constraintGradSquareSum[index] = squareSum;
+
+                    lambda[index] = -constraint[index] / (squareSum + relaxationParameter);
+                }
+            });
+
+            return 0;
+        }
+
+        int correctPositionPredict() {
+            PROFILE_CPU("correctPositionPredict");
+
+            const float horizon = static_cast<float>(horizonMaxCoordinate);
+            const float maxHeight = static_cast<float>(domainMaxHeight);
+            const float boundaryPadding = 0.1f;
+            const glm::vec3 lower = glm::vec3(-0.5f * horizon + boundaryPadding, 0.0f + boundaryPadding, -0.5f * horizon + boundaryPadding);
+            const glm::vec3 upper = glm::vec3(0.5f * horizon - boundaryPadding, maxHeight - boundaryPadding, 0.5f * horizon - boundaryPadding);
+
+            threadPool->parallelFor(0, particleCount, [&](size_t begin, size_t end) {
+                for (size_t index = begin; index < end; index++) {
+                    glm::vec3 position = glm::vec3(positionPredict[index]);
+                    glm::vec3 dPosition = glm::vec3(0.0f);
+                    for (unsigned int n = neighborOffset[index]; n < neighborOffset[index + 1]; n++) {
+                        unsigned int neighbor = neighborIndex[n];
+                        dPosition += (lambda[index] + lambda[neighbor]) * spikyGradient(position - glm::vec3(positionPredict[neighbor]));
+                    }
+                    dPosition *= mass * restDensityReverse;
+
+                    position = glm::clamp(position + dPosition, lower, upper);
+                    positionPredictAid[index] = glm::vec4(position, positionPredict[index].w);
+                }
+            });
+            std::swap(positionPredict, positionPredictAid);
+
+            return 0;
+        }
+
+        int handleBoundaryCollision() {
+            PROFILE_CPU("handleBoundaryCollision");
+
+            const float horizon = static_cast<float>(horizonMaxCoordinate);
+            const float maxHeight = static_cast<float>(domainMaxHeight);
+            const float restitution = static_cast<float>(RESTITUTION);
+            const float friction = static_cast<float>(FRICTION);
+            const float boundaryPadding = 0.1f;
+            // axis, lower bound, upper bound
+            const glm::vec3 lower = glm::vec3(-0.5f * horizon + boundaryPadding, 0.0f + boundaryPadding, -0.5f * horizon + boundaryPadding);
+            const glm::vec3 upper = glm::vec3(0.5f * horizon - boundaryPadding, maxHeight - boundaryPadding, 0.5f * horizon - boundaryPadding);
+
+            threadPool->parallelFor(0, particleCount, [&](size_t begin, size_t end) {
+                for (size_t index = begin; index < end; index++) {
+                    glm::vec4& position = positionPredict[index];
+                    glm::vec4& v = velocity[index];
+                    for (int axis = 0; axis < 3; axis++) {
+                        int tangent0 = (axis + 1) % 3;
+                        int tangent1 = (axis + 2) % 3;
+                        if (position[axis] <= lower[axis]) {
+                            position[axis] = lower[axis];
+                            if (v[axis] < 0.0f) {
+                                v[axis] *= -restitution;
+                                v[tangent0] *= friction;
+                                v[tangent1] *= friction;
+                            }
+                        }
+                        if (position[axis] >= upper[axis]) {
+                            position[axis] = upper[axis];
+                            if (v[axis] > 0.0f) {
+                                v[axis] *= -restitution;
+                                v[tangent0] *= friction;
+                                v[tangent1] *= friction;
+                            }
+                        }
+                    }
+                }
+            });
+
+            return 0;
+        }
+
+        int updateVelocityByPosition() {
+            PROFILE_CPU("updateVelocityByPosition");
+
+            const float deltaTimeReverse = static_cast<float>(DELTA_TIME_REVERSE);
+
+            threadPool->parallelFor(0, particleCount, [&](size_t begin, size_t end) {
+                for (size_t index = begin; index < end; index++) {
+                    velocity[index] = (positionPredict[index] - particlePosition[index]) * deltaTimeReverse;
+                }
+            });
+
+            return 0;
+        }
+
+        int applyVorticityConfinement() {
+            PROFILE_CPU("applyVorticityConfinement");
+
+            const float deltaTime = static_cast<float>(DELTA_TIME);
+            const float massReverse = static_cast<float>(MASS_REVERSE);
+            const glm::vec3 offsetX = glm::vec3(0.01f, 0.0f, 0.0f);
+            const glm::vec3 offsetY = glm::vec3(0.0f, 0.01f, 0.0f);
+            const glm::vec3 offsetZ = glm::vec3(0.0f, 0.0f, 0.01f);
+
+            // computeCurl
+            threadPool->parallelFor(0, particleCount, [&](size_t begin, size_t end) {
+                for (size_t index = begin; index < end; index++) {
+                    glm::vec3 c = glm::vec3(0.0f), cX = glm::vec3(0.0f), cY = glm::vec3(0.0f), cZ = glm::vec3(0.0f);
+                    for (unsigned int n = neighborOffset[index]; n < neighborOffset[index + 1]; n++) {
+                        unsigned int neighbor = neighborIndex[n];
+                        glm::vec3 v_ji = glm::vec3(velocity[neighbor]) - glm::vec3(velocity[index]);
+                        glm::vec3 p_ij = glm::vec3(positionPredict[index]) - glm::vec3(positionPredict[neighbor]);
+                        c += glm::cross(v_ji, spikyGradient(p_ij));
+                        cX += glm::cross(v_ji, spikyGradient(p_ij + offsetX));
+                        cY += glm::cross(v_ji, spikyGradient(p_ij + offsetY));
+                        cZ += glm::cross(v_ji, spikyGradient(p_ij + offsetZ));
+                    }
+                    curl[index] = c;
+                    curlX[index] = cX;
+                    curlY[index] = cY;
+                    curlZ[index] = cZ;
+                }
+            });
+
+            threadPool->parallelFor(0, particleCount, [&](size_t begin, size_t end) {
+                for (size_t index = begin; index < end; index++) {
+                    const glm::vec3& c = curl[index];
+                    if (std::isnan(c.x) || std::isnan(c.y) || std::isnan(c.z)) {
+                        continue;
+                    }
+                    float curlLength = glm::length(c);
+                    glm::vec3 n = glm::vec3(glm::length(curlX[index]) - curlLength,
+                                            glm::length(curlY[index]) - curlLength,
+                                            glm::length(curlZ[index]) - curlLength);
+                    n = glm::normalize(n);
+                    if (std::isnan(n.x) || std::isnan(n.y) || std::isnan(n.z)) {
+                        continue;
+                    }
+                    glm::vec3 force = -vorticityParameter * glm::cross(n, c);
+                    velocity[index] += glm::vec4(force * deltaTime * massReverse, 0.0f);
+                }
+            });
+
+            return 0;
+        }
+
+        int applyViscosity() {
+            PROFILE_CPU("applyViscosity");
+
+            // the GPU kernel updates velocities in place while neighbors read them,
+            // here every particle reads the velocities from before the pass
+            velocityAid = velocity;
+
+            threadPool->parallelFor(0, particleCount, [&](size_t begin, size_t end) {
+                for (size_t index = begin; index < end; index++) {
+                    glm::vec3 position = glm::vec3(positionPredict[index]);
+                    glm::vec3 deltaVelocity = glm::vec3(0.0f);
+                    for (unsigned int n = neighborOffset[index]; n < neighborOffset[index + 1]; n++) {
+                        unsigned int neighbor = neighborIndex[n];
+                        deltaVelocity -= glm::vec3(velocityAid[index] - velocityAid[neighbor]) * poly6(position - glm::vec3(positionPredict[neighbor]));
+                    }
+                    glm::vec3 deltaVelocity2 = restDensityReverse * deltaVelocity;
+                    velocity[index] += glm::vec4(viscosityParameter * deltaVelocity2, 0.0f);
+                }
+            });
+
+            return 0;
+        }
+
+        int manipulateVelocity() {
+            PROFILE_CPU("manipulateVelocity");
+
+            glm::vec3 deltaVelocity = glm::vec3(static_cast<float>(uRight - uLeft),
+                                                static_cast<float>(uUp - uDown),
+                                                static_cast<float>(uBack - uFront)) * uDeltaVelocity;
+            if (deltaVelocity == glm::vec3(0.0f)) {
+                return 0;
+            }
+
+            threadPool->parallelFor(0, particleCount, [&](size_t begin, size_t end) {
+                for (size_t index = begin; index < end; index++) {
+                    velocity[index] += glm::vec4(deltaVelocity, 0.0f);
+                }
+            });
+
+            return 0;
+        }
+
+        int updateParticlePosition() {
+            PROFILE_CPU("updateParticlePosition");
+
+            std::swap(particlePosition, positionPredict);
+
+            return 0;
+        }
+
+        unsigned int getThreadCount() {
+            return threadPool ? threadPool->getThreadCount() : 0;
+        }
+
+        const std::vector<glm::vec4>& getParticlePosition() {
+            return particlePosition;
+        }
+
+        const std::vector<glm::vec4>& getVelocity() {
+            return velocity;
+        }
+
+        const std::vector<float>& getDensity() {
+            return density;
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace simulator {
+    // CPU backend, a float-for-float port of the compute shaders in `src/simulator/shader`
+    // it shares the constants and gui parameters of `simulator.hpp` but never touches OpenGL,
+    // so it also runs on machines without a GPU
+    namespace cpu {
+        // threadCount == 0 means one thread per hardware thread
+        int simulateInit(const std::vector<glm::vec4>& initialParticlePosition, unsigned int threadCount = 0);
+        int simulate();
+        int simulateTerminate();
+        // continues from the given state instead of the initial one, positions and velocities are never reordered here
+        int setParticleState(const std::vector<glm::vec4>& position, const std::vector<glm::vec4>& velocity);
+
+        int applyExternalForce();
+
+        int searchNeighbor();
+        int computeLambda();
+        int correctPositionPredict();
+        int handleBoundaryCollision();
+        int updateVelocityByPosition();
+
+        int applyVorticityConfinement();
+        int applyViscosity();
+        int manipulateVelocity();
+
+        int updateParticlePosition();
+
+        unsigned int getThreadCount();
+        const std::vector<glm::vec4>& getParticlePosition();
+        const std::vector<glm::vec4>& getVelocity();
+        const std::vector<float>& getDensity();
+    }
+}
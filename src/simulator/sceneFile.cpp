@@ -0,0 +1,374 @@
+#include "sceneFile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+#include "simulator.hpp"
+#include "../common/thread_pool.hpp"
+
+namespace simulator {
+    std::vector<SceneShape> sceneShapes;
+    std::string sceneName;
+
+    // the lattice covers the configured domain, point (i, j, k) sits in the middle of its cell
+    struct SceneLattice {
+        float spacing;
+        glm::vec3 origin;
+        // index range of the points inside the bounding box of all shapes
+        glm::ivec3 begin;
+        glm::ivec3 end;
+    };
+
+    // configureScale() runs more than once before the scene is sampled, the slab counts of the last lattice are kept
+    SceneLattice cachedLattice;
+    std::vector<unsigned int> cachedSlabCount;
+    bool slabCountCached = false;
+    // shared by counting and sampling, started on first use
+    std::unique_ptr<common::ThreadPool> sceneThreadPool;
+
+    std::string trim(const std::string& text) {
+        size_t begin = text.find_first_not_of(" \t\r\n");
+        if (begin == std::string::npos) {
+            return "";
+        }
+        size_t end = text.find_last_not_of(" \t\r\n");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    // '#' inside a string does not start a comment
+    std::string stripComment(const std::string& line) {
+        bool inString = false;
+        for (size_t i = 0; i < line.size(); i++) {
+            if (line[i] == '"') {
+                inString = !inString;
+            }
+            else if (line[i] == '#' && !inString) {
+                return line.substr(0, i);
+            }
+        }
+        return line;
+    }
+
+    bool parseNumber(const std::string& text, double& value) {
+        try {
+            size_t length = 0;
+            value = std::stod(text, &length);
+            return length == text.size();
+        }
+        catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    bool parseVector(const std::string& text, glm::vec3& value) {
+        if (text.size() < 2 || text.front() != '[' || text.back() != ']') {
+            return false;
+        }
+        std::string elements = text.substr(1, text.size() - 2);
+        for (int axis = 0; axis < 3; axis++) {
+            size_t comma = elements.find(',');
+            if ((axis < 2) != (comma != std::string::npos)) {
+                return false;
+            }
+            double element;
+            if (!parseNumber(trim(elements.substr(0, comma)), element)) {
+                return false;
+            }
+            value[axis] = static_cast<float>(element);
+            elements = comma == std::string::npos ? "" : elements.substr(comma + 1);
+        }
+        return true;
+    }
+
+    bool parseString(const std::string& text, std::string& value) {
+        if (text.size() < 2 || text.front() != '"' || text.back() != '"') {
+            return false;
+        }
+        value = text.substr(1, text.size() - 2);
+        return true;
+    }
+
+    int loadSceneFile(const std::string& fileName) {
+        std::ifstream file(fileName);
+        if (!file) {
+            std::cerr << "cannot open scene file: " << fileName << std::endl;
+            return -1;
+        }
+
+        // shapes need their keys before they can be used, the flags track which ones a table had
+        struct ParsedShape {
+            SceneShape shape;
+            bool hasMin;
+            bool hasMax;
+            bool hasCenter;
+            bool hasRadius;
+        };
+        std::vector<ParsedShape> shapes;
+        std::string name = fileName;
+        std::string table;
+
+        std::string line;
+        unsigned int lineNumber = 0;
+        auto fail = [&](const std::string& message) {
+            std::cerr << fileName << ":" << lineNumber << ": " << message << std::endl;
+            return -1;
+        };
+        while (std::getline(file, line)) {
+            lineNumber++;
+            line = trim(stripComment(line));
+            if (line.empty()) {
+                continue;
+            }
+
+            if (line.rfind("[[", 0) == 0) {
+                if (line.size() < 4 || line.compare(line.size() - 2, 2, "]]") != 0) {
+                    return fail("unterminated table header");
+                }
+                table = trim(line.substr(2, line.size() - 4));
+                if (table != "block" && table != "sphere") {
+                    return fail("unknown shape " + table + ", expected block or sphere");
+                }
+                ParsedShape shape = {};
+                shape.shape.type = table == "block" ? SceneShapeType::BLOCK : SceneShapeType::SPHERE;
+                shape.shape.velocity = glm::vec3(0.0f);
+                shapes.push_back(shape);
+                continue;
+            }
+            if (line[0] == '[') {
+                if (line.back() != ']') {
+                    return fail("unterminated table header");
+                }
+                table = trim(line.substr(1, line.size() - 2));
+                if (table != "domain" && table != "physics") {
+                    return fail("unknown table " + table + ", expected domain or physics");
+                }
+                continue;
+            }
+
+            size_t equal = line.find('=');
+            if (equal == std::string::npos) {
+                return fail("expected key = value");
+            }
+            std::string key = trim(line.substr(0, equal));
+            std::string value = trim(line.substr(equal + 1));
+            double number = 0.0;
+            bool isNumber = parseNumber(value, number);
+
+            if (table.empty() && key == "name") {
+                if (!parseString(value, name)) {
+                    return fail("name has to be a string");
+                }
+            }
+            else if (table == "domain" && (key == "xz" || key == "height")) {
+                if (!isNumber || number <= 0.0) {
+                    return fail(key + " has to be a positive number");
+                }
+                (key == "xz" ? simulationScale.horizonMaxCoordinate : simulationScale.maxHeight) = number;
+            }
+            else if (table == "physics" && (key == "iterations" || key == "reorder-interval")) {
+                if (!isNumber || number < 0.0 || number != std::floor(number)) {
+                    return fail(key + " has to be a whole number");
+                }
+                (key == "iterations" ? constraintProjectionIteration : reorderInterval) = static_cast<int>(number);
+            }
+            else if (table == "physics" && (key == "viscosity" || key == "vorticity")) {
+                if (!isNumber || number < 0.0) {
+                    return fail(key + " has to be a non-negative number");
+                }
+                (key == "viscosity" ? viscosityParameter : vorticityParameter) = static_cast<float>(number);
+            }
+            else if ((table == "block" || table == "sphere") && key != "radius") {
+                SceneShape& shape = shapes.back().shape;
+                glm::vec3 vector;
+                if (!parseVector(value, vector)) {
+                    return fail(key + " has to be [x, y, z]");
+                }
+                if (key == "velocity") {
+                    shape.velocity = vector;
+                }
+                else if (table == "block" && key == "min") {
+                    shape.min = vector;
+                    shapes.back().hasMin = true;
+                }
+                else if (table == "block" && key == "max") {
+                    shape.max = vector;
+                    shapes.back().hasMax = true;
+                }
+                else if (table == "sphere" && key == "center") {
+                    shape.center = vector;
+                    shapes.back().hasCenter = true;
+                }
+                else {
+                    return fail("unknown key " + key + " in " + table);
+                }
+            }
+            else if (table == "sphere" && key == "radius") {
+                if (!isNumber || number <= 0.0) {
+                    return fail("radius has to be a positive number");
+                }
+                shapes.back().shape.radius = static_cast<float>(number);
+                shapes.back().hasRadius = true;
+            }
+            else {
+                return fail("unknown key " + key + (table.empty() ? "" : " in " + table));
+            }
+        }
+
+        sceneShapes.clear();
+        slabCountCached = false;
+        for (ParsedShape& parsed : shapes) {
+            SceneShape& shape = parsed.shape;
+            if (shape.type == SceneShapeType::BLOCK) {
+                if (!parsed.hasMin || !parsed.hasMax) {
+                    std::cerr << fileName << ": every block needs min and max" << std::endl;
+                    return -1;
+                }
+                shape.center = 0.5f * (shape.min + shape.max);
+            }
+            else {
+                if (!parsed.hasCenter || !parsed.hasRadius) {
+                    std::cerr << fileName << ": every sphere needs center and radius" << std::endl;
+                    return -1;
+                }
+                shape.min = shape.center - glm::vec3(shape.radius);
+                shape.max = shape.center + glm::vec3(shape.radius);
+            }
+            sceneShapes.push_back(shape);
+        }
+        if (sceneShapes.empty()) {
+            std::cerr << fileName << ": the scene has no shapes" << std::endl;
+            return -1;
+        }
+        sceneName = name;
+
+        return 0;
+    }
+
+    SceneLattice getSceneLattice() {
+        SceneLattice lattice;
+        lattice.spacing = static_cast<float>(2.0 * PARTICLE_RADIUS);
+        lattice.origin = glm::vec3(static_cast<float>(-0.5 * domainHorizonMaxCoordinate), 0.0f, static_cast<float>(-0.5 * domainHorizonMaxCoordinate));
+        glm::ivec3 cellCount = glm::ivec3(
+            static_cast<int>(domainHorizonMaxCoordinate / lattice.spacing),
+            static_cast<int>(domainMaxHeight / lattice.spacing),
+            static_cast<int>(domainHorizonMaxCoordinate / lattice.spacing));
+
+        glm::vec3 min = sceneShapes[0].min;
+        glm::vec3 max = sceneShapes[0].max;
+        for (const SceneShape& shape : sceneShapes) {
+            min = glm::min(min, shape.min);
+            max = glm::max(max, shape.max);
+        }
+        // points strictly inside the domain, the boundary would push particles sitting on it
+        glm::vec3 first = glm::ceil((min - lattice.origin) / lattice.spacing - 0.5f);
+        glm::vec3 last = glm::floor((max - lattice.origin) / lattice.spacing - 0.5f);
+        lattice.begin = glm::clamp(glm::ivec3(first), glm::ivec3(0), cellCount);
+        lattice.end = glm::clamp(glm::ivec3(last) + 1, lattice.begin, cellCount);
+        return lattice;
+    }
+
+    glm::vec3 getLatticePoint(const SceneLattice& lattice, int i, int j, int k) {
+        return lattice.origin + (glm::vec3(i, j, k) + 0.5f) * lattice.spacing;
+    }
+
+    // first shape containing the point, nullptr if none does
+    const SceneShape* findSceneShape(const glm::vec3& point) {
+        for (const SceneShape& shape : sceneShapes) {
+            if (glm::any(glm::lessThan(point, shape.min)) || glm::any(glm::greaterThan(point, shape.max))) {
+                continue;
+            }
+            if (shape.type == SceneShapeType::BLOCK) {
+                return &shape;
+            }
+            glm::vec3 offset = point - shape.center;
+            if (glm::dot(offset, offset) <= shape.radius * shape.radius) {
+                return &shape;
+            }
+        }
+        return nullptr;
+    }
+
+    common::ThreadPool& getSceneThreadPool() {
+        if (!sceneThreadPool) {
+            sceneThreadPool = std::make_unique<common::ThreadPool>(cpuThreadCount);
+        }
+        return *sceneThreadPool;
+    }
+
+    bool isSameLattice(const SceneLattice& a, const SceneLattice& b) {
+        return a.spacing == b.spacing && a.origin == b.origin && a.begin == b.begin && a.end == b.end;
+    }
+
+    // particles per lattice slab of constant x, the slabs are counted and later filled in parallel
+    const std::vector<unsigned int>& countSlabParticles(const SceneLattice& lattice) {
+        if (slabCountCached && isSameLattice(lattice, cachedLattice)) {
+            return cachedSlabCount;
+        }
+
+        std::vector<unsigned int> slabCount(std::max(0, lattice.end.x - lattice.begin.x), 0);
+        getSceneThreadPool().parallelFor(0, slabCount.size(), 1, [&](size_t chunkBegin, size_t chunkEnd) {
+            for (size_t slab = chunkBegin; slab < chunkEnd; slab++) {
+                int i = lattice.begin.x + static_cast<int>(slab);
+                unsigned int count = 0;
+                for (int j = lattice.begin.y; j < lattice.end.y; j++) {
+                    for (int k = lattice.begin.z; k < lattice.end.z; k++) {
+                        count += findSceneShape(getLatticePoint(lattice, i, j, k)) ? 1 : 0;
+                    }
+                }
+                slabCount[slab] = count;
+            }
+        });
+
+        cachedLattice = lattice;
+        cachedSlabCount = std::move(slabCount);
+        slabCountCached = true;
+        return cachedSlabCount;
+    }
+
+    unsigned int countSceneParticles() {
+        SceneLattice lattice = getSceneLattice();
+        const std::vector<unsigned int>& slabCount = countSlabParticles(lattice);
+
+        unsigned int count = 0;
+        for (unsigned int slab : slabCount) {
+            count += slab;
+        }
+        return count;
+    }
+
+    int sampleScene(std::vector<glm::vec4>& position, std::vector<glm::vec4>& velocity) {
+        SceneLattice lattice = getSceneLattice();
+        const std::vector<unsigned int>& slabCount = countSlabParticles(lattice);
+
+        // every slab writes its own range of the output
+        std::vector<size_t> slabOffset(slabCount.size() + 1, 0);
+        for (size_t slab = 0; slab < slabCount.size(); slab++) {
+            slabOffset[slab + 1] = slabOffset[slab] + slabCount[slab];
+        }
+        position.resize(slabOffset.back());
+        velocity.resize(slabOffset.back());
+
+        getSceneThreadPool().parallelFor(0, slabCount.size(), 1, [&](size_t chunkBegin, size_t chunkEnd) {
+            for (size_t slab = chunkBegin; slab < chunkEnd; slab++) {
+                int i = lattice.begin.x + static_cast<int>(slab);
+                size_t index = slabOffset[slab];
+                for (int j = lattice.begin.y; j < lattice.end.y; j++) {
+                    for (int k = lattice.begin.z; k < lattice.end.z; k++) {
+                        glm::vec3 point = getLatticePoint(lattice, i, j, k);
+                        const SceneShape* shape = findSceneShape(point);
+                        if (shape) {
+                            position[index] = glm::vec4(point, 0.0f);
+                            velocity[index] = glm::vec4(shape->velocity, 0.0f);
+                            index++;
+                        }
+                    }
+                }
+            }
+        });
+
+        return 0;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+namespace simulator {
+    // Scene file, a subset of TOML:
+    //   name = "two blocks"
+    //   [domain]   xz = 1.2, height = 2.0 (world units, the domain is centered on x = z = 0 and starts at y = 0)
+    //   [physics]  iterations, viscosity, vorticity, reorder-interval (the gui parameters)
+    //   [[block]]  min = [x, y, z], max = [x, y, z], velocity = [x, y, z] (optional)
+    //   [[sphere]] center = [x, y, z], radius = r, velocity = [x, y, z] (optional)
+    // Every shape is filled with the points of one lattice spaced a particle diameter apart,
+    // so overlapping shapes never put two particles on top of each other, the first shape listed wins.
+    enum class SceneShapeType {
+        BLOCK,
+        SPHERE,
+    };
+
+    struct SceneShape {
+        SceneShapeType type;
+        // bounding box, the block itself for BLOCK
+        glm::vec3 min;
+        glm::vec3 max;
+        glm::vec3 center;
+        float radius;
+        glm::vec3 velocity;
+    };
+
+    // shapes of the loaded scene file, empty runs the built-in two dam break
+    extern std::vector<SceneShape> sceneShapes;
+    extern std::string sceneName;
+
+    // sets the domain of simulationScale and the gui parameters the file lists, has to run before configureScale()
+    int loadSceneFile(const std::string& fileName);
+    // lattice points inside the shapes for the configured domain
+    unsigned int countSceneParticles();
+    // samples the shapes on the CPU threads, particles come out in lattice order
+    int sampleScene(std::vector<glm::vec4>& position, std::vector<glm::vec4>& velocity);
+}
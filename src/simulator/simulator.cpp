@@ -1,18 +1,44 @@
 #include "simulator.hpp"
 
 #include <vector>
+#include <algorithm>
+#include <memory>
 #include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <utility>
+#include <cmath>
+#include <chrono>
 
 #include "../common/compute_shader.hpp"
+#include "../common/profiler.hpp"
+#include "../common/gpu_memory.hpp"
 #include "../common/performance_log.hpp"
+#include "../common/scan.hpp"
+#include "cpuSimulator.hpp"
+#include "sceneFile.hpp"
 
 namespace simulator {
+    Backend backend = Backend::GPU;
+    unsigned int cpuThreadCount = 0;
+    bool headless = false;
+
+    SimulationScale simulationScale;
+    unsigned int particleCountPerEdgeXZ;
+    unsigned int particleCountPerEdgeY;
+    unsigned int particleCount;
+    common::real domainHorizonMaxCoordinate;
+    common::real domainMaxHeight;
+
     // gui parameters
     int constraintProjectionIteration = 4;
     float viscosityParameter = 0.005f;
     float vorticityParameter = 0.0f; 
-    int maxNeighborCount = 256;
-    common::real horizonMaxCoordinate = HORIZON_MAX_COORDINATE;
+    common::real horizonMaxCoordinate;
+    NeighborSearchMode neighborSearchMode = NEIGHBOR_LIST;
+    int reorderInterval = 30;
+    bool fuseLambdaKernel = true;
 
     int uLeft = 0;
     int uRight = 0;
@@ -22,11 +48,9 @@ namespace simulator {
     int uBack = 0;
     float uDeltaVelocity = 5.0f;
 
-    // performance log
-    const unsigned int QUERY_START_INDEX = 1;
+    unsigned int simulateFrameCount = 0;
 
-    const GLuint CUBE_COUNT = GLuint(ceil(HORIZON_MAX_COORDINATE / KERNEL_RADIUS)) * GLuint(ceil(HORIZON_MAX_COORDINATE / KERNEL_RADIUS)) * GLuint(ceil(MAX_HEIGHT / KERNEL_RADIUS));
-    const GLuint CUBE_COUNT_SQRT = GLuint(ceil(sqrt(CUBE_COUNT)));
+    GLuint cubeCount;
 
     GLuint particlePositionSSBO;
     GLuint positionPredictSSBO;
@@ -34,44 +58,90 @@ namespace simulator {
 
     GLuint particleCountPerCubeSSBO;
     GLuint cubeOffsetSSBO;
-    GLuint blockOffsetSSBO;
     GLuint particleIndexInCubeSSBO;
 
     GLuint neighborCountPerParticleSSBO;
     GLuint neighborIndexBufferSSBO;
+    GLuint neighborOffsetSSBO;
+
+    // neighborIndexBuffer size in indices, the neighbor total is read back a few frames late to avoid a stall
+    GLuint neighborCapacity;
+    // the first list after simulateInit() and restoreParticleState() waits for the total instead, so it always fits
+    bool neighborCapacityFitted;
+
+    // std430 mirror of the NeighborStatistics buffer of computeNeighborStatistics.comp
+    struct NeighborStatisticsBuffer {
+        GLuint minCount;
+        GLuint maxCount;
+        GLuint totalCount;
+        GLuint histogram[NEIGHBOR_HISTOGRAM_BIN_COUNT];
+    };
+    const GLuint NEIGHBOR_STATISTICS_BINDING = 28;
+    NeighborStatistics neighborStatistics;
+    GLuint neighborStatisticsSSBO;
+    // one reduction in flight at a time, the frame and capacity it was computed with are kept for the result
+    GLuint neighborStatisticsReadbackBuffer;
+    GLsync neighborStatisticsFence = nullptr;
+    unsigned int neighborStatisticsFrameCount;
+    GLuint neighborStatisticsCapacity;
 
     GLuint densitySSBO;
     GLuint constraintSSBO;
     GLuint constraintGradSquareSumSSBO;
     GLuint lambdaSSBO;
 
-    GLuint deltaPositionSSBO;
 
     GLuint curlSSBO;
     GLuint curlXSSBO;
     GLuint curlYSSBO;
     GLuint curlZSSBO;
 
+    GLuint particleIdSSBO;
+
+    // std140 mirror of the SimulationParameter uniform block, see getSimulationParameterBlock()
+    struct SimulationParameter {
+        float boundaryHorizonMaxCoordinate;
+        float viscosityParameter;
+        float vorticityParameter;
+        GLuint neighborCapacity;
+        float deltaVelocity;
+        GLint left;
+        GLint right;
+        GLint up;
+        GLint down;
+        GLint front;
+        GLint back;
+        // std140 rounds the block size up to 16 bytes
+        GLint padding;
+    };
+    const GLuint SIMULATION_PARAMETER_BINDING = 0;
+    GLuint simulationParameterUBO;
+    // targets of reorderParticle(), swapped with the live buffers afterwards
+    // positionPredictAidSSBO is also the ping-pong partner of correctPositionPredict()
+    GLuint reorderParticlePositionSSBO;
+    GLuint positionPredictAidSSBO;
+    GLuint reorderVelocitySSBO;
+    GLuint reorderParticleIdSSBO;
+
     ComputeShader applyExternalForcesCS;
     
     ComputeShader clearParticleCountPerCubeCS;
     ComputeShader computeParticleCountPerCubeCS;
-    ComputeShader computeOffsetByParticleCountCS;
-    ComputeShader computeInnerOffsetAndBlockSumCS;
-    ComputeShader computeBlockOffsetCS;
-    ComputeShader computeOffsetByBlockOffsetCS;
     ComputeShader assignParticleToCubeCS;
+    ComputeShader reorderParticleCS;
 
+    ComputeShader countNeighborFromCubeCS;
     ComputeShader searchNeighborFromCubeCS;
+    ComputeShader computeNeighborStatisticsCS;
 
     ComputeShader computeDensityCS;
     ComputeShader computeConstraintCS;
     ComputeShader computeConstraintGradSquareSumCS;
     ComputeShader computeLambdaCS;
+    ComputeShader computeLambdaFusedCS;
 
     ComputeShader handleBoundaryCollisionCS;
-    ComputeShader computeDeltaPositionCS;
-    ComputeShader adjustPositionPredictCS;
+    ComputeShader correctPositionPredictCS;
     ComputeShader updateVelocityByPositionCS;
 
     ComputeShader applyViscosityCS;
@@ -81,113 +151,184 @@ namespace simulator {
 
     ComputeShader manipulateVelocityCS;
 
+    std::unique_ptr<common::ExclusiveScan> exclusiveScan;
+
+    // the mode the programs were compiled for, switching modes in the gui rebuilds them
+    NeighborSearchMode compiledNeighborSearchMode;
+
+    int configureScale() {
+        const common::real DIAMETER = PARTICLE_RADIUS * 2.0;
+
+        particleCountPerEdgeXZ = std::max(1u, simulationScale.particleCountPerEdgeXZ);
+        // each of the two dam break blocks gets half of the layers
+        particleCountPerEdgeY = std::max(2u, simulationScale.particleCountPerEdgeY + simulationScale.particleCountPerEdgeY % 2);
+
+        domainHorizonMaxCoordinate = simulationScale.horizonMaxCoordinate > 0.0 ? simulationScale.horizonMaxCoordinate : particleCountPerEdgeXZ * DIAMETER * HORIZON_DIAMETER_PER_PARTICLE;
+        domainMaxHeight = simulationScale.maxHeight > 0.0 ? simulationScale.maxHeight : (particleCountPerEdgeY + HEADROOM_DIAMETER) * DIAMETER;
+        horizonMaxCoordinate = domainHorizonMaxCoordinate;
+
+        if (simulationScale.particleCount > 0) {
+            particleCount = simulationScale.particleCount;
+        }
+        else if (!sceneShapes.empty()) {
+            particleCount = countSceneParticles();
+        }
+        else {
+            particleCount = particleCountPerEdgeXZ * particleCountPerEdgeXZ * particleCountPerEdgeY;
+        }
+        if (particleCount == 0) {
+            std::cerr << "the scene has no particles inside the domain" << std::endl;
+            return -1;
+        }
+
+        cubeCount = GLuint(ceil(domainHorizonMaxCoordinate / KERNEL_RADIUS)) * GLuint(ceil(domainHorizonMaxCoordinate / KERNEL_RADIUS)) * GLuint(ceil(domainMaxHeight / KERNEL_RADIUS));
+
+        return 0;
+    }
+
+    SimulationScale scaleFromParticleCount(unsigned int count) {
+        const double aspectRatio = static_cast<double>(DEFAULT_PARTICLE_COUNT_PER_EDGE_Y) / DEFAULT_PARTICLE_COUNT_PER_EDGE_XZ;
+
+        SimulationScale scale;
+        scale.particleCountPerEdgeXZ = std::max(1u, static_cast<unsigned int>(std::lround(std::cbrt(count / aspectRatio))));
+        unsigned int layerSize = scale.particleCountPerEdgeXZ * scale.particleCountPerEdgeXZ;
+        scale.particleCountPerEdgeY = std::max(2u, static_cast<unsigned int>(std::lround(static_cast<double>(count) / layerSize / 2.0)) * 2);
+
+        return scale;
+    }
+
     int simulateInit() {
+        if (configureScale() != 0) {
+            return -1;
+        }
+        if (headless) {
+            if (backend != Backend::CPU) {
+                std::cerr << "only the CPU backend runs without an OpenGL context" << std::endl;
+                return -1;
+            }
+            simulateFrameCount = 0;
+            neighborStatistics = NeighborStatistics();
+
+            std::vector<glm::vec4> initialPosition;
+            std::vector<glm::vec4> initialVelocity;
+            generateParticleState(initialPosition, initialVelocity);
+            cpu::simulateInit(initialPosition, cpuThreadCount);
+            cpu::setParticleState(initialPosition, initialVelocity);
+            std::cout << "CPU backend with " << cpu::getThreadCount() << " threads, without an OpenGL context" << std::endl;
+            return 0;
+        }
+
+        common::GPUMemoryOwner gpuMemoryOwner("simulator");
+
         glGenBuffers(1, &particlePositionSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, particlePositionSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, PARTICLE_COUNT * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
         glGenBuffers(1, &positionPredictSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, positionPredictSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, PARTICLE_COUNT * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
         glGenBuffers(1, &velocitySSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, velocitySSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, PARTICLE_COUNT * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
 
         glGenBuffers(1, &particleCountPerCubeSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleCountPerCubeSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, CUBE_COUNT * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, cubeCount * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
         glGenBuffers(1, &cubeOffsetSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, cubeOffsetSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, CUBE_COUNT * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, (cubeCount + 1) * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
         glGenBuffers(1, &particleIndexInCubeSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleIndexInCubeSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, PARTICLE_COUNT * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
-        glGenBuffers(1, &blockOffsetSSBO);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, blockOffsetSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, CUBE_COUNT_SQRT * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
 
         glGenBuffers(1, &neighborCountPerParticleSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, neighborCountPerParticleSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, PARTICLE_COUNT * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+        neighborCapacity = particleCount * INITIAL_NEIGHBOR_COUNT_PER_PARTICLE;
+        neighborCapacityFitted = false;
         glGenBuffers(1, &neighborIndexBufferSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, neighborIndexBufferSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, PARTICLE_COUNT * maxNeighborCount * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, neighborCapacity * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+        glGenBuffers(1, &neighborOffsetSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, neighborOffsetSSBO);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, (particleCount + 1) * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+        glGenBuffers(1, &neighborStatisticsSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, neighborStatisticsSSBO);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(NeighborStatisticsBuffer), nullptr, GL_DYNAMIC_DRAW);
+        glGenBuffers(1, &neighborStatisticsReadbackBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, neighborStatisticsReadbackBuffer);
+        common::gpuBufferData(GL_COPY_WRITE_BUFFER, sizeof(NeighborStatisticsBuffer), nullptr, GL_STREAM_READ);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        neighborStatistics = NeighborStatistics();
 
         glGenBuffers(1, &densitySSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, densitySSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, PARTICLE_COUNT * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
         glGenBuffers(1, &constraintSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, constraintSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, PARTICLE_COUNT * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
         glGenBuffers(1, &constraintGradSquareSumSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, constraintGradSquareSumSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, PARTICLE_COUNT * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
         glGenBuffers(1, &lambdaSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, lambdaSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, PARTICLE_COUNT * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
-
-        glGenBuffers(1, &deltaPositionSSBO);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, deltaPositionSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, PARTICLE_COUNT * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
 
         glGenBuffers(1, &curlSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, curlSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, PARTICLE_COUNT * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
-
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particlePositionSSBO);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, positionPredictSSBO);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, velocitySSBO);
-
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, particleCountPerCubeSSBO);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, cubeOffsetSSBO);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, particleIndexInCubeSSBO);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, blockOffsetSSBO);
-
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, neighborCountPerParticleSSBO);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, neighborIndexBufferSSBO);
-
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, densitySSBO);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, constraintSSBO);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, constraintGradSquareSumSSBO);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, lambdaSSBO);
-
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, deltaPositionSSBO);
-
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 16, curlSSBO);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 17, curlXSSBO);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 18, curlYSSBO);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 19, curlZSSBO);
-
-
-        particlePositionInit();
-
-        applyExternalForcesCS = ComputeShader("src/simulator/shader/applyExternalForce.comp");
-        handleBoundaryCollisionCS = ComputeShader("src/simulator/shader/handleBoundaryCollision.comp");
-
-        clearParticleCountPerCubeCS = ComputeShader("src/simulator/shader/searchNeighbor/divideCube/clearParticleCountPerCube.comp");
-        computeParticleCountPerCubeCS = ComputeShader("src/simulator/shader/searchNeighbor/divideCube/computeParticleCountPerCube.comp");
-        computeOffsetByParticleCountCS = ComputeShader("src/simulator/shader/searchNeighbor/divideCube/computeOffsetByParticleCount.comp");
-        computeInnerOffsetAndBlockSumCS = ComputeShader("src/simulator/shader/searchNeighbor/divideCube/computeInnerOffsetAndBlockSum.comp");
-        computeBlockOffsetCS = ComputeShader("src/simulator/shader/searchNeighbor/divideCube/computeBlockOffset.comp");
-        computeOffsetByBlockOffsetCS = ComputeShader("src/simulator/shader/searchNeighbor/divideCube/computeOffsetByBlockOffset.comp");
-        assignParticleToCubeCS = ComputeShader("src/simulator/shader/searchNeighbor/divideCube/assignParticleToCube.comp");
-
-            searchNeighborFromCubeCS = ComputeShader("src/simulator/shader/searchNeighbor/searchNeighborFromCube.comp");
-
-        computeDensityCS = ComputeShader("src/simulator/shader/computeLambda/computeDensity.comp");
-        computeConstraintCS = ComputeShader("src/simulator/shader/computeLambda/computeConstraint.comp");
-        computeConstraintGradSquareSumCS = ComputeShader("src/simulator/shader/computeLambda/computeConstraintGradSquareSum.comp");
-        computeLambdaCS = ComputeShader("src/simulator/shader/computeLambda/computeLambda.comp");
-        
-        computeDeltaPositionCS = ComputeShader("src/simulator/shader/computeDeltaPosition.comp");
-        adjustPositionPredictCS = ComputeShader("src/simulator/shader/adjustPositionPredict.comp");
-        updateVelocityByPositionCS = ComputeShader("src/simulator/shader/updateVelocityByPosition.comp");
-
-        applyViscosityCS = ComputeShader("src/simulator/shader/applyViscosity.comp");
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+        glGenBuffers(1, &curlXSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, curlXSSBO);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+        glGenBuffers(1, &curlYSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, curlYSSBO);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+        glGenBuffers(1, &curlZSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, curlZSSBO);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+
+        std::vector<GLuint> particleIdVector(particleCount);
+        for (GLuint i = 0; i < particleCount; i++) {
+            particleIdVector[i] = i;
+        }
+        glGenBuffers(1, &particleIdSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleIdSSBO);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(GLuint), particleIdVector.data(), GL_DYNAMIC_DRAW);
+        glGenBuffers(1, &reorderParticlePositionSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, reorderParticlePositionSSBO);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+        glGenBuffers(1, &positionPredictAidSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, positionPredictAidSSBO);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+        glGenBuffers(1, &reorderVelocitySSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, reorderVelocitySSBO);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+        glGenBuffers(1, &reorderParticleIdSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, reorderParticleIdSSBO);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+
+        glGenBuffers(1, &simulationParameterUBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, simulationParameterUBO);
+        common::gpuBufferData(GL_UNIFORM_BUFFER, sizeof(SimulationParameter), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        bindSSBO();
+
+        simulateFrameCount = 0;
+
+        std::vector<glm::vec4> initialPosition;
+        std::vector<glm::vec4> initialVelocity;
+        generateParticleState(initialPosition, initialVelocity);
+        particleStateInit(initialPosition, initialVelocity);
+
+        if (backend == Backend::CPU) {
+            cpu::simulateInit(initialPosition, cpuThreadCount);
+            cpu::setParticleState(initialPosition, initialVelocity);
+            std::cout << "CPU backend with " << cpu::getThreadCount() << " threads" << std::endl;
+        }
 
-        computeCurlCS = ComputeShader("src/simulator/shader/applyVorticityConfinement/computeCurl.comp");
-        applyVorticityConfinementCS = ComputeShader("src/simulator/shader/applyVorticityConfinement/applyVorticityConfinement.comp");
+        compileComputeShader();
 
-        manipulateVelocityCS = ComputeShader("src/simulator/shader/manipulateVelocity.comp");
+        exclusiveScan = std::make_unique<common::ExclusiveScan>();
 
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
@@ -197,408 +338,745 @@ namespace simulator {
     }
 
     int simulate() {
-        applyExternalForce();
+        PROFILE_GPU("simulate");
 
-        {
-        common::queryTime(QUERY_START_INDEX + 0);
+        if (backend == Backend::CPU) {
+            simulateOnCPU();
+            simulateFrameCount++;
+            return 0;
         }
 
-        searchNeighbor();
-
-        {
-        common::queryTime(QUERY_START_INDEX + 1);
+        if (neighborSearchMode != compiledNeighborSearchMode) {
+            deleteComputeShader();
+            compileComputeShader();
         }
 
-        for (int i = 0; i < constraintProjectionIteration; i++) {
-            computeLambda();
-            computeDeltaPosition();
-            handleBoundaryCollision();
-            adjustPositionPredict();
-        }
+        updateNeighborStatistics();
+        updateSimulationParameter();
 
-        {
-        common::queryTime(QUERY_START_INDEX + 2);
-        }
+        applyExternalForce();
 
-        updateVelocityByPosition();
+        searchNeighbor();
 
         {
-        common::queryTime(QUERY_START_INDEX + 3);
+            PROFILE_GPU("constraintProjection");
+            for (int i = 0; i < constraintProjectionIteration; i++) {
+                computeLambda();
+                correctPositionPredict();
+            }
         }
 
+        updateVelocityByPosition();
+
         if (vorticityParameter > 0.0f)
             applyVorticityConfinement();
 
-        {
-        common::queryTime(QUERY_START_INDEX + 4);
-        }
-
         if (viscosityParameter > 0.0f)
             applyViscosity();
 
         manipulateVelocity();
 
-        {
-        common::queryTime(QUERY_START_INDEX + 5);
+        handleBoundaryCollision();
+
+        updateParticlePosition();
+
+        simulateFrameCount++;
+
+        return 0;
+    }
+
+    int restoreParticleState(const std::vector<glm::vec4>& position, const std::vector<glm::vec4>& velocity, const std::vector<GLuint>& particleId,
+                             unsigned int frameCount, GLuint capacity) {
+        if (position.size() != particleCount || velocity.size() != particleCount || particleId.size() != particleCount) {
+            std::cerr << "restoreParticleState: expected " << particleCount << " particles, got " << position.size() << std::endl;
+            return -1;
+        }
+        if (headless) {
+            simulateFrameCount = frameCount;
+            cpu::setParticleState(position, velocity);
+            return 0;
         }
 
-        handleBoundaryCollision();
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, particlePositionSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, particleCount * sizeof(glm::vec4), position.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, velocitySSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, particleCount * sizeof(glm::vec4), velocity.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleIdSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, particleCount * sizeof(GLuint), particleId.data());
 
-        {
-        common::queryTime(QUERY_START_INDEX + 6);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        // frames over the capacity walk the cubes, so the saved one has to come back too for the same result
+        if (capacity > neighborCapacity) {
+            growNeighborCapacity(capacity);
         }
+        neighborCapacityFitted = false;
 
-        updateParticlePosition();
+        simulateFrameCount = frameCount;
 
+        if (backend == Backend::CPU) {
+            cpu::setParticleState(position, velocity);
+        }
 
         return 0;
     }
 
     int simulateTerminate() {
+        if (backend == Backend::CPU) {
+            cpu::simulateTerminate();
+        }
+        if (headless) {
+            return 0;
+        }
+
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
         for (GLuint i = 0; i < 20; i++) {
             glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, 0);
         }
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NEIGHBOR_STATISTICS_BINDING, 0);
         glMemoryBarrier(GL_ALL_BARRIER_BITS);
 
-        glDeleteBuffers(1, &particlePositionSSBO);
-        glDeleteBuffers(1, &positionPredictSSBO);
-        glDeleteBuffers(1, &velocitySSBO);
-        glDeleteBuffers(1, &particleCountPerCubeSSBO);
-        glDeleteBuffers(1, &cubeOffsetSSBO);
-        glDeleteBuffers(1, &blockOffsetSSBO);
-        glDeleteBuffers(1, &particleIndexInCubeSSBO);
-        glDeleteBuffers(1, &neighborCountPerParticleSSBO);
-        glDeleteBuffers(1, &neighborIndexBufferSSBO);
-        glDeleteBuffers(1, &densitySSBO);
-        glDeleteBuffers(1, &constraintSSBO);
-        glDeleteBuffers(1, &constraintGradSquareSumSSBO);
-        glDeleteBuffers(1, &lambdaSSBO);
-        glDeleteBuffers(1, &deltaPositionSSBO);
-        glDeleteBuffers(1, &curlSSBO);
-        glDeleteBuffers(1, &curlXSSBO);
-        glDeleteBuffers(1, &curlYSSBO);
-        glDeleteBuffers(1, &curlZSSBO);
+        common::gpuDeleteBuffers(1, &particlePositionSSBO);
+        common::gpuDeleteBuffers(1, &positionPredictSSBO);
+        common::gpuDeleteBuffers(1, &velocitySSBO);
+        common::gpuDeleteBuffers(1, &particleCountPerCubeSSBO);
+        common::gpuDeleteBuffers(1, &cubeOffsetSSBO);
+        common::gpuDeleteBuffers(1, &particleIndexInCubeSSBO);
+        common::gpuDeleteBuffers(1, &neighborCountPerParticleSSBO);
+        common::gpuDeleteBuffers(1, &neighborIndexBufferSSBO);
+        common::gpuDeleteBuffers(1, &neighborOffsetSSBO);
+        common::gpuDeleteBuffers(1, &neighborStatisticsSSBO);
+        common::gpuDeleteBuffers(1, &neighborStatisticsReadbackBuffer);
+        if (neighborStatisticsFence) {
+            glDeleteSync(neighborStatisticsFence);
+            neighborStatisticsFence = nullptr;
+        }
+        common::gpuDeleteBuffers(1, &densitySSBO);
+        common::gpuDeleteBuffers(1, &constraintSSBO);
+        common::gpuDeleteBuffers(1, &constraintGradSquareSumSSBO);
+        common::gpuDeleteBuffers(1, &lambdaSSBO);
+        common::gpuDeleteBuffers(1, &curlSSBO);
+        common::gpuDeleteBuffers(1, &curlXSSBO);
+        common::gpuDeleteBuffers(1, &curlYSSBO);
+        common::gpuDeleteBuffers(1, &curlZSSBO);
+        common::gpuDeleteBuffers(1, &particleIdSSBO);
+        common::gpuDeleteBuffers(1, &reorderParticlePositionSSBO);
+        common::gpuDeleteBuffers(1, &positionPredictAidSSBO);
+        common::gpuDeleteBuffers(1, &reorderVelocitySSBO);
+        common::gpuDeleteBuffers(1, &reorderParticleIdSSBO);
+        glBindBufferBase(GL_UNIFORM_BUFFER, SIMULATION_PARAMETER_BINDING, 0);
+        common::gpuDeleteBuffers(1, &simulationParameterUBO);
+
+        deleteComputeShader();
+
+        exclusiveScan.reset();
+
+        glFinish();
+
+        return 0;
+    }
+
+    std::string glslFloat(common::real value) {
+        // 9 significant digits round-trip a float exactly
+        std::ostringstream stream;
+        stream << std::scientific << std::setprecision(8) << static_cast<float>(value);
+        return stream.str();
+    }
+
+    std::string glslUint(GLuint value) {
+        return std::to_string(value) + "u";
+    }
+
+    // the block declaration for the shaders, they write SIMULATION_PARAMETER_BLOCK where they need it,
+    // a define is a single line, so the whole declaration is one as well
+    std::string getSimulationParameterBlock() {
+        return "layout(std140, binding = " + std::to_string(SIMULATION_PARAMETER_BINDING) + ") uniform SimulationParameter { "
+               "float BOUNDARY_HORIZON_MAX_COORDINATE; "
+               "float VISCOSITY_PARAMETER; "
+               "float VORTICITY_PARAMETER; "
+               "uint NEIGHBOR_CAPACITY; "
+               "float uDeltaVelocity; "
+               "int uLeft; "
+               "int uRight; "
+               "int uUp; "
+               "int uDown; "
+               "int uFront; "
+               "int uBack; "
+               "};";
+    }
+
+    // the cube grid of divideCube and its helpers for the shaders that walk the 27 cubes around a particle,
+    // written as NEIGHBOR_CUBE_BLOCK like SIMULATION_PARAMETER_BLOCK, getSurroundingCubeIndex(indexInCube, i, cubeIndex)
+    // gives the i-th of the 27 cubes with x slowest and returns false for cubes outside the grid
+    std::string getNeighborCubeBlock() {
+        return "layout(std430, binding = 3) buffer ParticleCountPerCube { uint particleCountPerCube[]; }; "
+               "layout(std430, binding = 4) buffer CubeOffset { uint cubeOffset[]; }; "
+               "layout(std430, binding = 5) buffer ParticleIndexInCube { uint particleIndexInCube[]; }; "
+               "const int cubeCountXZ = CUBE_COUNT_XZ; "
+               "const int cubeCountY = CUBE_COUNT_Y; "
+               "const ivec3 cubeIndexDot = ivec3(cubeCountXZ * cubeCountY, cubeCountXZ, 1); "
+               "ivec3 getIndexInCube(vec3 position) { "
+               "vec3 positionInCube = (position + vec3(0.5 * HORIZON_MAX_COORDINATE, 0.0, 0.5 * HORIZON_MAX_COORDINATE)) / KERNEL_RADIUS; "
+               "return ivec3(floor(positionInCube)); "
+               "} "
+               "bool getSurroundingCubeIndex(ivec3 indexInCube, int i, out int cubeIndex) { "
+               "ivec3 surroundingIndexInCube = indexInCube + ivec3(i / 9 - 1, i / 3 % 3 - 1, i % 3 - 1); "
+               "cubeIndex = int(dot(surroundingIndexInCube, cubeIndexDot)); "
+               "return all(greaterThanEqual(surroundingIndexInCube, ivec3(0))) && all(lessThan(surroundingIndexInCube, ivec3(cubeCountXZ, cubeCountY, cubeCountXZ))); "
+               "}";
+    }
+
+    // constants that never change while the simulation runs are baked into the shaders as literals,
+    // so they don't have to be uploaded per dispatch and the kernel factors fold at compile time
+    std::vector<std::pair<std::string, std::string>> getShaderDefines() {
+        return {
+            { "PARTICLE_COUNT", glslUint(particleCount) },
+            { "CUBE_COUNT", glslUint(cubeCount) },
+            { "CUBE_COUNT_XZ", std::to_string(static_cast<int>(ceil(domainHorizonMaxCoordinate / KERNEL_RADIUS))) },
+            { "CUBE_COUNT_Y", std::to_string(static_cast<int>(ceil(domainMaxHeight / KERNEL_RADIUS))) },
+            { "HORIZON_MAX_COORDINATE", glslFloat(domainHorizonMaxCoordinate) },
+            { "MAX_HEIGHT", glslFloat(domainMaxHeight) },
+            { "DELTA_TIME", glslFloat(DELTA_TIME) },
+            { "DELTA_TIME_REVERSE", glslFloat(DELTA_TIME_REVERSE) },
+            { "KERNEL_RADIUS", glslFloat(KERNEL_RADIUS) },
+            { "PI", glslFloat(common::PI) },
+            { "POLY6_FACTOR", glslFloat(315.0 / (64.0 * common::PI * pow(KERNEL_RADIUS, 9))) },
+            { "SPIKY_GRADIENT_FACTOR", glslFloat(-45.0 / (common::PI * pow(KERNEL_RADIUS, 6))) },
+            { "REST_DENSITY_REVERSE", glslFloat(REST_DENSITY_REVERSE) },
+            { "RELAXATION_PARAMETER", glslFloat(RELAXATION_PARAMETER) },
+            { "GRAVITY", "vec3(" + glslFloat(GRAVITY.x) + ", " + glslFloat(GRAVITY.y) + ", " + glslFloat(GRAVITY.z) + ")" },
+            { "RESTITUTION", glslFloat(RESTITUTION) },
+            { "FRICTION", glslFloat(FRICTION) },
+            { "MASS", glslFloat(MASS) },
+            { "MASS_REVERSE", glslFloat(MASS_REVERSE) },
+            { "USE_NEIGHBOR_LIST", neighborSearchMode == NEIGHBOR_LIST ? "true" : "false" },
+            { "NEIGHBOR_HISTOGRAM_BIN_COUNT", glslUint(NEIGHBOR_HISTOGRAM_BIN_COUNT) },
+            { "NEIGHBOR_HISTOGRAM_BIN_WIDTH", glslUint(NEIGHBOR_HISTOGRAM_BIN_WIDTH) },
+            { "SIMULATION_PARAMETER_BLOCK", getSimulationParameterBlock() },
+            { "NEIGHBOR_CUBE_BLOCK", getNeighborCubeBlock() },
+        };
+    }
+
+    int compileComputeShader() {
+        std::vector<std::pair<std::string, std::string>> defines = getShaderDefines();
+
+        applyExternalForcesCS = ComputeShader("src/simulator/shader/applyExternalForce.comp", defines);
+        handleBoundaryCollisionCS = ComputeShader("src/simulator/shader/handleBoundaryCollision.comp", defines);
 
+        clearParticleCountPerCubeCS = ComputeShader("src/simulator/shader/searchNeighbor/divideCube/clearParticleCountPerCube.comp", defines);
+        computeParticleCountPerCubeCS = ComputeShader("src/simulator/shader/searchNeighbor/divideCube/computeParticleCountPerCube.comp", defines);
+        assignParticleToCubeCS = ComputeShader("src/simulator/shader/searchNeighbor/divideCube/assignParticleToCube.comp", defines);
+        reorderParticleCS = ComputeShader("src/simulator/shader/reorderParticle.comp", defines);
+
+        countNeighborFromCubeCS = ComputeShader("src/simulator/shader/searchNeighbor/countNeighborFromCube.comp", defines);
+        searchNeighborFromCubeCS = ComputeShader("src/simulator/shader/searchNeighbor/searchNeighborFromCube.comp", defines);
+        computeNeighborStatisticsCS = ComputeShader("src/simulator/shader/searchNeighbor/computeNeighborStatistics.comp", defines);
+
+        computeDensityCS = ComputeShader("src/simulator/shader/computeLambda/computeDensity.comp", defines);
+        computeConstraintCS = ComputeShader("src/simulator/shader/computeLambda/computeConstraint.comp", defines);
+        computeConstraintGradSquareSumCS = ComputeShader("src/simulator/shader/computeLambda/computeConstraintGradSquareSum.comp", defines);
+        computeLambdaCS = ComputeShader("src/simulator/shader/computeLambda/computeLambda.comp", defines);
+        computeLambdaFusedCS = ComputeShader("src/simulator/shader/computeLambda/computeLambdaFused.comp", defines);
+        
+        correctPositionPredictCS = ComputeShader("src/simulator/shader/correctPositionPredict.comp", defines);
+        updateVelocityByPositionCS = ComputeShader("src/simulator/shader/updateVelocityByPosition.comp", defines);
+
+        applyViscosityCS = ComputeShader("src/simulator/shader/applyViscosity.comp", defines);
+
+        computeCurlCS = ComputeShader("src/simulator/shader/applyVorticityConfinement/computeCurl.comp", defines);
+        applyVorticityConfinementCS = ComputeShader("src/simulator/shader/applyVorticityConfinement/applyVorticityConfinement.comp", defines);
+
+        manipulateVelocityCS = ComputeShader("src/simulator/shader/manipulateVelocity.comp", defines);
+
+        compiledNeighborSearchMode = neighborSearchMode;
+
+        return 0;
+    }
+
+    int deleteComputeShader() {
         glDeleteProgram(applyExternalForcesCS.ID);
         glDeleteProgram(clearParticleCountPerCubeCS.ID);
         glDeleteProgram(computeParticleCountPerCubeCS.ID);
-        glDeleteProgram(computeOffsetByParticleCountCS.ID);
-        glDeleteProgram(computeInnerOffsetAndBlockSumCS.ID);
-        glDeleteProgram(computeBlockOffsetCS.ID);
-        glDeleteProgram(computeOffsetByBlockOffsetCS.ID);
         glDeleteProgram(assignParticleToCubeCS.ID);
+        glDeleteProgram(reorderParticleCS.ID);
+        glDeleteProgram(countNeighborFromCubeCS.ID);
         glDeleteProgram(searchNeighborFromCubeCS.ID);
+        glDeleteProgram(computeNeighborStatisticsCS.ID);
         glDeleteProgram(computeDensityCS.ID);
         glDeleteProgram(computeConstraintCS.ID);
         glDeleteProgram(computeConstraintGradSquareSumCS.ID);
         glDeleteProgram(computeLambdaCS.ID);
+        glDeleteProgram(computeLambdaFusedCS.ID);
         glDeleteProgram(handleBoundaryCollisionCS.ID);
-        glDeleteProgram(computeDeltaPositionCS.ID);
-        glDeleteProgram(adjustPositionPredictCS.ID);
+        glDeleteProgram(correctPositionPredictCS.ID);
         glDeleteProgram(updateVelocityByPositionCS.ID);
         glDeleteProgram(applyViscosityCS.ID);
         glDeleteProgram(computeCurlCS.ID);
         glDeleteProgram(applyVorticityConfinementCS.ID);
-
-        glFinish();
+        glDeleteProgram(manipulateVelocityCS.ID);
 
         return 0;
     }
 
-
     int applyExternalForce() {
+        PROFILE_GPU("applyExternalForce");
+
         applyExternalForcesCS.use();
-        applyExternalForcesCS.setVec3("GRAVITY", GRAVITY);
-        applyExternalForcesCS.setFloat("DELTA_TIME", static_cast<float>(DELTA_TIME));
-        applyExternalForcesCS.setFloat("MASS_REVERSE", static_cast<float>(MASS_REVERSE));
-        applyExternalForcesCS.setUint("PARTICLE_COUNT", PARTICLE_COUNT);
 
-        // glDispatchCompute(GLuint(ceil(static_cast<double>(PARTICLE_COUNT) / common::INVOCATION_PER_WORKGROUP)), 1, 1);
-        applyExternalForcesCS.dispatchCompute(PARTICLE_COUNT);
+        applyExternalForcesCS.dispatchCompute(particleCount);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
         return 0;
     }
     
     int searchNeighbor() {
+        PROFILE_GPU("searchNeighbor");
+
         divideCube();
+
+        if (neighborSearchMode == CUBE_ITERATION) {
+            return 0;
+        }
+
+        countNeighborFromCube();
+        computeNeighborOffset();
+        if (!neighborCapacityFitted) {
+            fitNeighborCapacity();
+        }
         searchNeighborFromCube();
+        computeNeighborStatistics();
 
         return 0;
     }
 
     int computeLambda() {
+        PROFILE_GPU("computeLambda");
+
+        if (fuseLambdaKernel) {
+            return computeLambdaFused();
+        }
+
         computeDensity();
         computeConstraint();
         computeConstraintGradSquareSum();
 
         computeLambdaCS.use();
-        computeLambdaCS.setFloat("RELAXATION_PARAMETER", static_cast<float>(RELAXATION_PARAMETER));
-        computeLambdaCS.setUint("PARTICLE_COUNT", PARTICLE_COUNT);
 
-        // glDispatchCompute(GLuint(ceil(static_cast<double>(PARTICLE_COUNT) / common::INVOCATION_PER_WORKGROUP)), 1, 1);
-        computeLambdaCS.dispatchCompute(PARTICLE_COUNT);
+        computeLambdaCS.dispatchCompute(particleCount);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
         return 0;
     }
 
-    int computeDeltaPosition() {
-        computeDeltaPositionCS.use();
-        computeDeltaPositionCS.setFloat("KERNEL_RADIUS", static_cast<float>(KERNEL_RADIUS));
-        computeDeltaPositionCS.setFloat("MASS", static_cast<float>(MASS));
-        computeDeltaPositionCS.setFloat("REST_DENSITY_REVERSE", static_cast<float>(REST_DENSITY_REVERSE));
-        computeDeltaPositionCS.setFloat("PI", static_cast<float>(common::PI));
-        computeDeltaPositionCS.setUint("MAX_NEIGHBOR_COUNT", maxNeighborCount);
-        computeDeltaPositionCS.setUint("PARTICLE_COUNT", PARTICLE_COUNT);
+    int correctPositionPredict() {
+        PROFILE_GPU("correctPositionPredict");
+
+        correctPositionPredictCS.use();
 
-        // glDispatchCompute(GLuint(ceil(static_cast<double>(PARTICLE_COUNT) / common::INVOCATION_PER_WORKGROUP)), 1, 1);
-        computeDeltaPositionCS.dispatchCompute(PARTICLE_COUNT);
+        // neighbors still read the old positionPredict, so the corrected one goes to the aid buffer
+        // and the two are swapped afterwards instead of copying back
+        correctPositionPredictCS.dispatchCompute(particleCount);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
+        std::swap(positionPredictSSBO, positionPredictAidSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, positionPredictSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, positionPredictAidSSBO);
+
         return 0;
     }
 
     int handleBoundaryCollision() {
-        handleBoundaryCollisionCS.use();
-        handleBoundaryCollisionCS.setFloat("HORIZON_MAX_COORDINATE", static_cast<float>(horizonMaxCoordinate));
-        handleBoundaryCollisionCS.setFloat("RESTITUTION", static_cast<float>(RESTITUTION));
-        handleBoundaryCollisionCS.setFloat("FRICTION", static_cast<float>(FRICTION));
-        handleBoundaryCollisionCS.setFloat("MAX_HEIGHT", static_cast<float>(MAX_HEIGHT));
-        handleBoundaryCollisionCS.setUint("PARTICLE_COUNT", PARTICLE_COUNT);
-
-        // glDispatchCompute(GLuint(ceil(static_cast<double>(PARTICLE_COUNT) / common::INVOCATION_PER_WORKGROUP)), 1, 1);
-        handleBoundaryCollisionCS.dispatchCompute(PARTICLE_COUNT);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        PROFILE_GPU("handleBoundaryCollision");
 
-        return 0;
-    }
-   
-    int adjustPositionPredict() {
-        adjustPositionPredictCS.use();
-        adjustPositionPredictCS.setUint("PARTICLE_COUNT", PARTICLE_COUNT);
+        handleBoundaryCollisionCS.use();
 
-        // glDispatchCompute(GLuint(ceil(static_cast<double>(PARTICLE_COUNT) / common::INVOCATION_PER_WORKGROUP)), 1, 1);
-        adjustPositionPredictCS.dispatchCompute(PARTICLE_COUNT);
+        handleBoundaryCollisionCS.dispatchCompute(particleCount);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
         return 0;
     }
 
     int updateVelocityByPosition() {
+        PROFILE_GPU("updateVelocityByPosition");
+
         updateVelocityByPositionCS.use();
-        updateVelocityByPositionCS.setFloat("DELTA_TIME_REVERSE", static_cast<float>(DELTA_TIME_REVERSE));
-        updateVelocityByPositionCS.setUint("PARTICLE_COUNT", PARTICLE_COUNT);
 
-        // glDispatchCompute(GLuint(ceil(static_cast<double>(PARTICLE_COUNT) / common::INVOCATION_PER_WORKGROUP)), 1, 1);
-        updateVelocityByPositionCS.dispatchCompute(PARTICLE_COUNT);
+        updateVelocityByPositionCS.dispatchCompute(particleCount);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
         return 0;
     }
 
     int applyViscosity() {
+        PROFILE_GPU("applyViscosity");
+
         applyViscosityCS.use();
-        applyViscosityCS.setUint("MAX_NEIGHBOR_COUNT", maxNeighborCount);
-        applyViscosityCS.setFloat("KERNEL_RADIUS", static_cast<float>(KERNEL_RADIUS));
-        applyViscosityCS.setFloat("VISCOSITY_PARAMETER", static_cast<float>(viscosityParameter));
-        applyViscosityCS.setFloat("REST_DENSITY_REVERSE", static_cast<float>(REST_DENSITY_REVERSE));
-        applyViscosityCS.setFloat("PI", static_cast<float>(common::PI));
-        applyViscosityCS.setUint("PARTICLE_COUNT", PARTICLE_COUNT);
-
-        // glDispatchCompute(GLuint(ceil(static_cast<double>(PARTICLE_COUNT) / common::INVOCATION_PER_WORKGROUP)), 1, 1);
-        applyViscosityCS.dispatchCompute(PARTICLE_COUNT);
+
+        applyViscosityCS.dispatchCompute(particleCount);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
         return 0;
     }
 
     int applyVorticityConfinement() {
+        PROFILE_GPU("applyVorticityConfinement");
+
         computeCurl();
 
         applyVorticityConfinementCS.use();
-        applyVorticityConfinementCS.setFloat("KERNEL_RADIUS", static_cast<float>(KERNEL_RADIUS));
-        applyVorticityConfinementCS.setUint("MAX_NEIGHBOR_COUNT", maxNeighborCount);
-        applyVorticityConfinementCS.setFloat("PI", static_cast<float>(common::PI));
-        applyVorticityConfinementCS.setFloat("VORTICITY_PARAMETER", static_cast<float>(vorticityParameter));
-        applyVorticityConfinementCS.setFloat("MASS_REVERSE", static_cast<float>(MASS_REVERSE));
-        applyVorticityConfinementCS.setFloat("DELTA_TIME", static_cast<float>(DELTA_TIME));
-        applyVorticityConfinementCS.setUint("PARTICLE_COUNT", PARTICLE_COUNT);
-
-        // glDispatchCompute(GLuint(ceil(static_cast<double>(PARTICLE_COUNT) / common::INVOCATION_PER_WORKGROUP)), 1, 1);
-        applyVorticityConfinementCS.dispatchCompute(PARTICLE_COUNT);
+
+        applyVorticityConfinementCS.dispatchCompute(particleCount);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
         return 0;
     }
 
     int updateParticlePosition() {
-        glBindBuffer(GL_COPY_READ_BUFFER, positionPredictSSBO);
-        glBindBuffer(GL_COPY_WRITE_BUFFER, particlePositionSSBO);
-        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, PARTICLE_COUNT * sizeof(glm::vec4));
-        glBindBuffer(GL_COPY_READ_BUFFER, 0);
-        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        PROFILE_GPU("updateParticlePosition");
+
+        // the corrected prediction becomes the position, the old position is overwritten by applyExternalForce next frame
+        std::swap(particlePositionSSBO, positionPredictSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particlePositionSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, positionPredictSSBO);
+
+        return 0;
+    }
+
+
+    int updateSimulationParameter() {
+        SimulationParameter parameter = {};
+        parameter.boundaryHorizonMaxCoordinate = static_cast<float>(horizonMaxCoordinate);
+        parameter.viscosityParameter = viscosityParameter;
+        parameter.vorticityParameter = vorticityParameter;
+        parameter.neighborCapacity = neighborCapacity;
+        parameter.deltaVelocity = uDeltaVelocity;
+        parameter.left = uLeft;
+        parameter.right = uRight;
+        parameter.up = uUp;
+        parameter.down = uDown;
+        parameter.front = uFront;
+        parameter.back = uBack;
+
+        glBindBuffer(GL_UNIFORM_BUFFER, simulationParameterUBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(SimulationParameter), &parameter);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, SIMULATION_PARAMETER_BINDING, simulationParameterUBO);
 
         return 0;
     }
 
+    int bindSSBO() {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particlePositionSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, positionPredictSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, velocitySSBO);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, particleCountPerCubeSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, cubeOffsetSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, particleIndexInCubeSSBO);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, neighborCountPerParticleSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, neighborIndexBufferSSBO);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, densitySSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, constraintSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, constraintGradSquareSumSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, lambdaSSBO);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, positionPredictAidSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 14, neighborOffsetSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 15, particleIdSSBO);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 16, curlSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 17, curlXSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 18, curlYSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 19, curlZSSBO);
+
+        return 0;
+    }
 
     int divideCube() {
+        PROFILE_GPU("divideCube");
+
         clearParticleCountPerCube();
         computeParticleCountPerCube();
 
-        // computeOffsetByParticleCount();
-
-        computeInnerOffsetAndBlockSum();
-        computeBlockOffset();
-        computeOffsetByBlockOffset();
+        computeCubeOffset();
 
         assignParticleToCube();
 
+        if (reorderInterval > 0 && simulateFrameCount % reorderInterval == 0) {
+            reorderParticle();
+        }
+
         return 0;
     }
 
     int clearParticleCountPerCube() {
+        PROFILE_GPU("clearParticleCountPerCube");
+
         clearParticleCountPerCubeCS.use();
-        clearParticleCountPerCubeCS.setUint("CUBE_COUNT", CUBE_COUNT);
 
-        // glDispatchCompute(GLuint(ceil(static_cast<double>(CUBE_COUNT) / common::INVOCATION_PER_WORKGROUP)), 1, 1);
-        clearParticleCountPerCubeCS.dispatchCompute(CUBE_COUNT);
+        clearParticleCountPerCubeCS.dispatchCompute(cubeCount);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
         return 0;
     }
 
     int computeParticleCountPerCube() {
+        PROFILE_GPU("computeParticleCountPerCube");
+
         computeParticleCountPerCubeCS.use();
-        computeParticleCountPerCubeCS.setFloat("KERNEL_RADIUS", static_cast<float>(KERNEL_RADIUS));
-        computeParticleCountPerCubeCS.setFloat("HORIZON_MAX_COORDINATE", static_cast<float>(HORIZON_MAX_COORDINATE));
-        computeParticleCountPerCubeCS.setFloat("MAX_HEIGHT", static_cast<float>(MAX_HEIGHT));
-        computeParticleCountPerCubeCS.setUint("PARTICLE_COUNT", PARTICLE_COUNT);
 
-        // glDispatchCompute(GLuint(ceil(static_cast<double>(PARTICLE_COUNT) / common::INVOCATION_PER_WORKGROUP)), 1, 1);
-        computeParticleCountPerCubeCS.dispatchCompute(PARTICLE_COUNT);
+        computeParticleCountPerCubeCS.dispatchCompute(particleCount);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
         return 0;
     }
 
-    int computeOffsetByParticleCount() {
-        computeOffsetByParticleCountCS.use();
-        computeOffsetByParticleCountCS.setUint("CUBE_COUNT", CUBE_COUNT);
+    int computeCubeOffset() {
+        PROFILE_GPU("computeCubeOffset");
 
-        // glDispatchCompute(1, 1, 1);
-        computeOffsetByParticleCountCS.dispatchCompute(1);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        exclusiveScan->scan(particleCountPerCubeSSBO, cubeOffsetSSBO, cubeCount);
 
         return 0;
     }
 
-    int computeInnerOffsetAndBlockSum() {
-        computeInnerOffsetAndBlockSumCS.use();
-        computeInnerOffsetAndBlockSumCS.setUint("CUBE_COUNT_SQRT", CUBE_COUNT_SQRT);
-        computeInnerOffsetAndBlockSumCS.setUint("CUBE_COUNT", CUBE_COUNT);
+    int assignParticleToCube() {
+        PROFILE_GPU("assignParticleToCube");
 
-        // glDispatchCompute(GLuint(ceil(static_cast<double>(CUBE_COUNT_SQRT) / common::INVOCATION_PER_WORKGROUP)), 1, 1);
-        computeInnerOffsetAndBlockSumCS.dispatchCompute(CUBE_COUNT_SQRT);
+        assignParticleToCubeCS.use();
+
+        assignParticleToCubeCS.dispatchCompute(particleCount);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
         return 0;
-    }   
+    }
 
-    int computeBlockOffset() {
-        computeBlockOffsetCS.use();
-        computeBlockOffsetCS.setUint("CUBE_COUNT_SQRT", CUBE_COUNT_SQRT);
 
-        // glDispatchCompute(1, 1, 1);
-        computeBlockOffsetCS.dispatchCompute(1);
+    int countNeighborFromCube() {
+        PROFILE_GPU("countNeighborFromCube");
+
+        countNeighborFromCubeCS.use();
+
+        countNeighborFromCubeCS.dispatchCompute(particleCount);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
         return 0;
     }
 
-    int computeOffsetByBlockOffset() {
-        computeOffsetByBlockOffsetCS.use();
-        computeOffsetByBlockOffsetCS.setUint("CUBE_COUNT_SQRT", CUBE_COUNT_SQRT);
-        computeOffsetByBlockOffsetCS.setUint("CUBE_COUNT", CUBE_COUNT);
+    int computeNeighborOffset() {
+        PROFILE_GPU("computeNeighborOffset");
 
-        // glDispatchCompute(GLuint(ceil(static_cast<double>(CUBE_COUNT_SQRT) / common::INVOCATION_PER_WORKGROUP)), 1, 1);
-        computeOffsetByBlockOffsetCS.dispatchCompute(CUBE_COUNT_SQRT);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        exclusiveScan->scan(neighborCountPerParticleSSBO, neighborOffsetSSBO, particleCount);
 
         return 0;
     }
 
-    int assignParticleToCube() {
-        assignParticleToCubeCS.use();
-        assignParticleToCubeCS.setFloat("KERNEL_RADIUS", static_cast<float>(KERNEL_RADIUS));
-        assignParticleToCubeCS.setUint("PARTICLE_COUNT", PARTICLE_COUNT);
-        assignParticleToCubeCS.setFloat("HORIZON_MAX_COORDINATE", static_cast<float>(HORIZON_MAX_COORDINATE));
-        assignParticleToCubeCS.setFloat("MAX_HEIGHT", static_cast<float>(MAX_HEIGHT));
+    int reorderParticle() {
+        PROFILE_GPU("reorderParticle");
 
-        // glDispatchCompute(GLuint(ceil(static_cast<double>(PARTICLE_COUNT) / common::INVOCATION_PER_WORKGROUP)), 1, 1);
-        assignParticleToCubeCS.dispatchCompute(PARTICLE_COUNT);
+        reorderParticleCS.use();
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 24, reorderParticlePositionSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 25, positionPredictAidSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 26, reorderVelocitySSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 27, reorderParticleIdSSBO);
+
+        reorderParticleCS.dispatchCompute(particleCount);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
+        for (GLuint i = 24; i < 28; i++) {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, 0);
+        }
+
+        // the per-iteration buffers (density, lambda, neighbors, ...) are rebuilt later in the frame and need no permutation
+        std::swap(particlePositionSSBO, reorderParticlePositionSSBO);
+        std::swap(positionPredictSSBO, positionPredictAidSSBO);
+        std::swap(velocitySSBO, reorderVelocitySSBO);
+        std::swap(particleIdSSBO, reorderParticleIdSSBO);
+        bindSSBO();
+
         return 0;
     }
 
-
     int searchNeighborFromCube() {
+        PROFILE_GPU("searchNeighborFromCube");
+
         searchNeighborFromCubeCS.use();
-        searchNeighborFromCubeCS.setFloat("KERNEL_RADIUS", static_cast<float>(KERNEL_RADIUS));
-        searchNeighborFromCubeCS.setUint("PARTICLE_COUNT", PARTICLE_COUNT);
-        searchNeighborFromCubeCS.setUint("MAX_NEIGHBOR_COUNT", maxNeighborCount);
-        searchNeighborFromCubeCS.setFloat("HORIZON_MAX_COORDINATE", static_cast<float>(HORIZON_MAX_COORDINATE));
-        searchNeighborFromCubeCS.setFloat("MAX_HEIGHT", static_cast<float>(MAX_HEIGHT));
-
-        // glDispatchCompute(GLuint(ceil(static_cast<double>(PARTICLE_COUNT) / common::INVOCATION_PER_WORKGROUP)), 1, 1);
-        searchNeighborFromCubeCS.dispatchCompute(PARTICLE_COUNT);
+
+        searchNeighborFromCubeCS.dispatchCompute(particleCount);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
         return 0;
     }
 
 
+    int growNeighborCapacity(GLuint capacity) {
+        neighborCapacity = capacity;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, neighborIndexBufferSSBO);
+        common::gpuBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(neighborCapacity) * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        bindSSBO();
+
+        return 0;
+    }
+
+    // stalls on the scan total once, later frames rely on the late statistics readback
+    int fitNeighborCapacity() {
+        PROFILE_GPU("fitNeighborCapacity");
+
+        GLuint totalCount = 0;
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, neighborOffsetSSBO);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, static_cast<GLintptr>(particleCount) * sizeof(GLuint), sizeof(GLuint), &totalCount);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        if (totalCount > neighborCapacity) {
+            growNeighborCapacity(totalCount + totalCount / 4);
+            // NEIGHBOR_CAPACITY was already uploaded for this frame
+            updateSimulationParameter();
+        }
+        neighborCapacityFitted = true;
+
+        return 0;
+    }
+
+    int computeNeighborStatistics() {
+        // one readback in flight at a time, frames in between are not reduced at all
+        if (neighborStatisticsFence) {
+            return 0;
+        }
+
+        PROFILE_GPU("computeNeighborStatistics");
+
+        NeighborStatisticsBuffer initialStatistics = {};
+        initialStatistics.minCount = ~0u;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, neighborStatisticsSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(NeighborStatisticsBuffer), &initialStatistics);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NEIGHBOR_STATISTICS_BINDING, neighborStatisticsSSBO);
+
+        computeNeighborStatisticsCS.use();
+        computeNeighborStatisticsCS.dispatchCompute(particleCount);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        glBindBuffer(GL_COPY_READ_BUFFER, neighborStatisticsSSBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, neighborStatisticsReadbackBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(NeighborStatisticsBuffer));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        neighborStatisticsFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        neighborStatisticsFrameCount = simulateFrameCount;
+        neighborStatisticsCapacity = neighborCapacity;
+
+        return 0;
+    }
+
+    int updateNeighborStatistics() {
+        if (!neighborStatisticsFence) {
+            return 0;
+        }
+        GLenum waitResult = glClientWaitSync(neighborStatisticsFence, 0, 0);
+        if (waitResult != GL_ALREADY_SIGNALED && waitResult != GL_CONDITION_SATISFIED) {
+            return 0;
+        }
+        glDeleteSync(neighborStatisticsFence);
+        neighborStatisticsFence = nullptr;
+
+        NeighborStatisticsBuffer statistics;
+        glBindBuffer(GL_COPY_READ_BUFFER, neighborStatisticsReadbackBuffer);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(NeighborStatisticsBuffer), &statistics);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+        neighborStatistics.valid = true;
+        neighborStatistics.frameCount = neighborStatisticsFrameCount;
+        neighborStatistics.minCount = statistics.minCount;
+        neighborStatistics.maxCount = statistics.maxCount;
+        neighborStatistics.meanCount = static_cast<float>(statistics.totalCount) / particleCount;
+        neighborStatistics.totalCount = statistics.totalCount;
+        neighborStatistics.capacity = neighborStatisticsCapacity;
+        for (unsigned int i = 0; i < NEIGHBOR_HISTOGRAM_BIN_COUNT; i++) {
+            neighborStatistics.histogram[i] = statistics.histogram[i];
+        }
+        if (statistics.totalCount > neighborStatisticsCapacity) {
+            neighborStatistics.overflowFrameCount++;
+        }
+
+        // the frames since the reduction walked the cubes, grow with some headroom so the next frames fit
+        if (statistics.totalCount > neighborCapacity) {
+            growNeighborCapacity(statistics.totalCount + statistics.totalCount / 4);
+            neighborStatistics.growCount++;
+            neighborStatistics.lastGrowFrameCount = neighborStatisticsFrameCount;
+        }
+
+        return 0;
+    }
+
+    int outputNeighborStatistics(std::ostream& os) {
+        os << std::fixed << std::setprecision(2);
+        os << "--------------------Neighbor Statistics-----------------" << common::getSupplementarySymbol('-') << "\n";
+        if (!neighborStatistics.valid) {
+            os << "not available, neighbor lists are only built by the GPU backend in neighbor list mode\n";
+        }
+        else {
+            os << "Frame: \t\t\t\t\t\t\t" << neighborStatistics.frameCount << "\n"
+               << "Count: \t\t\t\t\t\t\tmin " << neighborStatistics.minCount << " \tmean " << neighborStatistics.meanCount << " \tmax " << neighborStatistics.maxCount << "\n"
+               << "Buffer: \t\t\t\t\t\t" << neighborStatistics.totalCount << " / " << neighborStatistics.capacity << " indices\n"
+               << "Overflow: \t\t\t\t\t\t" << neighborStatistics.overflowFrameCount << " frames so far walked the cubes\n"
+               << "Grown: \t\t\t\t\t\t\t" << neighborStatistics.growCount << " times";
+            if (neighborStatistics.growCount > 0) {
+                os << " \tlast after frame " << neighborStatistics.lastGrowFrameCount << " \tnow " << neighborCapacity << " indices";
+            }
+            os << "\n"
+               << "Histogram: \t\t\t\t\t\t";
+            for (unsigned int i = 0; i < NEIGHBOR_HISTOGRAM_BIN_COUNT; i++) {
+                os << neighborStatistics.histogram[i] << (i + 1 < NEIGHBOR_HISTOGRAM_BIN_COUNT ? " " : "\n");
+            }
+        }
+        os << "--------------------------------------------------------" << common::getSupplementarySymbol('-') << "\n"
+           << std::flush;
+
+        return 0;
+    }
+
+    int computeLambdaFused() {
+        PROFILE_GPU("computeLambdaFused");
+
+        computeLambdaFusedCS.use();
+
+        computeLambdaFusedCS.dispatchCompute(particleCount);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        return 0;
+    }
+
     int computeDensity() {
+        PROFILE_GPU("computeDensity");
+
         computeDensityCS.use();
-        computeDensityCS.setFloat("KERNEL_RADIUS", static_cast<float>(KERNEL_RADIUS));
-        computeDensityCS.setFloat("MASS", static_cast<float>(MASS));
-        computeDensityCS.setFloat("PI", static_cast<float>(common::PI));
-        computeDensityCS.setUint("MAX_NEIGHBOR_COUNT", maxNeighborCount);
-        computeDensityCS.setUint("PARTICLE_COUNT", PARTICLE_COUNT);
-
-        // glDispatchCompute(GLuint(ceil(static_cast<double>(PARTICLE_COUNT) / common::INVOCATION_PER_WORKGROUP)), 1, 1);
-        computeDensityCS.dispatchCompute(PARTICLE_COUNT);
+
+        computeDensityCS.dispatchCompute(particleCount);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
         return 0;
     }
 
     int computeConstraint() {
+        PROFILE_GPU("computeConstraint");
+
         computeConstraintCS.use();
-        computeConstraintCS.setFloat("REST_DENSITY_REVERSE", static_cast<float>(REST_DENSITY_REVERSE));
-        computeConstraintCS.setUint("PARTICLE_COUNT", PARTICLE_COUNT);
 
-        // glDispatchCompute(GLuint(ceil(static_cast<double>(PARTICLE_COUNT) / common::INVOCATION_PER_WORKGROUP)), 1, 1);
-        computeConstraintCS.dispatchCompute(PARTICLE_COUNT);
+        computeConstraintCS.dispatchCompute(particleCount);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
         return 0;
     }
 
     int computeConstraintGradSquareSum() {
+        PROFILE_GPU("computeConstraintGradSquareSum");
+
         computeConstraintGradSquareSumCS.use();
-        computeConstraintGradSquareSumCS.setFloat("KERNEL_RADIUS", static_cast<float>(KERNEL_RADIUS));
-        computeConstraintGradSquareSumCS.setFloat("MASS", static_cast<float>(MASS));
-        computeConstraintGradSquareSumCS.setFloat("REST_DENSITY_REVERSE", static_cast<float>(REST_DENSITY_REVERSE));
-        computeConstraintGradSquareSumCS.setFloat("PI", static_cast<float>(common::PI));
-        computeConstraintGradSquareSumCS.setUint("MAX_NEIGHBOR_COUNT", maxNeighborCount);
-        computeConstraintGradSquareSumCS.setUint("PARTICLE_COUNT", PARTICLE_COUNT);
-
-        // glDispatchCompute(GLuint(ceil(static_cast<double>(PARTICLE_COUNT) / common::INVOCATION_PER_WORKGROUP)), 1, 1);
-        computeConstraintGradSquareSumCS.dispatchCompute(PARTICLE_COUNT);
+
+        computeConstraintGradSquareSumCS.dispatchCompute(particleCount);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
         return 0;
@@ -606,33 +1084,58 @@ namespace simulator {
 
 
     int computeCurl() {
+        PROFILE_GPU("computeCurl");
+
         computeCurlCS.use();
-        computeCurlCS.setFloat("KERNEL_RADIUS", static_cast<float>(KERNEL_RADIUS));
-        computeCurlCS.setUint("MAX_NEIGHBOR_COUNT", maxNeighborCount);
-        computeCurlCS.setFloat("PI", static_cast<float>(common::PI));
-        computeCurlCS.setUint("PARTICLE_COUNT", PARTICLE_COUNT);
 
-        // glDispatchCompute(GLuint(ceil(static_cast<double>(PARTICLE_COUNT) / common::INVOCATION_PER_WORKGROUP)), 1, 1);
-        computeCurlCS.dispatchCompute(PARTICLE_COUNT);
+        computeCurlCS.dispatchCompute(particleCount);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
         return 0;
     }
    
-    int particlePositionInit() {
+    int particleStateInit(const std::vector<glm::vec4>& position, const std::vector<glm::vec4>& velocity) {
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, particlePositionSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, particleCount * sizeof(glm::vec4), position.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, velocitySSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, particleCount * sizeof(glm::vec4), velocity.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        return 0;
+    }
 
-        std::vector<glm::vec4> particlePositionVector(PARTICLE_COUNT);
+    int generateParticleState(std::vector<glm::vec4>& position, std::vector<glm::vec4>& velocity) {
+        if (!sceneShapes.empty()) {
+            auto begin = std::chrono::steady_clock::now();
+            sampleScene(position, velocity);
+            double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            std::cout << "scene " << sceneName << ": " << position.size() << " particles sampled in " << milliseconds << " ms" << std::endl;
+        }
+        else {
+            generateTwoDamBreak(position);
+            velocity.assign(position.size(), glm::vec4(0.0f));
+        }
+
+        // a restored run keeps its own count, its particles are overwritten right after simulateInit()
+        position.resize(particleCount, glm::vec4(0.0f));
+        velocity.resize(particleCount, glm::vec4(0.0f));
+
+        return 0;
+    }
+
+    int generateTwoDamBreak(std::vector<glm::vec4>& particlePositionVector) {
+        particlePositionVector.assign(particleCountPerEdgeXZ * particleCountPerEdgeXZ * particleCountPerEdgeY, glm::vec4(0.0f));
         const common::real DIAMETER = PARTICLE_RADIUS * 2.0;
 
-        // Tow Dam Break
+        // dropped from 100 diameters, lower when the domain is too short to keep 24 free layers above the blocks
+        const common::real dropHeight = std::max(DIAMETER, std::min(100.0 * DIAMETER, domainMaxHeight - (particleCountPerEdgeY / 2 + 24) * DIAMETER));
         unsigned int index = 0;
-        common::real x = -0.5 * HORIZON_MAX_COORDINATE + 5.0 * DIAMETER;
-        for (unsigned int i = 0; i < PARTICLE_COUNT_PER_EDGE_XZ; i++) {
-            common::real y = 100.0 * DIAMETER;
-            for (unsigned int j = 0; j < PARTICLE_COUNT_PER_EDGE_Y / 2; j++) {
-                common::real z = 0.5 * HORIZON_MAX_COORDINATE - 5.0 * DIAMETER;
-                for (unsigned int k = 0; k < PARTICLE_COUNT_PER_EDGE_XZ; k++) {
+        common::real x = -0.5 * domainHorizonMaxCoordinate + 5.0 * DIAMETER;
+        for (unsigned int i = 0; i < particleCountPerEdgeXZ; i++) {
+            common::real y = dropHeight;
+            for (unsigned int j = 0; j < particleCountPerEdgeY / 2; j++) {
+                common::real z = 0.5 * domainHorizonMaxCoordinate - 5.0 * DIAMETER;
+                for (unsigned int k = 0; k < particleCountPerEdgeXZ; k++) {
                     particlePositionVector[index++] = glm::vec4(x, y, z, 0.0);
                     z -= DIAMETER;
                 }
@@ -640,12 +1143,12 @@ namespace simulator {
             }
             x += DIAMETER;
         }
-        x = 0.5 * HORIZON_MAX_COORDINATE - 5.0 * DIAMETER;
-        for (unsigned int i = 0; i < PARTICLE_COUNT_PER_EDGE_XZ; i++) {
-            common::real y = 100.0 * DIAMETER;
-            for (unsigned int j = 0; j < PARTICLE_COUNT_PER_EDGE_Y / 2; j++) {
-                common::real z = -0.5 * HORIZON_MAX_COORDINATE + 5.0 * DIAMETER;
-                for (unsigned int k = 0; k < PARTICLE_COUNT_PER_EDGE_XZ; k++) {
+        x = 0.5 * domainHorizonMaxCoordinate - 5.0 * DIAMETER;
+        for (unsigned int i = 0; i < particleCountPerEdgeXZ; i++) {
+            common::real y = dropHeight;
+            for (unsigned int j = 0; j < particleCountPerEdgeY / 2; j++) {
+                common::real z = -0.5 * domainHorizonMaxCoordinate + 5.0 * DIAMETER;
+                for (unsigned int k = 0; k < particleCountPerEdgeXZ; k++) {
                     particlePositionVector[index++] = glm::vec4(x, y, z, 0.0);
                     z += DIAMETER;
                 }
@@ -654,42 +1157,65 @@ namespace simulator {
             x -= DIAMETER;
         }
 
-        // One Dam Break
-        // unsigned int index = 0;
-        // common::real x = -0.5 * HORIZON_MAX_COORDINATE + 5.0 * DIAMETER;
-        // for (unsigned int i = 0; i < PARTICLE_COUNT_PER_EDGE_XZ; i++) {
-        //     common::real y = 50.0 * DIAMETER;
-        //     for (unsigned int j = 0; j < PARTICLE_COUNT_PER_EDGE_Y; j++) {
-        //         common::real z = -0.5 * HORIZON_MAX_COORDINATE + 5.0 * DIAMETER;
-        //         for (unsigned int k = 0; k < PARTICLE_COUNT_PER_EDGE_XZ; k++) {
-        //             particlePositionVector[index++] = glm::vec4(x, y, z, 0.0);
-        //             z += DIAMETER;
-        //         }
-        //         y += DIAMETER;
-        //     }
-        //     x += DIAMETER;
-        // }
-
-        glBufferData(GL_SHADER_STORAGE_BUFFER, PARTICLE_COUNT * sizeof(glm::vec4), particlePositionVector.data(), GL_DYNAMIC_DRAW);
+        return 0;
+    }
+
+    int simulateOnCPU() {
+        // same stages and scope names as simulate(), the stages time themselves on the CPU
+        cpu::applyExternalForce();
+
+        cpu::searchNeighbor();
+
+        {
+            PROFILE_CPU("constraintProjection");
+            for (int i = 0; i < constraintProjectionIteration; i++) {
+                cpu::computeLambda();
+                cpu::correctPositionPredict();
+            }
+        }
+
+        cpu::updateVelocityByPosition();
+
+        if (vorticityParameter > 0.0f)
+            cpu::applyVorticityConfinement();
+
+        if (viscosityParameter > 0.0f)
+            cpu::applyViscosity();
+
+        cpu::manipulateVelocity();
+
+        cpu::handleBoundaryCollision();
+
+        cpu::updateParticlePosition();
+        if (!headless) {
+            uploadCPUResult();
+        }
 
+        return 0;
+    }
+
+    int uploadCPUResult() {
+        PROFILE_GPU("uploadCPUResult");
+
+        // the renderer only reads positions and densities
+        const std::vector<glm::vec4>& position = cpu::getParticlePosition();
+        const std::vector<float>& density = cpu::getDensity();
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, particlePositionSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, particleCount * sizeof(glm::vec4), position.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, densitySSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, particleCount * sizeof(float), density.data());
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
         return 0;
     }
 
     int manipulateVelocity() {
+        PROFILE_GPU("manipulateVelocity");
+
         manipulateVelocityCS.use();
-        manipulateVelocityCS.setUint("uParticleCount", PARTICLE_COUNT);
-        manipulateVelocityCS.setFloat("uDeltaVelocity", uDeltaVelocity);
-        
-        manipulateVelocityCS.setInt("uLeft", uLeft);
-        manipulateVelocityCS.setInt("uRight", uRight);
-        manipulateVelocityCS.setInt("uUp", uUp);
-        manipulateVelocityCS.setInt("uDown", uDown);
-        manipulateVelocityCS.setInt("uFront", uFront);
-        manipulateVelocityCS.setInt("uBack", uBack);
         
-        manipulateVelocityCS.dispatchCompute(PARTICLE_COUNT);
+        manipulateVelocityCS.dispatchCompute(particleCount);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
         return 0;
@@ -3,16 +3,42 @@
 #include <glm/glm.hpp>
 #include <glad/glad.h>
 
+#include <vector>
+#include <iostream>
+
 #include "../common/common.hpp"
 
 namespace simulator {
+    enum class Backend {
+        GPU,
+        CPU
+    };
+
+    // selected on the command line, the CPU backend still uploads its result to the SSBOs below for rendering
+    extern Backend backend;
+    // 0 means one thread per hardware thread
+    extern unsigned int cpuThreadCount;
+    // CPU backend without an OpenGL context: no buffers or shaders are created and nothing is uploaded,
+    // the particles stay in cpu::getParticlePosition(), for machines without a GPU or display
+    extern bool headless;
+
     // gui parameters
     extern int constraintProjectionIteration;
     extern float viscosityParameter;
     extern float vorticityParameter;
-    extern int maxNeighborCount;
     extern common::real horizonMaxCoordinate;
 
+    // NEIGHBOR_LIST builds the neighbor list once per frame, CUBE_ITERATION makes every kernel walk the surrounding cubes itself
+    enum NeighborSearchMode {
+        NEIGHBOR_LIST,
+        CUBE_ITERATION,
+    };
+    extern NeighborSearchMode neighborSearchMode;
+    // sort particles into cube order every reorderInterval frames, 0 turns it off
+    extern int reorderInterval;
+    // one kernel for density, constraint, gradient square sum and lambda, the split kernels stay for debugging
+    extern bool fuseLambdaKernel;
+
     extern int uLeft;
     extern int uRight;
     extern int uUp;
@@ -21,23 +47,53 @@ namespace simulator {
     extern int uBack;
     extern float uDeltaVelocity;
 
+    // frames simulated since simulateInit(), restored from checkpoints, the reorder schedule follows it
+    extern unsigned int simulateFrameCount;
+    // neighborIndexBuffer size in indices, grows when neighbor lists were cut
+    extern GLuint neighborCapacity;
+
+    // swapped with the prediction at the end of every frame, read the handle again after simulate()
     extern GLuint particlePositionSSBO;
+    extern GLuint velocitySSBO;
     extern GLuint densitySSBO;
+    // particleId[i] is the initial index of the particle now stored at i, particles move when they are reordered
+    extern GLuint particleIdSSBO;
 
     #ifdef eGPU
-    const unsigned int PARTICLE_COUNT_PER_EDGE_XZ = 48;
+    const unsigned int DEFAULT_PARTICLE_COUNT_PER_EDGE_XZ = 48;
     #else
-    const unsigned int PARTICLE_COUNT_PER_EDGE_XZ = 16;
+    const unsigned int DEFAULT_PARTICLE_COUNT_PER_EDGE_XZ = 16;
     #endif
-    const unsigned int PARTICLE_COUNT_PER_EDGE_Y = 128;
-    const unsigned int PARTICLE_COUNT = PARTICLE_COUNT_PER_EDGE_XZ * PARTICLE_COUNT_PER_EDGE_XZ * PARTICLE_COUNT_PER_EDGE_Y;
+    const unsigned int DEFAULT_PARTICLE_COUNT_PER_EDGE_Y = 128;
     const common::real PARTICLE_RADIUS = 0.01;
+    // width of the domain in particle diameters per particle on a horizontal edge
     #ifdef eGPU
-    const common::real HORIZON_MAX_COORDINATE = PARTICLE_COUNT_PER_EDGE_XZ * PARTICLE_RADIUS * 5.0;
+    const common::real HORIZON_DIAMETER_PER_PARTICLE = 2.5;
     #else
-    const common::real HORIZON_MAX_COORDINATE = PARTICLE_COUNT_PER_EDGE_XZ * PARTICLE_RADIUS * 2.0 * 4.0;
+    const common::real HORIZON_DIAMETER_PER_PARTICLE = 4.0;
     #endif
-    const common::real MAX_HEIGHT = (PARTICLE_COUNT_PER_EDGE_Y + 60) * PARTICLE_RADIUS * 2.0;
+    // free layers above the fluid in particle diameters
+    const unsigned int HEADROOM_DIAMETER = 60;
+
+    // requested scale, filled from the command line or a config file before configureScale()
+    struct SimulationScale {
+        unsigned int particleCountPerEdgeXZ = DEFAULT_PARTICLE_COUNT_PER_EDGE_XZ;
+        unsigned int particleCountPerEdgeY = DEFAULT_PARTICLE_COUNT_PER_EDGE_Y;
+        // <= 0 derives the domain from the particle count per edge
+        common::real horizonMaxCoordinate = 0.0;
+        common::real maxHeight = 0.0;
+        // > 0 fixes the particle count, for runs whose particles are replaced after simulateInit() (checkpoints, replays)
+        unsigned int particleCount = 0;
+    };
+    extern SimulationScale simulationScale;
+
+    // derived from simulationScale by configureScale(), fixed while the simulation runs
+    extern unsigned int particleCountPerEdgeXZ;
+    extern unsigned int particleCountPerEdgeY;
+    extern unsigned int particleCount;
+    extern common::real domainHorizonMaxCoordinate;
+    extern common::real domainMaxHeight;
+
     const common::real DELTA_TIME = 0.0016;
     const common::real DELTA_TIME_REVERSE = 1.0 / DELTA_TIME;
 
@@ -51,19 +107,52 @@ namespace simulator {
     const common::real FRICTION = 1.0;
     const common::real MASS = 6.4 * PARTICLE_RADIUS * PARTICLE_RADIUS * PARTICLE_RADIUS * REST_DENSITY;
     const common::real MASS_REVERSE = 1.0 / MASS;
-
+    // neighborIndexBuffer starts with this many slots per particle and grows when the neighbor total exceeds it
+    const unsigned int INITIAL_NEIGHBOR_COUNT_PER_PARTICLE = 48;
+    const unsigned int NEIGHBOR_HISTOGRAM_BIN_COUNT = 16;
+    const unsigned int NEIGHBOR_HISTOGRAM_BIN_WIDTH = 16;
+
+    // reduction of the neighbor counts of one frame, read back a few frames late,
+    // only the GPU backend in NEIGHBOR_LIST mode produces it
+    struct NeighborStatistics {
+        bool valid = false;
+        unsigned int frameCount = 0;
+        unsigned int minCount = 0;
+        unsigned int maxCount = 0;
+        float meanCount = 0.0f;
+        // neighbors of all particles against the neighborIndexBuffer size in that frame
+        unsigned int totalCount = 0;
+        unsigned int capacity = 0;
+        // reduced frames since simulateInit() whose lists did not fit into neighborIndexBuffer, those walk the cubes instead
+        unsigned int overflowFrameCount = 0;
+        // times neighborIndexBuffer was grown since simulateInit(), and the reduced frame that caused the last one
+        unsigned int growCount = 0;
+        unsigned int lastGrowFrameCount = 0;
+        // bin i counts particles with [i * NEIGHBOR_HISTOGRAM_BIN_WIDTH, (i + 1) * NEIGHBOR_HISTOGRAM_BIN_WIDTH) neighbors, the last bin is open ended
+        unsigned int histogram[NEIGHBOR_HISTOGRAM_BIN_COUNT] = {};
+    };
+    extern NeighborStatistics neighborStatistics;
+
+    // has to run before anything sizes buffers from particleCount, simulateInit() calls it again,
+    // the particle count comes from the scene file if one was loaded (see sceneFile.hpp)
+    int configureScale();
+    // the particle count per edge closest to particleCount with the default aspect ratio
+    SimulationScale scaleFromParticleCount(unsigned int particleCount);
 
     int simulateInit();
     int simulate();
     int simulateTerminate();
+    // replaces the particles simulateInit() laid out, the arrays are in storage order (see particleIdSSBO),
+    // everything else the next frame reads is derived from positions and velocities
+    int restoreParticleState(const std::vector<glm::vec4>& position, const std::vector<glm::vec4>& velocity, const std::vector<GLuint>& particleId,
+                             unsigned int frameCount, GLuint capacity);
 
     int applyExternalForce();
 
     int searchNeighbor();
     int computeLambda();
-    int computeDeltaPosition();
+    int correctPositionPredict();
     int handleBoundaryCollision();
-    int adjustPositionPredict();
     int updateVelocityByPosition();
 
     int applyVorticityConfinement();
@@ -71,23 +160,43 @@ namespace simulator {
 
     int updateParticlePosition();
 
+    int computeLambdaFused();
     int computeDensity();
     int computeConstraint();
     int computeConstraintGradSquareSum();
 
+    int bindSSBO();
+    int updateSimulationParameter();
+    int compileComputeShader();
+    int deleteComputeShader();
+
     int divideCube();
     int clearParticleCountPerCube();
     int computeParticleCountPerCube();
-    int computeOffsetByParticleCount();
-    int computeInnerOffsetAndBlockSum();
-    int computeBlockOffset();
-    int computeOffsetByBlockOffset();
+    int computeCubeOffset();
     int assignParticleToCube();
-
+    int reorderParticle();
+
+    int countNeighborFromCube();
+    int computeNeighborOffset();
+    // resizes neighborIndexBuffer and rebinds it, the contents are lost
+    int growNeighborCapacity(GLuint capacity);
+    // waits for the scan total of the first list after simulateInit() and restoreParticleState() so it fits
+    int fitNeighborCapacity();
     int searchNeighborFromCube();
+    int computeNeighborStatistics();
+    // picks up a finished reduction without waiting and grows neighborIndexBuffer if it was too small
+    int updateNeighborStatistics();
+    int outputNeighborStatistics(std::ostream& os);
 
     int computeCurl();
-    int particlePositionInit();
+    int particleStateInit(const std::vector<glm::vec4>& position, const std::vector<glm::vec4>& velocity);
+    // the scene file or the built-in two dam break, particleCount particles
+    int generateParticleState(std::vector<glm::vec4>& position, std::vector<glm::vec4>& velocity);
+    int generateTwoDamBreak(std::vector<glm::vec4>& position);
+
+    int simulateOnCPU();
+    int uploadCPUResult();
 
     int manipulateVelocity();
 }
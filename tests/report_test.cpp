@@ -0,0 +1,141 @@
+// checks of the benchmark report code, which needs no GL context
+#include "../src/bench/report.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+int failureCount = 0;
+
+void check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAILED: " << message << std::endl;
+        failureCount++;
+    }
+}
+
+bool isClose(double a, double b) {
+    return std::abs(a - b) < 1e-4;
+}
+
+bench::StageStatistics makeStatistics(double time) {
+    bench::StageStatistics statistics = {};
+    statistics.mean = time;
+    statistics.p50 = time;
+    statistics.p90 = time;
+    statistics.p99 = time;
+    statistics.min = time;
+    statistics.max = time;
+    statistics.sampleCount = 100;
+    return statistics;
+}
+
+void testStatistics() {
+    // 1 to 100 shuffled, nearest rank percentiles are the values themselves
+    std::vector<double> samples;
+    for (int i = 0; i < 100; i++) {
+        samples.push_back(static_cast<double>((i * 37) % 100 + 1));
+    }
+    bench::StageStatistics statistics = bench::computeStatistics(samples);
+    check(statistics.sampleCount == 100, "sample count");
+    check(isClose(statistics.mean, 50.5), "mean");
+    check(isClose(statistics.p50, 50.0), "p50");
+    check(isClose(statistics.p90, 90.0), "p90");
+    check(isClose(statistics.p99, 99.0), "p99");
+    check(isClose(statistics.min, 1.0), "min");
+    check(isClose(statistics.max, 100.0), "max");
+
+    bench::StageStatistics single = bench::computeStatistics({2.5});
+    check(isClose(single.p50, 2.5) && isClose(single.p99, 2.5), "percentiles of a single sample");
+
+    bench::StageStatistics empty = bench::computeStatistics({});
+    check(empty.sampleCount == 0 && empty.max == 0.0, "statistics of no samples");
+}
+
+void testRoundTrip() {
+    bench::BenchReport report;
+    report.scenario = "scene \"dam\"\\break";
+    report.backend = "gpu";
+    report.glRenderer = "test renderer";
+    report.particleCount = 65536;
+    report.warmupFrameCount = 30;
+    report.measuredFrameCount = 200;
+    report.stages.emplace_back("frame", bench::computeStatistics({1.0, 2.0, 3.0, 4.0}));
+    report.stages.emplace_back("frame/simulate/searchNeighbor", makeStatistics(0.1234));
+
+    const std::string fileName = "report_test.json";
+    {
+        std::ofstream file(fileName);
+        bench::writeReport(file, report);
+    }
+    bench::BenchReport read;
+    check(bench::readReport(fileName, read) == 0, "read the written report");
+    std::remove(fileName.c_str());
+
+    check(read.scenario == report.scenario, "scenario");
+    check(read.backend == report.backend, "backend");
+    check(read.glRenderer == report.glRenderer, "gl renderer");
+    check(read.particleCount == report.particleCount, "particle count");
+    check(read.warmupFrameCount == report.warmupFrameCount, "warm-up frames");
+    check(read.measuredFrameCount == report.measuredFrameCount, "measured frames");
+    check(read.stages.size() == report.stages.size(), "stage count");
+    for (size_t i = 0; i < read.stages.size() && i < report.stages.size(); i++) {
+        const bench::StageStatistics& a = report.stages[i].second;
+        const bench::StageStatistics& b = read.stages[i].second;
+        check(read.stages[i].first == report.stages[i].first, "stage name " + report.stages[i].first);
+        check(isClose(a.mean, b.mean) && isClose(a.p50, b.p50) && isClose(a.p90, b.p90) && isClose(a.p99, b.p99)
+              && isClose(a.min, b.min) && isClose(a.max, b.max) && a.sampleCount == b.sampleCount,
+              "statistics of " + report.stages[i].first);
+    }
+
+    check(bench::readReport("report_test_missing.json", read) != 0, "reading a missing report fails");
+}
+
+void testCompare() {
+    bench::BenchReport baseline;
+    baseline.backend = "gpu";
+    baseline.particleCount = 1000;
+    baseline.stages.emplace_back("frame", makeStatistics(10.0));
+    baseline.stages.emplace_back("frame/a", makeStatistics(1.0));
+    baseline.stages.emplace_back("frame/b", makeStatistics(0.001));
+    baseline.stages.emplace_back("frame/removed", makeStatistics(1.0));
+
+    bench::BenchReport current = baseline;
+    current.stages.clear();
+    // 20 % slower
+    current.stages.emplace_back("frame", makeStatistics(12.0));
+    // 5 % slower, below the threshold
+    current.stages.emplace_back("frame/a", makeStatistics(1.05));
+    // tripled, but below MIN_REGRESSION_TIME
+    current.stages.emplace_back("frame/b", makeStatistics(0.003));
+    current.stages.emplace_back("frame/new", makeStatistics(5.0));
+
+    std::ostringstream output;
+    check(bench::compareReports(baseline, current, "p50", 0.1, output) == 1, "one regression at 10 %");
+    check(output.str().find("REGRESSION") != std::string::npos, "regression is printed");
+    check(output.str().find("removed") != std::string::npos, "removed stage is printed");
+    check(output.str().find("new") != std::string::npos, "new stage is printed");
+
+    std::ostringstream ignored;
+    check(bench::compareReports(baseline, current, "mean", 0.01, ignored) == 2, "two regressions at 1 %");
+    check(bench::compareReports(baseline, baseline, "max", 0.0, ignored) == 0, "no regression against itself");
+    check(bench::compareReports(current, baseline, "p90", 0.1, ignored) == 0, "faster is no regression");
+
+    check(bench::isMetric("p99") && bench::isMetric("mean"), "known metrics");
+    check(!bench::isMetric("p95") && !bench::isMetric("P90"), "unknown metrics");
+}
+
+int main() {
+    testStatistics();
+    testRoundTrip();
+    testCompare();
+
+    if (failureCount > 0) {
+        std::cerr << failureCount << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "all report checks passed" << std::endl;
+    return 0;
+}